@@ -0,0 +1,89 @@
+/**
+ ******************************************************************************
+ * @file    bitband.h
+ * @author  Loren Snow
+ * @brief   Cortex-M4 bit-band alias access.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef BITBAND_H
+#define BITBAND_H
+
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+/*
+ * Every bit in the first 1 MB of the peripheral region (0x40000000-0x400FFFFF) and of SRAM has its
+ * own 32-bit word in an alias region. Reading the word returns the bit (0 or 1) and writing it
+ * changes only that bit, done by the bus matrix as one uninterruptible operation.
+ *
+ * On the F303 this covers APB1, APB2 and AHB1 (I2C, RCC, EXTI, SYSCFG, DMA, timers, ...). The GPIO
+ * ports sit on AHB2 at 0x48000000, outside the region; use BSRR/BRR (gpio_write_pins) for them.
+ */
+
+#define BITBAND_PERIPH_REGION_SIZE 0x00100000UL ///< size of the bit-band capable peripheral region
+
+/**
+ * @brief   Whether an address is inside the bit-band capable peripheral region.
+ */
+#define BITBAND_PERIPH_IN_REGION(addr) \
+    (((uint32_t)(addr) >= PERIPH_BASE) && ((uint32_t)(addr) < (PERIPH_BASE + BITBAND_PERIPH_REGION_SIZE)))
+
+/**
+ * @brief   Alias word address of a bit in the peripheral region.
+ */
+#define BITBAND_PERIPH_ALIAS(addr, bit) \
+    (PERIPH_BB_BASE + (((uint32_t)(addr) - PERIPH_BASE) << 5) + ((uint32_t)(bit) << 2))
+
+/**
+ * @brief   Alias word address of a bit in SRAM.
+ */
+#define BITBAND_SRAM_ALIAS(addr, bit) \
+    (SRAM_BB_BASE + (((uint32_t)(addr) - SRAM_BASE) << 5) + ((uint32_t)(bit) << 2))
+
+/**
+ * @brief   Single bit of a peripheral register as an lvalue, e.g. BITBAND_PERIPH(I2C1->CR1,
+ *          I2C_CR1_PE_Pos) = 1. Reads and writes are one load or one store.
+ */
+#define BITBAND_PERIPH(reg, bit) (*(volatile uint32_t *)BITBAND_PERIPH_ALIAS(&(reg), (bit)))
+
+/**
+ * @brief   Single bit of a variable in SRAM as an lvalue.
+ */
+#define BITBAND_SRAM(var, bit) (*(volatile uint32_t *)BITBAND_SRAM_ALIAS(&(var), (bit)))
+
+/* alias arithmetic, checked against hand-computed addresses */
+_Static_assert(BITBAND_PERIPH_ALIAS(I2C1_BASE, 0) == 0x420A8000UL, "I2C1->CR1 bit 0 alias");
+_Static_assert(BITBAND_PERIPH_ALIAS(I2C1_BASE + 0x18UL, 1) == 0x420A8304UL, "I2C1->ISR bit 1 alias");
+_Static_assert(BITBAND_PERIPH_ALIAS(RCC_BASE + 0x10UL, 21) == 0x42420254UL, "RCC->APB1RSTR bit 21 alias");
+_Static_assert(BITBAND_PERIPH_ALIAS(PERIPH_BASE + 0xFFFFFUL, 7) == 0x43FFFFFCUL, "last alias word");
+_Static_assert(BITBAND_SRAM_ALIAS(SRAM_BASE + 0x300UL, 2) == 0x22006008UL, "SRAM alias");
+_Static_assert(BITBAND_PERIPH_IN_REGION(I2C3_BASE), "I2C is bit-band capable");
+_Static_assert(BITBAND_PERIPH_IN_REGION(RCC_BASE), "RCC is bit-band capable");
+_Static_assert(!BITBAND_PERIPH_IN_REGION(GPIOA_BASE), "GPIO is not bit-band capable");
+
+#endif /* BITBAND_H */
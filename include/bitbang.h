@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file    bitbang.h
+ * @author  Loren Snow
+ * @brief   Cycle-timed bit-banged protocol header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef BITBANG_H
+#define BITBANG_H
+
+#include "gpio.h"
+#include <stdint.h>
+
+#ifndef BITBANG_CORE_CLOCK_HZ
+#define BITBANG_CORE_CLOCK_HZ 8000000U ///< core clock the protocol timings are computed for (8 MHz HSI by default)
+#endif
+
+/**
+ * @brief   Core clock cycles in a number of nanoseconds, rounded up. A constant expression.
+ */
+#define BITBANG_NS(ns) ((uint32_t)(((uint64_t)(ns) * BITBANG_CORE_CLOCK_HZ + 999999999U) / 1000000000U))
+
+/**
+ * @brief   Core clock cycles in a number of microseconds, rounded up. A constant expression.
+ */
+#define BITBANG_US(us) BITBANG_NS((uint64_t)(us) * 1000U)
+
+/**
+ * @brief   Half a clock period, in cycles, for a bit-banged bus clock frequency. A constant expression.
+ */
+#define BITBANG_HALF_PERIOD(hz) ((uint32_t)((BITBANG_CORE_CLOCK_HZ + 2U * (hz) - 1U) / (2U * (hz))))
+
+/**
+ * @brief   A single GPIO pin.
+ */
+typedef struct
+{
+    GPIO_TypeDef *GPIOx;
+    uint16_t mask; ///< pin as a mask (1U << pin)
+} bitbang_pin_t;
+
+/**
+ * @brief   Software SPI bus (mode 0, MSB first). Chip selects are left to the caller.
+ */
+typedef struct
+{
+    bitbang_pin_t sck;
+    bitbang_pin_t mosi;
+    bitbang_pin_t miso;
+    uint32_t half_period; ///< cycles, from BITBANG_HALF_PERIOD
+} bitbang_spi_t;
+
+/**
+ * @brief   Result of a software I2C transfer.
+ */
+typedef enum
+{
+    BITBANG_I2C_OK,
+    BITBANG_I2C_NACK,    ///< the target didn't acknowledge its address or a byte
+    BITBANG_I2C_TIMEOUT, ///< a target held SCL low past the stretch limit; the transfer was abandoned
+} Bitbang_I2C_Status;
+
+/**
+ * @brief   Software I2C bus on two open-drain pins with external pull-ups.
+ */
+typedef struct
+{
+    bitbang_pin_t scl;
+    bitbang_pin_t sda;
+    uint32_t half_period; ///< cycles, from BITBANG_HALF_PERIOD
+} bitbang_i2c_t;
+
+void bitbang_init(void);
+GPIO_Status bitbang_ws2812_write(const bitbang_pin_t *pin, const uint8_t *grb, uint32_t len);
+void bitbang_onewire_init(const bitbang_pin_t *pin);
+uint8_t bitbang_onewire_reset(const bitbang_pin_t *pin);
+void bitbang_onewire_write(const bitbang_pin_t *pin, uint8_t byte);
+uint8_t bitbang_onewire_read(const bitbang_pin_t *pin);
+void bitbang_spi_init(const bitbang_spi_t *spi);
+void bitbang_spi_transfer(const bitbang_spi_t *spi, const uint8_t *tx, uint8_t *rx, uint32_t len);
+void bitbang_i2c_init(const bitbang_i2c_t *i2c);
+Bitbang_I2C_Status bitbang_i2c_write(const bitbang_i2c_t *i2c, uint8_t addr, const uint8_t *data, uint32_t len);
+Bitbang_I2C_Status bitbang_i2c_read(const bitbang_i2c_t *i2c, uint8_t addr, uint8_t *data, uint32_t len);
+
+#endif /* BITBANG_H */
@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file    dma.h
+ * @author  Loren Snow
+ * @brief   DMA header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef DMA_H
+#define DMA_H
+
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+#define DMA_EVT_HALF (1U << 0)  ///< half of the transfer is done
+#define DMA_EVT_FULL (1U << 1)  ///< the whole transfer is done (or wrapped, in circular mode)
+#define DMA_EVT_ERROR (1U << 2) ///< bus error; the hardware has disabled the channel
+
+/**
+ * @brief   Result of a DMA channel setup call.
+ */
+typedef enum
+{
+    DMA_OK,
+    DMA_INVALID, ///< not a DMA channel
+} DMA_Status;
+
+/**
+ * @brief   Channel event callback, called from the channel's interrupt with a mask of DMA_EVT_*.
+ */
+typedef void (*dma_callback_t)(uint32_t events, void *ctx);
+
+DMA_Status dma_channel_configure(DMA_Channel_TypeDef *ch, volatile void *periph, const void *mem, uint16_t count,
+                                 uint32_t ccr);
+DMA_Status dma_channel_set_callback(DMA_Channel_TypeDef *ch, dma_callback_t cb, void *ctx);
+void dma_channel_start(DMA_Channel_TypeDef *ch);
+void dma_channel_stop(DMA_Channel_TypeDef *ch);
+uint8_t dma_channel_busy(DMA_Channel_TypeDef *ch);
+uint16_t dma_channel_remaining(DMA_Channel_TypeDef *ch);
+
+#endif /* DMA_H */
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @file    eeprom.h
+ * @author  Loren Snow
+ * @brief   24LC-series I2C EEPROM driver header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "i2c.h"
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+#ifndef EEPROM_WRITE_TIMEOUT_US
+#define EEPROM_WRITE_TIMEOUT_US 10000U ///< longest a write cycle may take before it counts as failed (datasheets: 5 ms)
+#endif
+
+#define EEPROM_SMALL_MAX 2048U        ///< largest part (24LC16) with one address byte; bigger ones use two
+
+/**
+ * @brief   A 24LC-series EEPROM. Allocated by the caller.
+ * @note    Parts up to 2 KB take one address byte, with the 256-byte block in the low bits of the
+ *          device address; parts up to 64 KB (24LC512) take two.
+ */
+typedef struct
+{
+    I2C_TypeDef *I2Cx;    ///< initialized I2C instance the EEPROM is on
+    uint16_t addr;        ///< 7-bit device address with the block bits clear, e.g. 0x50
+    uint32_t size;        ///< capacity in bytes
+    uint16_t page_size;   ///< write page in bytes (a power of 2), e.g. 16 for a 24LC16 or 64 for a 24LC256
+} eeprom_t;
+
+I2C_Status eeprom_init(eeprom_t *e, I2C_TypeDef *I2Cx, uint16_t addr, uint32_t size, uint16_t page_size);
+I2C_Status eeprom_read(const eeprom_t *e, uint32_t mem_addr, uint8_t *data, uint32_t len);
+I2C_Status eeprom_write(const eeprom_t *e, uint32_t mem_addr, const uint8_t *data, uint32_t len);
+I2C_Status eeprom_wait_ready(const eeprom_t *e);
+
+#endif /* EEPROM_H */
@@ -0,0 +1,57 @@
+/**
+ ******************************************************************************
+ * @file    exti.h
+ * @author  Loren Snow
+ * @brief   EXTI header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef EXTI_H
+#define EXTI_H
+
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+/**
+ * @brief   Definitions for the edges that trigger an EXTI line
+ */
+typedef enum
+{
+    EXTI_RISING = 1,
+    EXTI_FALLING = 2,
+    EXTI_BOTH = 3,
+} EXTI_Edge;
+
+/**
+ * @brief   Line handler, called from the EXTI interrupt after the pending bit is cleared.
+ */
+typedef void (*exti_handler_t)(uint8_t line, void *ctx);
+
+void exti_enable_pin(GPIO_TypeDef *GPIOx, uint8_t pin, EXTI_Edge edge, exti_handler_t handler, void *ctx);
+void exti_disable_pin(uint8_t pin);
+
+#endif /* EXTI_H */
@@ -33,11 +33,27 @@
 #ifndef GPIO_H
 #define GPIO_H
 
+#include "exti.h"
 #include "stm32f303xe.h"
 #include <stdint.h>
 
 #define LED_PIN (1U << 5) ///< LED is PA5
 
+#ifndef GPIO_EVENT_QUEUE_LEN
+#define GPIO_EVENT_QUEUE_LEN 32 ///< pin events buffered between ISR and main loop (power of 2)
+#endif
+
+/**
+ * @brief   Result of GPIO operations that can fail
+ */
+typedef enum
+{
+    GPIO_OK,
+    GPIO_BUSY,    ///< the resource (DMA channel, timer, ...) is already in use
+    GPIO_INVALID, ///< unsupported argument, e.g. a timer with no DMA request
+    GPIO_LOCKED,  ///< the pin's configuration is locked until the next reset
+} GPIO_Status;
+
 /**
  * @brief   Definitions for GPIO modes
  * @note    | INPUT = Input mode
@@ -62,6 +78,17 @@ typedef enum
     OPEN_DRAIN,
 } Output_Type;
 
+/**
+ * @brief   Definitions for GPIO output speed
+ * @note    Values are the OSPEEDR bit patterns (x0 = low, 01 = medium, 11 = high).
+ */
+typedef enum
+{
+    LOW_SPEED = 0,
+    MEDIUM_SPEED = 1,
+    HIGH_SPEED = 3,
+} Output_Speed;
+
 /**
  * @brief   Definitions for GPIO pull-up/pull-down mode
  */
@@ -95,14 +122,84 @@ typedef enum
     AF15,
 } Alt_Function;
 
+/**
+ * @brief   Full configuration of a pin, applied to every pin in a mask by gpio_configure.
+ * @note    af is only written when mode is ALTERNATE.
+ */
+typedef struct
+{
+    GPIO_Mode mode;
+    Output_Type type;
+    Output_Speed speed;
+    PullUp_PullDown pull;
+    Alt_Function af;
+} gpio_config_t;
+
+/**
+ * @brief   Precomputed register image for a set of pins on one port.
+ * @note    Built at compile time by GPIO_PINMAP_IMAGE (gpio_pinmap.h) or at runtime by
+ *          gpio_configure, and written by gpio_apply_image.
+ */
+typedef struct
+{
+    uint16_t pins;        ///< pins owned by the image (bit n = pin n)
+    uint32_t mask2;       ///< 11 in every owned MODER/OSPEEDR/PUPDR field
+    uint32_t afr_mask[2]; ///< 1111 in every AFRL/AFRH field to write (alternate-function pins only)
+    uint32_t moder;
+    uint32_t otyper;
+    uint32_t ospeedr;
+    uint32_t pupdr;
+    uint32_t afr[2];
+} gpio_port_image_t;
+
+/**
+ * @brief   A debounced pin edge, timestamped in the interrupt.
+ */
+typedef struct
+{
+    GPIO_TypeDef *GPIOx;
+    uint8_t pin;
+    uint8_t level;      ///< pin level read right after the edge
+    uint32_t timestamp; ///< DWT cycle count at the edge
+} gpio_event_t;
+
+/**
+ * @brief   Per-pin event handler, called from gpio_event_dispatch in the main loop.
+ */
+typedef void (*gpio_event_handler_t)(const gpio_event_t *evt, void *ctx);
+
+void gpio_shadow_sync(GPIO_TypeDef *GPIOx);
+GPIO_Status gpio_apply_image(GPIO_TypeDef *GPIOx, const gpio_port_image_t *img);
+GPIO_Status gpio_configure(GPIO_TypeDef *GPIOx, uint16_t pin_mask, const gpio_config_t *cfg);
 void gpio_map_alternate_fn(GPIO_TypeDef *GPIOx, uint8_t pin, Alt_Function fn);
+void gpio_map_alternate_fn_port(GPIO_TypeDef *GPIOx, const uint8_t af[16]);
+void gpio_write_pins(GPIO_TypeDef *GPIOx, uint16_t set_mask, uint16_t reset_mask);
+void gpio_set_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask);
+void gpio_reset_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask);
+void gpio_toggle_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask);
+uint16_t gpio_read_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask);
 void gpio_set_mode(GPIO_TypeDef *GPIOx, uint8_t pin, GPIO_Mode mode);
 void gpio_set_output_type(GPIO_TypeDef *GPIOx, uint8_t pin, Output_Type type);
+void gpio_set_output_speed(GPIO_TypeDef *GPIOx, uint8_t pin, Output_Speed speed);
 void gpio_set_pullup_pulldown(GPIO_TypeDef *GPIOx, uint8_t pin, PullUp_PullDown pull_t);
+GPIO_Mode gpio_get_mode(GPIO_TypeDef *GPIOx, uint8_t pin);
+Output_Type gpio_get_output_type(GPIO_TypeDef *GPIOx, uint8_t pin);
+Output_Speed gpio_get_output_speed(GPIO_TypeDef *GPIOx, uint8_t pin);
+PullUp_PullDown gpio_get_pullup_pulldown(GPIO_TypeDef *GPIOx, uint8_t pin);
+Alt_Function gpio_get_alternate_fn(GPIO_TypeDef *GPIOx, uint8_t pin);
+GPIO_Status gpio_lock_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask);
+uint16_t gpio_locked_pins(GPIO_TypeDef *GPIOx);
 void gpioa_enable_led(void);
 void gpioa_led_on(void);
 void gpioa_led_off(void);
 void gpioa_led_toggle(void);
 void gpiob_use_I2C(void);
+void gpio_event_enable(GPIO_TypeDef *GPIOx, uint8_t pin, EXTI_Edge edge, uint32_t debounce_us,
+                       gpio_event_handler_t handler, void *ctx);
+void gpio_event_disable(uint8_t pin);
+uint8_t gpio_event_pop(gpio_event_t *evt);
+uint32_t gpio_event_dispatch(void);
+void gpio_event_wait(void);
+uint32_t gpio_event_dropped(void);
 
 #endif /* GPIO_H */
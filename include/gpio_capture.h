@@ -0,0 +1,89 @@
+/**
+ ******************************************************************************
+ * @file    gpio_capture.h
+ * @author  Loren Snow
+ * @brief   DMA-driven GPIO logic-analyzer capture header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef GPIO_CAPTURE_H
+#define GPIO_CAPTURE_H
+
+#include "exti.h"
+#include "gpio.h"
+#include <stdint.h>
+
+/**
+ * @brief   Definitions for capture states
+ */
+typedef enum
+{
+    CAPTURE_IDLE,
+    CAPTURE_RUNNING,   ///< sampling, waiting for the trigger (or for gpio_capture_stop)
+    CAPTURE_TRIGGERED, ///< trigger seen, sampling the post-trigger window
+    CAPTURE_DONE,      ///< stopped; the buffer can be read or dumped
+} Capture_State;
+
+/**
+ * @brief   A capture of a whole port's IDR into a ring buffer, one sample per timer update event.
+ * @note    Fill in the configuration fields before gpio_capture_start; the rest is driver state.
+ *          Sampling runs entirely in DMA and interrupts. With a trigger, the capture stops on its
+ *          own once at least half the buffer has been filled after the trigger edge, so the
+ *          buffer holds both the lead-up to the edge and what followed it.
+ */
+typedef struct
+{
+    GPIO_TypeDef *GPIOx;      ///< port to sample
+    TIM_TypeDef *TIMx;        ///< timer whose update event paces the samples
+    uint16_t *buf;            ///< ring buffer of IDR samples
+    uint16_t len;             ///< number of samples in buf (even)
+    uint32_t rate_hz;         ///< samples per second
+    GPIO_TypeDef *trig_port;  ///< trigger pin's port, or NULL to sample until gpio_capture_stop
+    uint8_t trig_pin;         ///< trigger pin (0-15)
+    EXTI_Edge trig_edge;      ///< trigger edge
+    DMA_Channel_TypeDef *ch;  ///< DMA channel in use
+    volatile Capture_State state;
+    volatile uint8_t wrapped;      ///< the ring has been filled at least once
+    volatile uint8_t triggered;    ///< the trigger edge has been seen
+    volatile uint8_t boundaries;   ///< half/full boundaries still to pass before stopping
+    volatile uint16_t trig_index;  ///< buffer index of the first sample after the trigger edge
+    uint16_t end_index;            ///< buffer index the next sample would have gone to
+} gpio_capture_t;
+
+/**
+ * @brief   Run-length dump output: value was sampled run times in a row.
+ */
+typedef void (*gpio_capture_emit_t)(uint16_t value, uint32_t run, void *ctx);
+
+GPIO_Status gpio_capture_start(gpio_capture_t *cap);
+void gpio_capture_stop(gpio_capture_t *cap);
+uint8_t gpio_capture_done(const gpio_capture_t *cap);
+uint16_t gpio_capture_count(const gpio_capture_t *cap);
+int32_t gpio_capture_trigger_offset(const gpio_capture_t *cap);
+void gpio_capture_dump(const gpio_capture_t *cap, gpio_capture_emit_t emit, void *ctx);
+
+#endif /* GPIO_CAPTURE_H */
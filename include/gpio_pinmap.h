@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * @file    gpio_pinmap.h
+ * @author  Loren Snow
+ * @brief   Compile-time GPIO pin map tables.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef GPIO_PINMAP_H
+#define GPIO_PINMAP_H
+
+#include "gpio.h"
+
+/*
+ * A pin map is an X-macro listing one pin per entry:
+ *
+ *     #define BOARD_PINS(X, P)                                                \
+ *         X(P, A, 5, OUTPUT, PUSH_PULL, LOW_SPEED, NONE, AF0)                 \
+ *         X(P, B, 8, ALTERNATE, OPEN_DRAIN, LOW_SPEED, PULL_UP, AF4)          \
+ *         X(P, B, 9, ALTERNATE, OPEN_DRAIN, LOW_SPEED, PULL_UP, AF4)
+ *
+ *     GPIO_PINMAP_CHECK(BOARD_PINS);
+ *     ...
+ *     GPIO_PINMAP_APPLY(BOARD_PINS, A);
+ *     GPIO_PINMAP_APPLY(BOARD_PINS, B);
+ *
+ * Every register value for a port is a constant expression folded by the compiler, so applying a
+ * port is one masked store per register (see gpio_apply_image) with no per-pin work at runtime.
+ * P is passed through untouched; the macros below use it to select the port being folded.
+ */
+
+#define GPIO_PINMAP_PORT_A 0 ///< port ids used to match map entries to a port
+#define GPIO_PINMAP_PORT_B 1
+#define GPIO_PINMAP_PORT_C 2
+#define GPIO_PINMAP_PORT_D 3
+#define GPIO_PINMAP_PORT_E 4
+#define GPIO_PINMAP_PORT_F 5
+#define GPIO_PINMAP_PORT_G 6
+#define GPIO_PINMAP_PORT_H 7
+
+/* per-entry contributions; each evaluates to 0 for entries on other ports */
+#define GPIO_PINMAP_ON(P, port) (GPIO_PINMAP_PORT_##port == (P))
+#define GPIO_PINMAP_IS_AF(P, port, mode) (GPIO_PINMAP_ON(P, port) && (mode) == ALTERNATE)
+
+#define GPIO_PINMAP_X_PINS(P, port, pin, mode, type, speed, pull, af) \
+    | (GPIO_PINMAP_ON(P, port) ? (1U << (pin)) : 0U)
+#define GPIO_PINMAP_X_SUM(P, port, pin, mode, type, speed, pull, af) \
+    + (GPIO_PINMAP_ON(P, port) ? (1U << (pin)) : 0U)
+#define GPIO_PINMAP_X_BADPIN(P, port, pin, mode, type, speed, pull, af) \
+    | ((pin) > 15)
+#define GPIO_PINMAP_X_MASK2(P, port, pin, mode, type, speed, pull, af) \
+    | (GPIO_PINMAP_ON(P, port) ? (3U << ((pin) * 2)) : 0U)
+#define GPIO_PINMAP_X_MODER(P, port, pin, mode, type, speed, pull, af) \
+    | (GPIO_PINMAP_ON(P, port) ? ((uint32_t)(mode) << ((pin) * 2)) : 0U)
+#define GPIO_PINMAP_X_OTYPER(P, port, pin, mode, type, speed, pull, af) \
+    | (GPIO_PINMAP_ON(P, port) ? ((uint32_t)(type) << (pin)) : 0U)
+#define GPIO_PINMAP_X_OSPEEDR(P, port, pin, mode, type, speed, pull, af) \
+    | (GPIO_PINMAP_ON(P, port) ? ((uint32_t)(speed) << ((pin) * 2)) : 0U)
+#define GPIO_PINMAP_X_PUPDR(P, port, pin, mode, type, speed, pull, af) \
+    | (GPIO_PINMAP_ON(P, port) ? ((uint32_t)(pull) << ((pin) * 2)) : 0U)
+#define GPIO_PINMAP_X_AFRL_MASK(P, port, pin, mode, type, speed, pull, af) \
+    | ((GPIO_PINMAP_IS_AF(P, port, mode) && (pin) < 8) ? (0xFU << (((pin) & 7) * 4)) : 0U)
+#define GPIO_PINMAP_X_AFRH_MASK(P, port, pin, mode, type, speed, pull, af) \
+    | ((GPIO_PINMAP_IS_AF(P, port, mode) && (pin) >= 8) ? (0xFU << (((pin) & 7) * 4)) : 0U)
+#define GPIO_PINMAP_X_AFRL(P, port, pin, mode, type, speed, pull, af) \
+    | ((GPIO_PINMAP_IS_AF(P, port, mode) && (pin) < 8) ? ((uint32_t)(af) << (((pin) & 7) * 4)) : 0U)
+#define GPIO_PINMAP_X_AFRH(P, port, pin, mode, type, speed, pull, af) \
+    | ((GPIO_PINMAP_IS_AF(P, port, mode) && (pin) >= 8) ? ((uint32_t)(af) << (((pin) & 7) * 4)) : 0U)
+
+/* folds a whole map into one constant for a port */
+#define GPIO_PINMAP_FOLD(map, X, port) (0U map(X, GPIO_PINMAP_PORT_##port))
+
+/**
+ * @brief   Constant gpio_port_image_t initializer for one port of a pin map.
+ */
+#define GPIO_PINMAP_IMAGE(map, port)                                                               \
+    {                                                                                              \
+        (uint16_t)GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_PINS, port),                                 \
+            GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_MASK2, port),                                      \
+            {GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_AFRL_MASK, port),                                 \
+             GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_AFRH_MASK, port)},                                \
+            GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_MODER, port),                                      \
+            GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_OTYPER, port),                                     \
+            GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_OSPEEDR, port),                                    \
+            GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_PUPDR, port),                                      \
+            {GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_AFRL, port),                                      \
+             GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_AFRH, port)},                                     \
+    }
+
+/**
+ * @brief   Applies one port of a pin map. Ports with no entries in the map are skipped.
+ * @note    The port's clock must already be enabled.
+ */
+#define GPIO_PINMAP_APPLY(map, port)                                                               \
+    do                                                                                             \
+    {                                                                                              \
+        static const gpio_port_image_t gpio_pinmap_image = GPIO_PINMAP_IMAGE(map, port);           \
+        if (gpio_pinmap_image.pins)                                                                \
+        {                                                                                          \
+            gpio_apply_image(GPIO##port, &gpio_pinmap_image);                                      \
+        }                                                                                          \
+    } while (0)
+
+/*
+ * Compile-time checks. A pin listed twice makes the sum of its pin bits differ from their OR,
+ * since the duplicate carries into the next bit.
+ */
+#define GPIO_PINMAP_CHECK_PORT(map, port)                                                          \
+    _Static_assert(GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_SUM, port) ==                               \
+                       GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_PINS, port),                            \
+                   #map ": pin assigned more than once on GPIO" #port)
+
+/**
+ * @brief   Fails the build if any pin in the map is out of range or assigned more than once.
+ */
+#define GPIO_PINMAP_CHECK(map)                                                                     \
+    _Static_assert(GPIO_PINMAP_FOLD(map, GPIO_PINMAP_X_BADPIN, A) == 0,                            \
+                   #map ": pin number out of range (0-15)");                                       \
+    GPIO_PINMAP_CHECK_PORT(map, A);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, B);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, C);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, D);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, E);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, F);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, G);                                                                \
+    GPIO_PINMAP_CHECK_PORT(map, H)
+
+#endif /* GPIO_PINMAP_H */
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @file    gpio_wave.h
+ * @author  Loren Snow
+ * @brief   DMA-driven GPIO waveform header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef GPIO_WAVE_H
+#define GPIO_WAVE_H
+
+#include "dma.h"
+#include "gpio.h"
+#include <stdint.h>
+
+/**
+ * @brief   A waveform streamed into a port's BSRR by DMA, one word per timer update event.
+ * @note    Fill in the fields before gpio_wave_start; ch is set by gpio_wave_start. Each buffer
+ *          word is a BSRR value (see gpio_wave_word), so one sample can set and clear any pins of
+ *          the port at once and pins outside the pattern are never touched.
+ */
+typedef struct
+{
+    GPIO_TypeDef *GPIOx;     ///< port the pattern is written to
+    TIM_TypeDef *TIMx;       ///< timer whose update event paces the samples
+    const uint32_t *buf;     ///< BSRR words
+    uint16_t len;            ///< number of words in buf
+    uint32_t rate_hz;        ///< samples per second
+    uint8_t circular;        ///< 1 = repeat buf until stopped, 0 = play it once
+    dma_callback_t callback; ///< DMA_EVT_HALF/FULL/ERROR from the DMA interrupt, or NULL
+    void *ctx;               ///< passed back to callback
+    DMA_Channel_TypeDef *ch; ///< DMA channel in use
+} gpio_wave_t;
+
+uint32_t gpio_wave_word(uint16_t pin_mask, uint16_t value);
+void gpio_wave_encode_bus(uint32_t *dst, const uint8_t *src, uint16_t len, uint8_t first_pin);
+GPIO_Status gpio_wave_start(gpio_wave_t *wave);
+void gpio_wave_stop(gpio_wave_t *wave);
+
+#endif /* GPIO_WAVE_H */
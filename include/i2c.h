@@ -36,9 +36,21 @@
 #include "stm32f3xx.h"
 #include <stdint.h>
 
+#ifndef I2C_TIMEOUT_US
+#define I2C_TIMEOUT_US 2000U ///< default per-event timeout of blocking transfers (see I2C_set_timeout)
+#endif
+
+#ifndef I2C_SCL_TIMEOUT_US
+#define I2C_SCL_TIMEOUT_US 25000U ///< SCL held low for longer than this is a timeout (SMBus tTIMEOUT)
+#endif
+
+#ifndef I2C_HSI_CLOCK_HZ
+#define I2C_HSI_CLOCK_HZ 8000000U ///< HSI frequency, the default I2C kernel clock
+#endif
+
 /**
  * @brief   Definitions for setting I2C to standard (100 kHz), fast (400 kHz)
- *          or fast-plus (500 kHz) mode.
+ *          or fast-plus (1 MHz) mode.
  */
 typedef enum
 {
@@ -47,7 +59,158 @@ typedef enum
     Fast_Plus,
 } I2C_Mode;
 
-void I2C_init(I2C_TypeDef *I2Cx, I2C_Mode mode);
-void I2C_write_bytes(I2C_TypeDef *I2Cx, uint16_t target_addr, char *data, uint32_t len);
+/**
+ * @brief   Kernel clock (I2CCLK) sources of an I2C instance.
+ */
+typedef enum
+{
+    I2C_CLOCK_HSI,    ///< reset default; needed for wakeup from Stop mode
+    I2C_CLOCK_SYSCLK,
+} I2C_Clock;
+
+/**
+ * @brief   Result of an I2C operation.
+ */
+typedef enum
+{
+    I2C_OK,
+    I2C_BUSY,    ///< a transfer is already in flight on the instance
+    I2C_INVALID, ///< bad instance or address
+    I2C_NACK,    ///< the target didn't acknowledge its address or a byte
+    I2C_ARLO,    ///< another controller won arbitration for the bus
+    I2C_BERR,    ///< misplaced START or STOP on the bus; the bus has been recovered
+    I2C_TIMEOUT, ///< the bus stopped making progress; the bus has been recovered
+} I2C_Status;
+
+/**
+ * @brief   Counters of an I2C instance's controller transfers.
+ */
+typedef struct
+{
+    uint32_t transfers; ///< transfers that ended, successfully or not
+    uint32_t bytes;     ///< bytes written and read by successful transfers
+    uint32_t errors;    ///< transfers that ended with a status other than I2C_OK
+} i2c_bus_stats_t;
+
+#ifdef I2C_INSTRUMENT
+
+#ifndef I2C_INSTR_ADDRS
+#define I2C_INSTR_ADDRS 8U ///< address slots per bus; the last one collects addresses that don't fit
+#endif
+
+#ifndef I2C_INSTR_BUCKETS
+#define I2C_INSTR_BUCKETS 16U ///< latency histogram buckets, each twice as wide as the one before
+#endif
+
+#ifndef I2C_INSTR_SHIFT
+#define I2C_INSTR_SHIFT 10U ///< bucket 0 holds latencies under 2^I2C_INSTR_SHIFT DWT cycles
+#endif
+
+#define I2C_INSTR_ADDR_NONE 0xFFFFU  ///< slot not used yet
+#define I2C_INSTR_ADDR_OTHER 0xFFFEU ///< overflow slot, for addresses seen after the others filled up
+
+/**
+ * @brief   Counters for the controller transfers to one target address.
+ * @note    Latency runs from the transfer getting the bus to its STOP, in DWT cycles.
+ */
+typedef struct
+{
+    uint16_t addr;                          ///< target address, or I2C_INSTR_ADDR_*
+    uint32_t transactions;
+    uint32_t bytes;                         ///< bytes written and read by successful transfers
+    uint32_t nacks;
+    uint32_t arb_lost;
+    uint32_t timeouts;
+    uint32_t bus_errors;
+    uint32_t last_end;                      ///< DWT cycle count when the latest transfer ended
+    uint32_t max_latency;
+    uint32_t latency[I2C_INSTR_BUCKETS];    ///< log2 histogram, see I2C_INSTR_SHIFT
+} i2c_instr_slot_t;
+
+/**
+ * @brief   A consistent copy of one bus's per-address counters.
+ */
+typedef struct
+{
+    uint32_t taken_at; ///< DWT cycle count when the copy was taken
+    i2c_instr_slot_t slots[I2C_INSTR_ADDRS];
+} i2c_instr_snapshot_t;
+
+#endif /* I2C_INSTRUMENT */
+
+/**
+ * @brief   One piece of a scatter-gather write.
+ */
+typedef struct
+{
+    const uint8_t *data;
+    uint32_t len;
+} i2c_segment_t;
+
+/**
+ * @brief   Supplies the next piece of a streamed write: points *data at it and returns its length,
+ *          or 0 if there is nothing more.
+ */
+typedef uint32_t (*i2c_producer_t)(const uint8_t **data, void *ctx);
+
+/**
+ * @brief   Transfer completion callback, called from the instance's event interrupt once the STOP
+ *          condition has been sent.
+ */
+typedef void (*i2c_callback_t)(I2C_Status status, void *ctx);
+
+/**
+ * @brief   How an I2C instance is wired to the NVIC, DMA1 and EXTI.
+ */
+typedef struct
+{
+    IRQn_Type ev_irq;
+    IRQn_Type er_irq;
+    DMA_Channel_TypeDef *dma_tx; ///< DMA1 channel for TX requests, or NULL
+    DMA_Channel_TypeDef *dma_rx; ///< DMA1 channel for RX requests, or NULL
+    uint32_t wake_line;          ///< EXTI_IMR bit of the wakeup event (an internal line)
+} i2c_wiring_t;
+
+struct i2c_target; ///< target mode state (see i2c_target.h)
+
+I2C_Status I2C_init(I2C_TypeDef *I2Cx, I2C_Mode mode);
+uint32_t I2C_get_clock(I2C_TypeDef *I2Cx);
+I2C_Status I2C_set_clock(I2C_TypeDef *I2Cx, I2C_Clock clock);
+I2C_Status I2C_set_bus_speed(I2C_TypeDef *I2Cx, uint32_t bus_hz, uint32_t rise_ns, uint32_t fall_ns);
+void I2C_set_timeout(I2C_TypeDef *I2Cx, uint32_t timeout_us);
+void I2C_set_bus_pins(I2C_TypeDef *I2Cx, GPIO_TypeDef *scl_port, uint8_t scl_pin, GPIO_TypeDef *sda_port,
+                      uint8_t sda_pin);
+I2C_Status I2C_recover(I2C_TypeDef *I2Cx);
+I2C_Status I2C_write_bytes(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *data, uint32_t len);
+I2C_Status I2C_probe(I2C_TypeDef *I2Cx, uint16_t target_addr);
+I2C_Status I2C_write_segments(I2C_TypeDef *I2Cx, uint16_t target_addr, const i2c_segment_t *segs, uint32_t count);
+I2C_Status I2C_write_stream(I2C_TypeDef *I2Cx, uint16_t target_addr, uint32_t len, i2c_producer_t producer,
+                            void *producer_ctx);
+I2C_Status I2C_read_bytes(I2C_TypeDef *I2Cx, uint16_t target_addr, uint8_t *data, uint32_t len);
+I2C_Status I2C_write_read(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *tx, uint32_t tx_len, uint8_t *rx,
+                          uint32_t rx_len);
+I2C_Status I2C_write_async(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *data, uint32_t len,
+                           i2c_callback_t cb, void *ctx);
+I2C_Status I2C_write_segments_async(I2C_TypeDef *I2Cx, uint16_t target_addr, const i2c_segment_t *segs,
+                                    uint32_t count, i2c_callback_t cb, void *ctx);
+I2C_Status I2C_write_stream_async(I2C_TypeDef *I2Cx, uint16_t target_addr, uint32_t len, i2c_producer_t producer,
+                                  void *producer_ctx, i2c_callback_t cb, void *ctx);
+I2C_Status I2C_read_async(I2C_TypeDef *I2Cx, uint16_t target_addr, uint8_t *data, uint32_t len, i2c_callback_t cb,
+                          void *ctx);
+I2C_Status I2C_write_read_async(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *tx, uint32_t tx_len,
+                                uint8_t *rx, uint32_t rx_len, i2c_callback_t cb, void *ctx);
+I2C_Status I2C_write_dma(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *data, uint32_t len,
+                         i2c_callback_t cb, void *ctx);
+I2C_Status I2C_read_dma(I2C_TypeDef *I2Cx, uint16_t target_addr, uint8_t *data, uint32_t len,
+                        i2c_callback_t cb, void *ctx);
+uint8_t I2C_busy(I2C_TypeDef *I2Cx);
+const i2c_wiring_t *I2C_get_wiring(I2C_TypeDef *I2Cx);
+I2C_Status I2C_set_target(I2C_TypeDef *I2Cx, struct i2c_target *t);
+struct i2c_target *I2C_get_target(I2C_TypeDef *I2Cx);
+I2C_Status I2C_get_stats(I2C_TypeDef *I2Cx, i2c_bus_stats_t *stats);
+#ifdef I2C_INSTRUMENT
+I2C_Status I2C_instr_snapshot(I2C_TypeDef *I2Cx, i2c_instr_snapshot_t *snap);
+I2C_Status I2C_instr_clear(I2C_TypeDef *I2Cx);
+#endif
 
 #endif /* I2C_H */
\ No newline at end of file
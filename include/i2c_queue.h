@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file    i2c_queue.h
+ * @author  Loren Snow
+ * @brief   I2C transaction queue header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef I2C_QUEUE_H
+#define I2C_QUEUE_H
+
+#include "i2c.h"
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+/**
+ * @brief   Transaction priorities. Queued transactions of a higher priority always start before
+ *          those of a lower one; within a priority they start in submission order.
+ */
+typedef enum
+{
+    I2C_PRIORITY_HIGH,   ///< latency-critical, e.g. sensor reads in a control loop
+    I2C_PRIORITY_NORMAL,
+    I2C_PRIORITY_BULK,   ///< throughput traffic, e.g. display updates
+    I2C_PRIORITY_COUNT,
+} I2C_Priority;
+
+/**
+ * @brief   Per-device counters, updated when each of the device's transactions completes.
+ * @note    Times are DWT cycles (see dwt_init). Latency runs from submission to completion; bus
+ *          time from the start on the bus to completion, so bytes / busy_cycles is the device's
+ *          throughput and wait_cycles - busy_cycles the time it spent queued.
+ */
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t errors;        ///< transactions that completed with a status other than I2C_OK
+    uint32_t bytes;         ///< bytes written and read by successful transactions
+    uint32_t wait_cycles;   ///< sum of submission-to-completion latencies
+    uint32_t busy_cycles;   ///< sum of time on the bus
+    uint32_t max_latency;   ///< worst submission-to-completion latency
+} i2c_device_stats_t;
+
+/**
+ * @brief   A queued transaction. Allocated by the caller (usually statically) and owned by the
+ *          queue from i2c_queue_submit until its callback runs.
+ * @note    With tx and rx both set the transaction is a write, repeated START and read; with only
+ *          one set it goes in that direction.
+ */
+typedef struct i2c_txn
+{
+    uint16_t addr;               ///< target's 7 or 10-bit address
+    const uint8_t *tx;           ///< bytes to send, or NULL
+    uint32_t tx_len;
+    uint8_t *rx;                 ///< where to put received bytes, or NULL
+    uint32_t rx_len;
+    I2C_Priority priority;
+    uint8_t use_dma;             ///< 1 to move the bytes of a one-direction transaction with DMA
+    i2c_callback_t cb;           ///< called from interrupt context when the transaction ends, or NULL
+    void *ctx;                   ///< passed back to cb
+    i2c_device_stats_t *stats;   ///< device counters to update, or NULL
+
+    /* owned by the queue */
+    struct i2c_txn *next;
+    uint32_t submitted_at;
+    uint32_t started_at;
+    I2C_Status status;           ///< why the transaction couldn't be started, until cb is called
+} i2c_txn_t;
+
+/**
+ * @brief   Transaction queue for one I2C instance. Allocated by the caller.
+ */
+typedef struct
+{
+    I2C_TypeDef *I2Cx;
+    i2c_txn_t *head[I2C_PRIORITY_COUNT];
+    i2c_txn_t *tail[I2C_PRIORITY_COUNT];
+    i2c_txn_t *volatile active;  ///< transaction on the bus, or NULL
+} i2c_queue_t;
+
+void i2c_queue_init(i2c_queue_t *q, I2C_TypeDef *I2Cx);
+I2C_Status i2c_queue_submit(i2c_queue_t *q, i2c_txn_t *txn);
+void i2c_queue_poll(i2c_queue_t *q);
+uint8_t i2c_queue_idle(const i2c_queue_t *q);
+
+#endif /* I2C_QUEUE_H */
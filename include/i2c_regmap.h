@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * @file    i2c_regmap.h
+ * @author  Loren Snow
+ * @brief   Cached I2C device register map header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef I2C_REGMAP_H
+#define I2C_REGMAP_H
+
+#include "i2c.h"
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+#define I2C_REGMAP_WORDS(regs) (((regs) + 31U) / 32U) ///< length of a per-register bitmap, in words
+
+/**
+ * @brief   Describes a device with 8-bit register addresses that auto-increment on multi-byte
+ *          accesses. The arrays are allocated by the caller (usually statically).
+ */
+typedef struct
+{
+    I2C_TypeDef *I2Cx;                 ///< initialized I2C instance the device is on
+    uint16_t addr;                     ///< device's 7 or 10-bit address
+    uint16_t size;                     ///< number of registers, starting at 0 (at most 256)
+    uint8_t *cache;                    ///< size bytes of cached register values
+    uint32_t *valid;                   ///< I2C_REGMAP_WORDS(size) words: cache holds the register
+    uint32_t *dirty;                   ///< I2C_REGMAP_WORDS(size) words: cache differs from the device
+    const uint32_t *volatile_regs;     ///< I2C_REGMAP_WORDS(size) words of registers never cached, or NULL
+} i2c_regmap_config_t;
+
+/**
+ * @brief   Register map state. Allocated by the caller.
+ */
+typedef struct
+{
+    const i2c_regmap_config_t *cfg;
+    uint8_t cache_only;                ///< 1 while writes only update the cache (see i2c_regmap_sync)
+} i2c_regmap_t;
+
+void i2c_regmap_init(i2c_regmap_t *m, const i2c_regmap_config_t *cfg);
+I2C_Status i2c_regmap_read(i2c_regmap_t *m, uint8_t reg, uint8_t *data, uint32_t len);
+I2C_Status i2c_regmap_write(i2c_regmap_t *m, uint8_t reg, const uint8_t *data, uint32_t len);
+I2C_Status i2c_regmap_update_bits(i2c_regmap_t *m, uint8_t reg, uint8_t mask, uint8_t value);
+void i2c_regmap_cache_only(i2c_regmap_t *m, uint8_t enable);
+I2C_Status i2c_regmap_sync(i2c_regmap_t *m);
+void i2c_regmap_invalidate(i2c_regmap_t *m);
+
+#endif /* I2C_REGMAP_H */
@@ -0,0 +1,100 @@
+/**
+ ******************************************************************************
+ * @file    i2c_target.h
+ * @author  Loren Snow
+ * @brief   I2C target mode header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef I2C_TARGET_H
+#define I2C_TARGET_H
+
+#include "i2c.h"
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+/**
+ * @brief   A range of registers the host may write. Registers outside every region are
+ *          read-only; host writes to them are dropped.
+ */
+typedef struct
+{
+    uint8_t first; ///< first writable register
+    uint8_t last;  ///< last writable register (inclusive)
+} i2c_target_region_t;
+
+/**
+ * @brief   Called from the event interrupt when a host write to the register file ends.
+ * @note    first is the register the write started at and len the number of data bytes the host
+ *          sent, including any dropped for landing on read-only registers. addr is the own address
+ *          the host used (OA1 or the matching OA2).
+ */
+typedef void (*i2c_target_write_cb_t)(uint8_t first, uint16_t len, uint16_t addr, void *ctx);
+
+/**
+ * @brief   Target mode setup for one I2C instance.
+ */
+typedef struct
+{
+    I2C_Mode mode;                        ///< bus speed, for the data setup time in TIMINGR
+    uint16_t own_addr;                    ///< OA1: 7 or 10-bit address
+    uint8_t alt_addr;                     ///< OA2: second 7-bit address, or 0 for none
+    uint8_t alt_mask;                     ///< number of low bits of alt_addr not compared (0-7)
+    uint8_t *regs;                        ///< register file
+    uint16_t size;                        ///< number of registers (1-256)
+    const i2c_target_region_t *regions;   ///< writable regions, or NULL if the file is read-only
+    uint8_t region_count;
+    i2c_target_write_cb_t on_write;       ///< called when a host write ends, or NULL
+    void *ctx;                            ///< passed back to on_write
+    uint8_t wake_from_stop;               ///< 1 to run I2CCLK from HSI and wake from Stop on an address match
+} i2c_target_config_t;
+
+/**
+ * @brief   State of an instance in target mode. Allocated by the caller.
+ */
+typedef struct i2c_target
+{
+    I2C_TypeDef *I2Cx;
+    const i2c_target_config_t *cfg;
+    DMA_Channel_TypeDef *dma;   ///< channel feeding TXDR, or NULL to feed it from the interrupt
+    uint16_t addr;              ///< own address the current transfer matched
+    uint8_t ptr;                ///< register pointer
+    uint8_t transmitting;       ///< 1 while the host is reading
+    uint8_t ptr_pending;        ///< 1 until the pointer byte of a host write has arrived
+    uint16_t rx_count;          ///< data bytes received in the current host write
+    uint16_t armed;             ///< bytes the DMA channel was last loaded with
+    uint32_t loaded;            ///< bytes moved to TXDR in the current host read, before the last load
+    uint32_t errors;            ///< phases cut short by a bus error, lost arbitration or SCL timeout
+    I2C_Status error;           ///< the last of those: I2C_BERR, I2C_ARLO or I2C_TIMEOUT; I2C_OK if none
+} i2c_target_t;
+
+I2C_Status i2c_target_init(i2c_target_t *t, I2C_TypeDef *I2Cx, const i2c_target_config_t *cfg);
+void i2c_target_disable(i2c_target_t *t);
+I2C_Status i2c_target_stop(i2c_target_t *t);
+void i2c_target_irq(i2c_target_t *t);
+
+#endif /* I2C_TARGET_H */
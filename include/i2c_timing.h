@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @file    i2c_timing.h
+ * @author  Loren Snow
+ * @brief   I2C timing (TIMINGR) calculation header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef I2C_TIMING_H
+#define I2C_TIMING_H
+
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+/**
+ * @brief   Builds a TIMINGR value from its fields. Usable in constant expressions, so timings for
+ *          a known kernel clock can be fixed at build time.
+ */
+#define I2C_TIMINGR(presc, scldel, sdadel, sclh, scll)                                               \
+    ((((uint32_t)(presc) & 0xFU) << I2C_TIMINGR_PRESC_Pos) |                                         \
+     (((uint32_t)(scldel) & 0xFU) << I2C_TIMINGR_SCLDEL_Pos) |                                       \
+     (((uint32_t)(sdadel) & 0xFU) << I2C_TIMINGR_SDADEL_Pos) |                                       \
+     (((uint32_t)(sclh) & 0xFFU) << I2C_TIMINGR_SCLH_Pos) | (((uint32_t)(scll) & 0xFFU) << I2C_TIMINGR_SCLL_Pos))
+
+/* reference manual tables 148-150 (timing settings for fI2CCLK = 8, 16 and 48 MHz) */
+#define I2C_TIMINGR_8MHZ_100KHZ I2C_TIMINGR(0x1, 0x4, 0x2, 0x0F, 0x13)  ///< 8 MHz, 100 kHz
+#define I2C_TIMINGR_8MHZ_400KHZ I2C_TIMINGR(0x0, 0x3, 0x1, 0x03, 0x09)  ///< 8 MHz, 400 kHz
+#define I2C_TIMINGR_8MHZ_500KHZ I2C_TIMINGR(0x0, 0x1, 0x0, 0x03, 0x06)  ///< 8 MHz, 500 kHz (fastest Fm+)
+#define I2C_TIMINGR_16MHZ_100KHZ I2C_TIMINGR(0x3, 0x4, 0x2, 0x0F, 0x13) ///< 16 MHz, 100 kHz
+#define I2C_TIMINGR_16MHZ_400KHZ I2C_TIMINGR(0x1, 0x3, 0x2, 0x03, 0x09) ///< 16 MHz, 400 kHz
+#define I2C_TIMINGR_16MHZ_1MHZ I2C_TIMINGR(0x0, 0x2, 0x0, 0x02, 0x04)   ///< 16 MHz, 1 MHz
+#define I2C_TIMINGR_48MHZ_100KHZ I2C_TIMINGR(0xB, 0x4, 0x2, 0x0F, 0x13) ///< 48 MHz, 100 kHz
+#define I2C_TIMINGR_48MHZ_400KHZ I2C_TIMINGR(0x5, 0x3, 0x3, 0x03, 0x09) ///< 48 MHz, 400 kHz
+#define I2C_TIMINGR_48MHZ_1MHZ I2C_TIMINGR(0x5, 0x1, 0x0, 0x01, 0x03)   ///< 48 MHz, 1 MHz
+
+#ifndef I2C_TIMING_RISE_NS
+#define I2C_TIMING_RISE_NS 100 ///< SCL/SDA rise time assumed when none is given; depends on pull-ups and bus capacitance
+#endif
+
+#ifndef I2C_TIMING_FALL_NS
+#define I2C_TIMING_FALL_NS 10 ///< SCL/SDA fall time assumed when none is given
+#endif
+
+uint32_t i2c_timing_solve(uint32_t clk_hz, uint32_t bus_hz, uint32_t rise_ns, uint32_t fall_ns);
+uint32_t i2c_timing_lookup(uint32_t clk_hz, uint32_t bus_hz);
+
+#endif /* I2C_TIMING_H */
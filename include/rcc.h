@@ -39,5 +39,14 @@
 void rcc_enable_gpioa(void);
 void rcc_enable_gpiob(void);
 void rcc_enable_I2C1(void);
+void rcc_enable_dma1(void);
+void rcc_enable_dma2(void);
+void rcc_enable_tim2(void);
+void rcc_enable_tim3(void);
+void rcc_enable_tim4(void);
+void rcc_enable_tim6(void);
+void rcc_enable_tim7(void);
+void rcc_enable_syscfg(void);
+void rcc_enter_stop(void);
 
 #endif /* RCC_H */
\ No newline at end of file
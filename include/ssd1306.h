@@ -0,0 +1,79 @@
+/**
+ ******************************************************************************
+ * @file    ssd1306.h
+ * @author  Loren Snow
+ * @brief   SSD1306 and SH1106 OLED display driver header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef SSD1306_H
+#define SSD1306_H
+
+#include "i2c.h"
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+#define SSD1306_WIDTH  128U ///< panel columns
+#define SSD1306_HEIGHT 64U  ///< panel rows
+#define SSD1306_PAGES  (SSD1306_HEIGHT / 8U)
+
+/**
+ * @brief   Supported display controllers.
+ */
+typedef enum
+{
+    SSD1306_CONTROLLER_SSD1306,
+    SSD1306_CONTROLLER_SH1106, ///< 132-column RAM with the panel centered in it
+} SSD1306_Controller;
+
+/**
+ * @brief   Display state: the framebuffer and, per page, the range of columns that changed
+ *          since the last flush. Allocated by the caller.
+ * @note    The framebuffer is in the controller's layout: one byte per column of each 8-row page,
+ *          least significant bit on top.
+ */
+typedef struct
+{
+    I2C_TypeDef *I2Cx;
+    uint16_t addr;                         ///< 0x3C or 0x3D
+    SSD1306_Controller controller;
+    uint8_t fb[SSD1306_PAGES * SSD1306_WIDTH];
+    uint8_t dirty_first[SSD1306_PAGES];    ///< first changed column of each page
+    uint8_t dirty_last[SSD1306_PAGES];     ///< last changed column; below dirty_first when clean
+} ssd1306_t;
+
+I2C_Status ssd1306_init(ssd1306_t *d, I2C_TypeDef *I2Cx, uint16_t addr, SSD1306_Controller controller);
+I2C_Status ssd1306_display_on(ssd1306_t *d, uint8_t on);
+I2C_Status ssd1306_set_contrast(ssd1306_t *d, uint8_t contrast);
+void ssd1306_clear(ssd1306_t *d);
+void ssd1306_set_pixel(ssd1306_t *d, uint8_t x, uint8_t y, uint8_t on);
+void ssd1306_fill_rect(ssd1306_t *d, uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t on);
+void ssd1306_write_columns(ssd1306_t *d, uint8_t x, uint8_t page, const uint8_t *cols, uint8_t len);
+void ssd1306_invalidate(ssd1306_t *d);
+I2C_Status ssd1306_flush(ssd1306_t *d);
+
+#endif /* SSD1306_H */
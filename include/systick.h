@@ -37,10 +37,15 @@
 #include <stdint.h>
 
 #define CTRL_ENABLE (1U << 0)     ///< enable pin
+#define CTRL_TICKINT (1U << 1)    ///< interrupt on reaching 0
 #define CTRL_CLCKSRC (1U << 2)    ///< clock source
 #define CTRL_COUNTFLAG (1U << 16) ///< count flag
-#define ONE_MSEC_LOAD 8000        ///< MCU frequency is 8Mhz
+#define SYSTICK_HZ 1000U          ///< tick rate; one interrupt per millisecond
 
+void systick_init(void);
+uint64_t systick_millis(void);
+uint64_t systick_micros(void);
 void systick_delay_ms(uint32_t delay);
+void systick_delay_us(uint32_t delay);
 
 #endif /* SYSTICK_H */
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+ ******************************************************************************
+ * @file    tim.h
+ * @author  Loren Snow
+ * @brief   Timer header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef TIM_H
+#define TIM_H
+
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+uint32_t tim_get_clock(TIM_TypeDef *TIMx);
+uint32_t tim_set_update_rate(TIM_TypeDef *TIMx, uint32_t rate_hz);
+DMA_Channel_TypeDef *tim_update_dma_channel(TIM_TypeDef *TIMx);
+void tim_enable_update_dma(TIM_TypeDef *TIMx);
+void tim_start(TIM_TypeDef *TIMx);
+void tim_stop(TIM_TypeDef *TIMx);
+
+#endif /* TIM_H */
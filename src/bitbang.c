@@ -0,0 +1,552 @@
+/**
+ ******************************************************************************
+ * @file    bitbang.c
+ * @author  Loren Snow
+ * @brief   Cycle-timed bit-banged protocol source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "bitbang.h"
+#include "dwt.h"
+
+/*
+ * All timing is measured against absolute DWT cycle-count deadlines rather than counted delay
+ * loops, so the time spent in the loop bodies doesn't accumulate into the bit periods. Timings
+ * are computed from BITBANG_CORE_CLOCK_HZ at compile time and assume the core actually runs at
+ * that frequency.
+ */
+
+#define WS2812_T0H BITBANG_NS(400)   ///< high time of a 0 bit
+#define WS2812_T1H BITBANG_NS(800)   ///< high time of a 1 bit
+#define WS2812_TBIT BITBANG_NS(1250) ///< bit period (800 kHz)
+#define WS2812_LATCH BITBANG_US(280) ///< low time that latches the frame (WS2812B needs > 280 us)
+#define WS2812_MIN_TBIT 40           ///< fewest cycles per bit the inner loop can keep up with
+
+#define ONEWIRE_RESET_LOW BITBANG_US(480)
+#define ONEWIRE_PRESENCE_SAMPLE BITBANG_US(70)
+#define ONEWIRE_RESET_SLOT BITBANG_US(480)
+#define ONEWIRE_WRITE1_LOW BITBANG_US(6)
+#define ONEWIRE_WRITE0_LOW BITBANG_US(60)
+#define ONEWIRE_READ_SAMPLE BITBANG_US(15)
+#define ONEWIRE_SLOT BITBANG_US(70)
+
+#define BITBANG_I2C_STRETCH_LIMIT BITBANG_US(1000) ///< longest a target may hold SCL low
+
+/**
+ * @brief       Busy-waits until the cycle counter reaches a deadline.
+ * @param[in]   deadline: DWT cycle count to wait for
+ */
+static inline void bitbang_wait_until(uint32_t deadline)
+{
+    while ((int32_t)(DWT->CYCCNT - deadline) < 0)
+    {
+    }
+}
+
+/**
+ * @brief       Drives a pin high (or releases it, for open-drain pins) with one BSRR store.
+ */
+static inline void bitbang_high(const bitbang_pin_t *pin)
+{
+    pin->GPIOx->BSRR = pin->mask;
+}
+
+/**
+ * @brief       Drives a pin low with one BRR store.
+ */
+static inline void bitbang_low(const bitbang_pin_t *pin)
+{
+    pin->GPIOx->BRR = pin->mask;
+}
+
+/**
+ * @brief       Reads a pin's input level (0 or 1).
+ */
+static inline uint8_t bitbang_level(const bitbang_pin_t *pin)
+{
+    return (pin->GPIOx->IDR & pin->mask) ? 1 : 0;
+}
+
+/**
+ * @brief   Starts the DWT cycle counter all bit-bang timing is measured with.
+ */
+void bitbang_init(void)
+{
+    dwt_init();
+}
+
+/**
+ * @brief       Sends pixel data to a WS2812 (NeoPixel) LED strip at 800 kHz.
+ * @note        The pin must be a push-pull output. Interrupts are masked while the bits go out
+ *              (30 us per LED) since a late edge corrupts the frame, then the line is held low for
+ *              the latch time with interrupts enabled.
+ * @param[in]   pin: data pin
+ * @param[in]   grb: 3 bytes per LED in green, red, blue order
+ * @param[in]   len: number of bytes
+ * @return      GPIO_OK, or GPIO_INVALID if BITBANG_CORE_CLOCK_HZ is too low to meet the timing
+ *              (about 32 MHz is needed)
+ */
+GPIO_Status bitbang_ws2812_write(const bitbang_pin_t *pin, const uint8_t *grb, uint32_t len)
+{
+    GPIO_TypeDef *port = pin->GPIOx;
+    uint16_t mask = pin->mask;
+    uint32_t primask;
+    uint32_t start;
+
+    if (WS2812_TBIT < WS2812_MIN_TBIT)
+    {
+        return GPIO_INVALID;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    start = DWT->CYCCNT + WS2812_TBIT;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint8_t byte = grb[i];
+
+        for (uint8_t bit = 0x80; bit; bit >>= 1)
+        {
+            bitbang_wait_until(start);
+            port->BSRR = mask;
+            bitbang_wait_until(start + ((byte & bit) ? WS2812_T1H : WS2812_T0H));
+            port->BRR = mask;
+            start += WS2812_TBIT;
+        }
+    }
+
+    bitbang_wait_until(start);
+    __set_PRIMASK(primask);
+
+    bitbang_wait_until(DWT->CYCCNT + WS2812_LATCH);
+
+    return GPIO_OK;
+}
+
+/**
+ * @brief       Sets a 1-Wire pin to open-drain output and releases the bus.
+ * @note        The bus needs an external pull-up (typically 4.7k).
+ * @param[in]   pin: 1-Wire data pin
+ */
+void bitbang_onewire_init(const bitbang_pin_t *pin)
+{
+    static const gpio_config_t cfg = {OUTPUT, OPEN_DRAIN, MEDIUM_SPEED, NONE, AF0};
+
+    bitbang_high(pin);
+    gpio_configure(pin->GPIOx, pin->mask, &cfg);
+}
+
+/**
+ * @brief       Sends a 1-Wire reset pulse and listens for a presence pulse.
+ * @param[in]   pin: 1-Wire data pin
+ * @return      1 if at least one device answered, 0 otherwise
+ */
+uint8_t bitbang_onewire_reset(const bitbang_pin_t *pin)
+{
+    uint32_t primask;
+    uint32_t start;
+    uint8_t present;
+
+    start = DWT->CYCCNT;
+    bitbang_low(pin);
+    bitbang_wait_until(start + ONEWIRE_RESET_LOW); // a late release only lengthens the pulse
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    start = DWT->CYCCNT;
+    bitbang_high(pin);
+    bitbang_wait_until(start + ONEWIRE_PRESENCE_SAMPLE);
+    present = !bitbang_level(pin);
+    __set_PRIMASK(primask);
+
+    bitbang_wait_until(start + ONEWIRE_RESET_SLOT);
+
+    return present;
+}
+
+/**
+ * @brief       Runs one 1-Wire time slot. Writing a 1 and reading a bit are the same slot.
+ * @param[in]   pin: 1-Wire data pin
+ * @param[in]   bit: bit to write (1 to read)
+ * @return      bus level sampled in the slot
+ */
+static uint8_t bitbang_onewire_slot(const bitbang_pin_t *pin, uint8_t bit)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t start;
+    uint8_t level = 0;
+
+    __disable_irq();
+
+    start = DWT->CYCCNT;
+    bitbang_low(pin);
+    bitbang_wait_until(start + (bit ? ONEWIRE_WRITE1_LOW : ONEWIRE_WRITE0_LOW));
+    bitbang_high(pin);
+
+    if (bit)
+    {
+        bitbang_wait_until(start + ONEWIRE_READ_SAMPLE);
+        level = bitbang_level(pin);
+    }
+
+    __set_PRIMASK(primask);
+
+    bitbang_wait_until(start + ONEWIRE_SLOT);
+
+    return level;
+}
+
+/**
+ * @brief       Writes a byte to the 1-Wire bus, LSB first.
+ * @param[in]   pin: 1-Wire data pin
+ * @param[in]   byte: byte to write
+ */
+void bitbang_onewire_write(const bitbang_pin_t *pin, uint8_t byte)
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        bitbang_onewire_slot(pin, byte & 1U);
+        byte >>= 1;
+    }
+}
+
+/**
+ * @brief       Reads a byte from the 1-Wire bus, LSB first.
+ * @param[in]   pin: 1-Wire data pin
+ */
+uint8_t bitbang_onewire_read(const bitbang_pin_t *pin)
+{
+    uint8_t byte = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        byte |= (uint8_t)(bitbang_onewire_slot(pin, 1) << i);
+    }
+
+    return byte;
+}
+
+/**
+ * @brief       Configures the software SPI pins: SCK and MOSI push-pull outputs, MISO input.
+ * @param[in]   spi: bus to set up
+ */
+void bitbang_spi_init(const bitbang_spi_t *spi)
+{
+    static const gpio_config_t out = {OUTPUT, PUSH_PULL, HIGH_SPEED, NONE, AF0};
+    static const gpio_config_t in = {INPUT, PUSH_PULL, LOW_SPEED, NONE, AF0};
+
+    bitbang_low(&spi->sck); // mode 0: clock idles low
+    gpio_configure(spi->sck.GPIOx, spi->sck.mask, &out);
+    gpio_configure(spi->mosi.GPIOx, spi->mosi.mask, &out);
+    gpio_configure(spi->miso.GPIOx, spi->miso.mask, &in);
+}
+
+/**
+ * @brief       Exchanges bytes on the software SPI bus (mode 0, MSB first).
+ * @param[in]   spi: bus
+ * @param[in]   tx: bytes to send, or NULL to send 0xFF
+ * @param[out]  rx: received bytes, or NULL to discard them
+ * @param[in]   len: number of bytes
+ */
+void bitbang_spi_transfer(const bitbang_spi_t *spi, const uint8_t *tx, uint8_t *rx, uint32_t len)
+{
+    uint32_t t = DWT->CYCCNT;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint8_t out = tx ? tx[i] : 0xFF;
+        uint8_t in = 0;
+
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            if (out & 0x80)
+            {
+                bitbang_high(&spi->mosi);
+            }
+            else
+            {
+                bitbang_low(&spi->mosi);
+            }
+            out <<= 1;
+
+            t += spi->half_period;
+            bitbang_wait_until(t);
+            bitbang_high(&spi->sck); // target samples MOSI, we sample MISO
+            in = (uint8_t)((in << 1) | bitbang_level(&spi->miso));
+
+            t += spi->half_period;
+            bitbang_wait_until(t);
+            bitbang_low(&spi->sck);
+        }
+
+        if (rx)
+        {
+            rx[i] = in;
+        }
+    }
+}
+
+/**
+ * @brief       Waits half a software I2C clock period.
+ */
+static void bitbang_i2c_delay(const bitbang_i2c_t *i2c)
+{
+    bitbang_wait_until(DWT->CYCCNT + i2c->half_period);
+}
+
+/**
+ * @brief       Releases SCL and waits, for a bounded time, for any target stretching the clock.
+ * @return      1 once SCL is high, 0 if a target held it low past BITBANG_I2C_STRETCH_LIMIT
+ */
+static uint8_t bitbang_i2c_scl_high(const bitbang_i2c_t *i2c)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    bitbang_high(&i2c->scl);
+
+    while (!bitbang_level(&i2c->scl))
+    {
+        if (DWT->CYCCNT - start >= BITBANG_I2C_STRETCH_LIMIT)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief       START condition: SDA falls while SCL is high.
+ * @return      0 if SCL never went high
+ */
+static uint8_t bitbang_i2c_start(const bitbang_i2c_t *i2c)
+{
+    bitbang_high(&i2c->sda);
+    if (!bitbang_i2c_scl_high(i2c))
+    {
+        return 0;
+    }
+    bitbang_i2c_delay(i2c);
+    bitbang_low(&i2c->sda);
+    bitbang_i2c_delay(i2c);
+    bitbang_low(&i2c->scl);
+
+    return 1;
+}
+
+/**
+ * @brief       STOP condition: SDA rises while SCL is high.
+ * @return      0 if SCL never went high
+ */
+static uint8_t bitbang_i2c_stop(const bitbang_i2c_t *i2c)
+{
+    bitbang_low(&i2c->sda);
+    bitbang_i2c_delay(i2c);
+    if (!bitbang_i2c_scl_high(i2c))
+    {
+        return 0;
+    }
+    bitbang_i2c_delay(i2c);
+    bitbang_high(&i2c->sda);
+    bitbang_i2c_delay(i2c);
+
+    return 1;
+}
+
+/**
+ * @brief       Abandons a transfer a target stalled by holding SCL: releases both lines so the
+ *              bus floats high once the target lets go.
+ */
+static void bitbang_i2c_abort(const bitbang_i2c_t *i2c)
+{
+    bitbang_high(&i2c->sda);
+    bitbang_high(&i2c->scl);
+}
+
+/**
+ * @brief       Clocks one bit out (or, with bit = 1, lets the target drive SDA) and samples SDA.
+ * @param[out]  level: SDA level while SCL was high
+ * @return      0 if a target held SCL low past the stretch limit
+ */
+static uint8_t bitbang_i2c_bit(const bitbang_i2c_t *i2c, uint8_t bit, uint8_t *level)
+{
+    if (bit)
+    {
+        bitbang_high(&i2c->sda);
+    }
+    else
+    {
+        bitbang_low(&i2c->sda);
+    }
+
+    bitbang_i2c_delay(i2c);
+    if (!bitbang_i2c_scl_high(i2c))
+    {
+        return 0;
+    }
+    *level = bitbang_level(&i2c->sda);
+    bitbang_i2c_delay(i2c);
+    bitbang_low(&i2c->scl);
+
+    return 1;
+}
+
+/**
+ * @brief       Sends a byte, MSB first, and reads the target's acknowledge.
+ * @return      BITBANG_I2C_OK if the target ACKed, BITBANG_I2C_NACK or BITBANG_I2C_TIMEOUT
+ */
+static Bitbang_I2C_Status bitbang_i2c_write_byte(const bitbang_i2c_t *i2c, uint8_t byte)
+{
+    uint8_t level;
+
+    for (uint8_t bit = 0x80; bit; bit >>= 1)
+    {
+        if (!bitbang_i2c_bit(i2c, (byte & bit) ? 1 : 0, &level))
+        {
+            return BITBANG_I2C_TIMEOUT;
+        }
+    }
+
+    if (!bitbang_i2c_bit(i2c, 1, &level))
+    {
+        return BITBANG_I2C_TIMEOUT;
+    }
+
+    return level ? BITBANG_I2C_NACK : BITBANG_I2C_OK;
+}
+
+/**
+ * @brief       Reads a byte, MSB first, and answers with ACK or NACK.
+ * @param[out]  byte: the byte read
+ * @return      BITBANG_I2C_OK or BITBANG_I2C_TIMEOUT
+ */
+static Bitbang_I2C_Status bitbang_i2c_read_byte(const bitbang_i2c_t *i2c, uint8_t *byte, uint8_t ack)
+{
+    uint8_t level;
+
+    *byte = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (!bitbang_i2c_bit(i2c, 1, &level))
+        {
+            return BITBANG_I2C_TIMEOUT;
+        }
+        *byte = (uint8_t)((*byte << 1) | level);
+    }
+
+    return bitbang_i2c_bit(i2c, ack ? 0 : 1, &level) ? BITBANG_I2C_OK : BITBANG_I2C_TIMEOUT;
+}
+
+/**
+ * @brief       Ends a transfer: STOP, or letting go of the bus if a target stalled it.
+ * @param[in]   status: how the transfer went so far
+ * @return      status, or BITBANG_I2C_TIMEOUT if the STOP itself was stalled
+ */
+static Bitbang_I2C_Status bitbang_i2c_finish(const bitbang_i2c_t *i2c, Bitbang_I2C_Status status)
+{
+    if ((status != BITBANG_I2C_TIMEOUT) && bitbang_i2c_stop(i2c))
+    {
+        return status;
+    }
+
+    bitbang_i2c_abort(i2c);
+
+    return BITBANG_I2C_TIMEOUT;
+}
+
+/**
+ * @brief       Sets both software I2C pins to open-drain outputs and releases the bus.
+ * @note        The bus needs external pull-ups.
+ * @param[in]   i2c: bus to set up
+ */
+void bitbang_i2c_init(const bitbang_i2c_t *i2c)
+{
+    static const gpio_config_t cfg = {OUTPUT, OPEN_DRAIN, MEDIUM_SPEED, NONE, AF0};
+
+    bitbang_high(&i2c->scl);
+    bitbang_high(&i2c->sda);
+    gpio_configure(i2c->scl.GPIOx, i2c->scl.mask, &cfg);
+    gpio_configure(i2c->sda.GPIOx, i2c->sda.mask, &cfg);
+}
+
+/**
+ * @brief       Writes bytes to a 7-bit target on the software I2C bus.
+ * @note        A target may stretch the clock for up to BITBANG_I2C_STRETCH_LIMIT at each bit;
+ *              past that the transfer is abandoned and both lines released.
+ * @param[in]   i2c: bus
+ * @param[in]   addr: 7-bit target address
+ * @param[in]   data: bytes to send
+ * @param[in]   len: number of bytes
+ * @return      BITBANG_I2C_OK if the address and every byte were ACKed, BITBANG_I2C_NACK if one
+ *              wasn't, or BITBANG_I2C_TIMEOUT if a target held SCL low too long
+ */
+Bitbang_I2C_Status bitbang_i2c_write(const bitbang_i2c_t *i2c, uint8_t addr, const uint8_t *data, uint32_t len)
+{
+    Bitbang_I2C_Status status = BITBANG_I2C_TIMEOUT;
+
+    if (bitbang_i2c_start(i2c))
+    {
+        status = bitbang_i2c_write_byte(i2c, (uint8_t)(addr << 1));
+    }
+
+    for (uint32_t i = 0; (status == BITBANG_I2C_OK) && (i < len); i++)
+    {
+        status = bitbang_i2c_write_byte(i2c, data[i]);
+    }
+
+    return bitbang_i2c_finish(i2c, status);
+}
+
+/**
+ * @brief       Reads bytes from a 7-bit target on the software I2C bus.
+ * @note        Clock stretching is bounded as for bitbang_i2c_write.
+ * @param[in]   i2c: bus
+ * @param[in]   addr: 7-bit target address
+ * @param[out]  data: received bytes
+ * @param[in]   len: number of bytes
+ * @return      BITBANG_I2C_OK, BITBANG_I2C_NACK if the target didn't ACK its address, or
+ *              BITBANG_I2C_TIMEOUT if a target held SCL low too long
+ */
+Bitbang_I2C_Status bitbang_i2c_read(const bitbang_i2c_t *i2c, uint8_t addr, uint8_t *data, uint32_t len)
+{
+    Bitbang_I2C_Status status = BITBANG_I2C_TIMEOUT;
+
+    if (bitbang_i2c_start(i2c))
+    {
+        status = bitbang_i2c_write_byte(i2c, (uint8_t)((addr << 1) | 1U));
+    }
+
+    for (uint32_t i = 0; (status == BITBANG_I2C_OK) && (i < len); i++)
+    {
+        status = bitbang_i2c_read_byte(i2c, &data[i], i + 1 < len); // NACK the last byte
+    }
+
+    return bitbang_i2c_finish(i2c, status);
+}
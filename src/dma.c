@@ -0,0 +1,277 @@
+/**
+ ******************************************************************************
+ * @file    dma.c
+ * @author  Loren Snow
+ * @brief   DMA source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "dma.h"
+#include "bitband.h"
+
+#define DMA_CHANNEL_COUNT 12 ///< DMA1 channels 1-7, then DMA2 channels 1-5
+
+static DMA_Channel_TypeDef *const dma_channels[DMA_CHANNEL_COUNT] = {
+    DMA1_Channel1, DMA1_Channel2, DMA1_Channel3, DMA1_Channel4, DMA1_Channel5, DMA1_Channel6,
+    DMA1_Channel7, DMA2_Channel1, DMA2_Channel2, DMA2_Channel3, DMA2_Channel4, DMA2_Channel5,
+};
+
+static const IRQn_Type dma_irqs[DMA_CHANNEL_COUNT] = {
+    DMA1_Channel1_IRQn, DMA1_Channel2_IRQn, DMA1_Channel3_IRQn, DMA1_Channel4_IRQn,
+    DMA1_Channel5_IRQn, DMA1_Channel6_IRQn, DMA1_Channel7_IRQn, DMA2_Channel1_IRQn,
+    DMA2_Channel2_IRQn, DMA2_Channel3_IRQn, DMA2_Channel4_IRQn, DMA2_Channel5_IRQn,
+};
+
+static dma_callback_t dma_callbacks[DMA_CHANNEL_COUNT];
+static void *dma_contexts[DMA_CHANNEL_COUNT];
+
+/**
+ * @brief       Finds a channel's position in the channel tables.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ * @return      index into dma_channels, or DMA_CHANNEL_COUNT if ch isn't a DMA channel
+ */
+static uint8_t dma_channel_index(DMA_Channel_TypeDef *ch)
+{
+    uint8_t i = 0;
+
+    while ((i < DMA_CHANNEL_COUNT) && (dma_channels[i] != ch))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+/**
+ * @brief       Returns the controller a channel belongs to and the shift of its flags in ISR/IFCR.
+ * @param[in]   idx: index into dma_channels
+ * @param[out]  shift: bit position of the channel's GIF flag
+ */
+static DMA_TypeDef *dma_controller(uint8_t idx, uint8_t *shift)
+{
+    if (idx < 7)
+    {
+        *shift = idx * 4;
+        return DMA1;
+    }
+
+    *shift = (idx - 7) * 4;
+    return DMA2;
+}
+
+/**
+ * @brief       Disables a channel and loads a new transfer into it, without starting it.
+ * @note        The controller's clock must already be enabled (rcc_enable_dma1/rcc_enable_dma2).
+ *              If a callback is set for the channel its interrupt is enabled in the NVIC.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ * @param[in]   periph: peripheral register address (CPAR)
+ * @param[in]   mem: memory address (CMAR)
+ * @param[in]   count: number of items to transfer (CNDTR)
+ * @param[in]   ccr: DMA_CCR_* configuration bits, without DMA_CCR_EN
+ * @return      DMA_OK, or DMA_INVALID if ch isn't a DMA channel (nothing is written)
+ */
+DMA_Status dma_channel_configure(DMA_Channel_TypeDef *ch, volatile void *periph, const void *mem, uint16_t count,
+                                 uint32_t ccr)
+{
+    uint8_t idx = dma_channel_index(ch);
+    uint8_t shift;
+    DMA_TypeDef *dma;
+
+    if (idx == DMA_CHANNEL_COUNT)
+    {
+        return DMA_INVALID;
+    }
+
+    dma = dma_controller(idx, &shift);
+
+    ch->CCR = 0; // CPAR/CMAR/CNDTR can only be written with the channel disabled
+    dma->IFCR = (DMA_IFCR_CGIF1 | DMA_IFCR_CTCIF1 | DMA_IFCR_CHTIF1 | DMA_IFCR_CTEIF1) << shift;
+
+    ch->CPAR = (uint32_t)periph;
+    ch->CMAR = (uint32_t)mem;
+    ch->CNDTR = count;
+    ch->CCR = ccr & ~DMA_CCR_EN;
+
+    if (dma_callbacks[idx])
+    {
+        NVIC_EnableIRQ(dma_irqs[idx]);
+    }
+
+    return DMA_OK;
+}
+
+/**
+ * @brief       Sets the function called from a channel's interrupt.
+ * @note        Set the callback before dma_channel_configure so the interrupt gets enabled. Which
+ *              events are reported depends on the DMA_CCR_TCIE/HTIE/TEIE bits passed there.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ * @param[in]   cb: callback, or NULL for none
+ * @param[in]   ctx: passed back to cb
+ * @return      DMA_OK, or DMA_INVALID if ch isn't a DMA channel
+ */
+DMA_Status dma_channel_set_callback(DMA_Channel_TypeDef *ch, dma_callback_t cb, void *ctx)
+{
+    uint8_t idx = dma_channel_index(ch);
+
+    if (idx == DMA_CHANNEL_COUNT)
+    {
+        return DMA_INVALID;
+    }
+
+    dma_callbacks[idx] = cb;
+    dma_contexts[idx] = ctx;
+
+    return DMA_OK;
+}
+
+/**
+ * @brief       Starts a configured channel.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ */
+void dma_channel_start(DMA_Channel_TypeDef *ch)
+{
+    BITBAND_PERIPH(ch->CCR, DMA_CCR_EN_Pos) = 1;
+}
+
+/**
+ * @brief       Stops a channel. Remaining items stay in CNDTR.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ */
+void dma_channel_stop(DMA_Channel_TypeDef *ch)
+{
+    BITBAND_PERIPH(ch->CCR, DMA_CCR_EN_Pos) = 0;
+}
+
+/**
+ * @brief       Whether a channel is enabled.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ */
+uint8_t dma_channel_busy(DMA_Channel_TypeDef *ch)
+{
+    return (uint8_t)BITBAND_PERIPH(ch->CCR, DMA_CCR_EN_Pos);
+}
+
+/**
+ * @brief       Number of items a channel has left to transfer.
+ * @param[in]   ch: a defined DMA channel pointer (e.g., DMA1_Channel1)
+ */
+uint16_t dma_channel_remaining(DMA_Channel_TypeDef *ch)
+{
+    return (uint16_t)ch->CNDTR;
+}
+
+/**
+ * @brief       Common channel interrupt handler. Clears the channel's flags and reports them.
+ * @param[in]   idx: index into dma_channels
+ */
+static void dma_irq(uint8_t idx)
+{
+    uint8_t shift;
+    DMA_TypeDef *dma = dma_controller(idx, &shift);
+    uint32_t flags = (dma->ISR >> shift) & 0xFU;
+    uint32_t events = 0;
+
+    dma->IFCR = flags << shift;
+
+    if (flags & DMA_ISR_HTIF1)
+    {
+        events |= DMA_EVT_HALF;
+    }
+    if (flags & DMA_ISR_TCIF1)
+    {
+        events |= DMA_EVT_FULL;
+    }
+    if (flags & DMA_ISR_TEIF1)
+    {
+        events |= DMA_EVT_ERROR;
+    }
+
+    if (events && dma_callbacks[idx])
+    {
+        dma_callbacks[idx](events, dma_contexts[idx]);
+    }
+}
+
+void DMA1_Channel1_IRQHandler(void)
+{
+    dma_irq(0);
+}
+
+void DMA1_Channel2_IRQHandler(void)
+{
+    dma_irq(1);
+}
+
+void DMA1_Channel3_IRQHandler(void)
+{
+    dma_irq(2);
+}
+
+void DMA1_Channel4_IRQHandler(void)
+{
+    dma_irq(3);
+}
+
+void DMA1_Channel5_IRQHandler(void)
+{
+    dma_irq(4);
+}
+
+void DMA1_Channel6_IRQHandler(void)
+{
+    dma_irq(5);
+}
+
+void DMA1_Channel7_IRQHandler(void)
+{
+    dma_irq(6);
+}
+
+void DMA2_Channel1_IRQHandler(void)
+{
+    dma_irq(7);
+}
+
+void DMA2_Channel2_IRQHandler(void)
+{
+    dma_irq(8);
+}
+
+void DMA2_Channel3_IRQHandler(void)
+{
+    dma_irq(9);
+}
+
+void DMA2_Channel4_IRQHandler(void)
+{
+    dma_irq(10);
+}
+
+void DMA2_Channel5_IRQHandler(void)
+{
+    dma_irq(11);
+}
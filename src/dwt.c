@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file    dwt.c
+ * @author  Loren Snow
+ * @brief   DWT cycle counter source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "dwt.h"
+#include "system_stm32f3xx.h"
+
+/**
+ * @brief   Starts the DWT cycle counter, a free-running 32-bit count of core clock cycles.
+ * @note    Safe to call more than once. The count wraps every 2^32 cycles (about 60 s at 72 MHz),
+ *          so compare timestamps by unsigned subtraction.
+ */
+void dwt_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // enable the trace block the DWT lives in
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief   Returns the current cycle count.
+ */
+uint32_t dwt_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief       Converts microseconds to core clock cycles at the current SystemCoreClock.
+ * @param[in]   us: microseconds
+ */
+uint32_t dwt_us_to_cycles(uint32_t us)
+{
+    return (uint32_t)(((uint64_t)us * SystemCoreClock) / 1000000U);
+}
@@ -0,0 +1,214 @@
+/**
+ ******************************************************************************
+ * @file    eeprom.c
+ * @author  Loren Snow
+ * @brief   24LC-series I2C EEPROM driver source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "eeprom.h"
+#include "dwt.h"
+
+static uint32_t eeprom_header(const eeprom_t *e, uint32_t mem_addr, uint8_t *hdr, uint16_t *dev_addr);
+
+/**
+ * @brief       Describes an EEPROM and checks that it answers.
+ * @note        The I2C instance must already be initialized with I2C_init. Starts the DWT cycle
+ *              counter, which times write-cycle polling.
+ * @param[in]   e: EEPROM to initialize
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   addr: 7-bit device address with the block bits clear, e.g. 0x50
+ * @param[in]   size: capacity in bytes, at most 64 KB
+ * @param[in]   page_size: write page in bytes, a power of 2
+ * @return      I2C_OK, I2C_INVALID for a bad size or page size, or the error of the probe
+ *              (I2C_TIMEOUT if the part stays busy)
+ */
+I2C_Status eeprom_init(eeprom_t *e, I2C_TypeDef *I2Cx, uint16_t addr, uint32_t size, uint16_t page_size)
+{
+    if (!size || (size > 0x10000U) || !page_size || (page_size & (page_size - 1U)))
+    {
+        return I2C_INVALID;
+    }
+
+    e->I2Cx = I2Cx;
+    e->addr = addr;
+    e->size = size;
+    e->page_size = page_size;
+    dwt_init();
+
+    return eeprom_wait_ready(e); // may still be finishing a write from before a reset
+}
+
+/**
+ * @brief       Reads any number of bytes, as sequential reads.
+ * @note        Parts with one address byte are read one 256-byte block at a time, since the block
+ *              is part of the device address; bigger parts in a single transfer.
+ * @param[in]   e: EEPROM
+ * @param[in]   mem_addr: first byte to read
+ * @param[out]  data: where to put the bytes
+ * @param[in]   len: number of bytes
+ * @return      I2C_OK, I2C_INVALID for a range past the end of the part, or the bus error
+ */
+I2C_Status eeprom_read(const eeprom_t *e, uint32_t mem_addr, uint8_t *data, uint32_t len)
+{
+    if (mem_addr + len > e->size || mem_addr + len < mem_addr)
+    {
+        return I2C_INVALID;
+    }
+
+    while (len)
+    {
+        uint8_t hdr[2];
+        uint16_t dev_addr;
+        uint32_t hdr_len = eeprom_header(e, mem_addr, hdr, &dev_addr);
+        uint32_t n = len;
+        I2C_Status status;
+
+        if (e->size <= EEPROM_SMALL_MAX && n > 256U - (mem_addr & 0xFFU))
+        {
+            n = 256U - (mem_addr & 0xFFU);
+        }
+
+        status = I2C_write_read(e->I2Cx, dev_addr, hdr, hdr_len, data, n);
+        if (status != I2C_OK)
+        {
+            return status;
+        }
+
+        mem_addr += n;
+        data += n;
+        len -= n;
+    }
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Writes any number of bytes, one page-write burst per page touched.
+ * @note        A burst never crosses a page boundary (the part would wrap to the start of the
+ *              page). After each one the part is polled until it acknowledges again, rather than
+ *              waiting out the worst-case write time, so a page costs its actual write cycle.
+ * @param[in]   e: EEPROM
+ * @param[in]   mem_addr: first byte to write
+ * @param[in]   data: bytes to write
+ * @param[in]   len: number of bytes
+ * @return      I2C_OK, I2C_INVALID for a range past the end of the part, I2C_TIMEOUT if a write
+ *              cycle didn't end, or the bus error
+ */
+I2C_Status eeprom_write(const eeprom_t *e, uint32_t mem_addr, const uint8_t *data, uint32_t len)
+{
+    if (mem_addr + len > e->size || mem_addr + len < mem_addr)
+    {
+        return I2C_INVALID;
+    }
+
+    while (len)
+    {
+        uint8_t hdr[2];
+        uint16_t dev_addr;
+        uint32_t hdr_len = eeprom_header(e, mem_addr, hdr, &dev_addr);
+        uint32_t n = e->page_size - (mem_addr & (e->page_size - 1U));
+        I2C_Status status;
+
+        if (n > len)
+        {
+            n = len;
+        }
+
+        const i2c_segment_t segs[2] = {
+            {.data = hdr, .len = hdr_len},
+            {.data = data, .len = n},
+        };
+
+        status = I2C_write_segments(e->I2Cx, dev_addr, segs, 2);
+        if (status == I2C_OK)
+        {
+            status = eeprom_wait_ready(e);
+        }
+        if (status != I2C_OK)
+        {
+            return status;
+        }
+
+        mem_addr += n;
+        data += n;
+        len -= n;
+    }
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Waits for the part to finish its write cycle, by ACK polling.
+ * @note        The part doesn't acknowledge its address during a write cycle, so it's probed with
+ *              empty writes until one is acknowledged, for up to EEPROM_WRITE_TIMEOUT_US.
+ * @param[in]   e: EEPROM
+ * @return      I2C_OK once it's ready, I2C_TIMEOUT if it didn't become ready, or the bus error
+ */
+I2C_Status eeprom_wait_ready(const eeprom_t *e)
+{
+    uint32_t start = dwt_cycles();
+    uint32_t limit = dwt_us_to_cycles(EEPROM_WRITE_TIMEOUT_US);
+
+    while (1)
+    {
+        I2C_Status status = I2C_probe(e->I2Cx, e->addr);
+
+        if (status != I2C_NACK)
+        {
+            return status;
+        }
+        if (dwt_cycles() - start >= limit)
+        {
+            return I2C_TIMEOUT;
+        }
+    }
+}
+
+/**
+ * @brief       Builds the address bytes that select a byte of the part, and the device address
+ *              to send them to.
+ * @param[in]   e: EEPROM
+ * @param[in]   mem_addr: byte to select
+ * @param[out]  hdr: the address bytes
+ * @param[out]  dev_addr: device address, with the block bits for a small part
+ * @return      number of address bytes
+ */
+static uint32_t eeprom_header(const eeprom_t *e, uint32_t mem_addr, uint8_t *hdr, uint16_t *dev_addr)
+{
+    if (e->size <= EEPROM_SMALL_MAX)
+    {
+        *dev_addr = e->addr | (uint16_t)((mem_addr >> 8) & 0x07U);
+        hdr[0] = (uint8_t)mem_addr;
+        return 1;
+    }
+
+    *dev_addr = e->addr;
+    hdr[0] = (uint8_t)(mem_addr >> 8);
+    hdr[1] = (uint8_t)mem_addr;
+    return 2;
+}
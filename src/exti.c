@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ * @file    exti.c
+ * @author  Loren Snow
+ * @brief   EXTI source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "exti.h"
+#include "bitband.h"
+
+static exti_handler_t exti_handlers[16];
+static void *exti_contexts[16];
+
+/**
+ * @brief       Returns the NVIC interrupt serving a GPIO EXTI line.
+ * @param[in]   line: EXTI line (= pin number, 0-15)
+ */
+static IRQn_Type exti_irq(uint8_t line)
+{
+    static const IRQn_Type low_lines[5] = {EXTI0_IRQn, EXTI1_IRQn, EXTI2_TSC_IRQn, EXTI3_IRQn, EXTI4_IRQn};
+
+    if (line < 5)
+    {
+        return low_lines[line];
+    }
+
+    return (line < 10) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+/**
+ * @brief       Routes a pin to its EXTI line and enables the line's interrupt.
+ * @note        The SYSCFG clock must be enabled (rcc_enable_syscfg). EXTI line n is shared by pin n
+ *              of every port, so enabling PB3 takes line 3 away from PA3, PC3, etc.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin to watch (0-15)
+ * @param[in]   edge: rising, falling or both
+ * @param[in]   handler: called from the interrupt on every edge
+ * @param[in]   ctx: passed back to handler
+ */
+void exti_enable_pin(GPIO_TypeDef *GPIOx, uint8_t pin, EXTI_Edge edge, exti_handler_t handler, void *ctx)
+{
+    uint32_t port = ((uint32_t)GPIOx - GPIOA_BASE) >> 10; /* ports are 0x400 apart: A = 0, B = 1, ... */
+    uint8_t shift = (pin & 3) * 4;
+
+    BITBAND_PERIPH(EXTI->IMR, pin) = 0;
+
+    exti_handlers[pin] = handler;
+    exti_contexts[pin] = ctx;
+
+    SYSCFG->EXTICR[pin >> 2] = (SYSCFG->EXTICR[pin >> 2] & ~(0xFU << shift)) | (port << shift);
+    BITBAND_PERIPH(EXTI->RTSR, pin) = (edge & EXTI_RISING) ? 1 : 0;
+    BITBAND_PERIPH(EXTI->FTSR, pin) = (edge & EXTI_FALLING) ? 1 : 0;
+
+    EXTI->PR = 1U << pin; // drop any edge seen before the handler was set
+    BITBAND_PERIPH(EXTI->IMR, pin) = 1;
+    NVIC_EnableIRQ(exti_irq(pin));
+}
+
+/**
+ * @brief       Masks a pin's EXTI line. Other lines sharing the NVIC interrupt keep working.
+ * @param[in]   pin: the pin (= EXTI line, 0-15)
+ */
+void exti_disable_pin(uint8_t pin)
+{
+    BITBAND_PERIPH(EXTI->IMR, pin) = 0;
+    EXTI->PR = 1U << pin;
+}
+
+/**
+ * @brief       Services the pending lines in a range.
+ * @note        PR is write-1-to-clear, so it is written directly rather than through the bit-band
+ *              alias (a bit-band write would read PR back and clear every pending line).
+ * @param[in]   first: first line served by the interrupt
+ * @param[in]   last: last line served by the interrupt
+ */
+static void exti_dispatch(uint8_t first, uint8_t last)
+{
+    for (uint8_t line = first; line <= last; line++)
+    {
+        if (EXTI->PR & EXTI->IMR & (1U << line))
+        {
+            EXTI->PR = 1U << line;
+
+            if (exti_handlers[line])
+            {
+                exti_handlers[line](line, exti_contexts[line]);
+            }
+        }
+    }
+}
+
+void EXTI0_IRQHandler(void)
+{
+    exti_dispatch(0, 0);
+}
+
+void EXTI1_IRQHandler(void)
+{
+    exti_dispatch(1, 1);
+}
+
+void EXTI2_TSC_IRQHandler(void)
+{
+    exti_dispatch(2, 2);
+}
+
+void EXTI3_IRQHandler(void)
+{
+    exti_dispatch(3, 3);
+}
+
+void EXTI4_IRQHandler(void)
+{
+    exti_dispatch(4, 4);
+}
+
+void EXTI9_5_IRQHandler(void)
+{
+    exti_dispatch(5, 9);
+}
+
+void EXTI15_10_IRQHandler(void)
+{
+    exti_dispatch(10, 15);
+}
@@ -31,203 +31,448 @@
  */
 
 #include "gpio.h"
+#include "dwt.h"
+#include "gpio_pinmap.h"
+#include "systick.h"
+
+/* on-board pins used by this library */
+#define LED_PINS(X, P) X(P, A, 5, OUTPUT, PUSH_PULL, LOW_SPEED, NONE, AF0)
+
+#define I2C1_PINS(X, P)                                                                            \
+    X(P, B, 8, ALTERNATE, OPEN_DRAIN, LOW_SPEED, PULL_UP, AF4)                                     \
+    X(P, B, 9, ALTERNATE, OPEN_DRAIN, LOW_SPEED, PULL_UP, AF4)
+
+GPIO_PINMAP_CHECK(LED_PINS);
+GPIO_PINMAP_CHECK(I2C1_PINS);
+
+/**
+ * @brief   RAM copy of a port's configuration registers.
+ * @note    Every configuration write goes through the shadow, so nothing has to be read back over
+ *          the peripheral bus and queries are answered from RAM.
+ */
+typedef struct
+{
+    uint32_t moder;
+    uint32_t otyper;
+    uint32_t ospeedr;
+    uint32_t pupdr;
+    uint32_t afr[2];
+    uint32_t lckr; ///< LCKK and locked pins, once the port has been locked
+} gpio_shadow_t;
+
+/* reset values from the reference manual; ports A and B come up with the debug pins configured */
+static gpio_shadow_t gpio_shadows[8] = {
+    {0xA8000000U, 0, 0x0C000000U, 0x64000000U, {0, 0}, 0}, /* GPIOA */
+    {0x00000280U, 0, 0x000000C0U, 0x00000100U, {0, 0}, 0}, /* GPIOB */
+};
+
+_Static_assert((GPIO_EVENT_QUEUE_LEN & (GPIO_EVENT_QUEUE_LEN - 1)) == 0, "GPIO_EVENT_QUEUE_LEN must be a power of 2");
+
+/**
+ * @brief   Event state of one EXTI line.
+ */
+typedef struct
+{
+    GPIO_TypeDef *GPIOx;
+    EXTI_Edge edge;
+    uint8_t level;     ///< last reported level
+    uint8_t unsettled; ///< an edge was swallowed by the debounce window (EXTI_BOTH only)
+    uint8_t armed;     ///< the debounce window since last is still open
+    uint32_t debounce; ///< debounce window in cycles
+    uint32_t last;     ///< cycle count of the last reported edge; only meaningful while armed
+    gpio_event_handler_t handler;
+    void *ctx;
+} gpio_event_line_t;
+
+static gpio_event_line_t gpio_event_lines[16];
+
+/* single-producer (EXTI interrupts), single-consumer (main loop) queue; indexes only ever grow */
+static gpio_event_t gpio_event_queue[GPIO_EVENT_QUEUE_LEN];
+static volatile uint32_t gpio_event_head; // written only by the interrupts
+static volatile uint32_t gpio_event_tail; // written only by the main loop
+static volatile uint32_t gpio_event_drops;
+
+/**
+ * @brief       Spreads a 16-bit pin mask so that bit n lands on bit 2n.
+ * @note        Multiplying the result by a 2-bit field value gives that value in every selected
+ *              pin's MODER/OSPEEDR/PUPDR field, without looping over the pins.
+ * @param[in]   pin_mask: pins to spread (bit n = pin n)
+ */
+static uint32_t gpio_spread_2bit(uint16_t pin_mask)
+{
+    uint32_t x = pin_mask;
+
+    x = (x | (x << 8)) & 0x00FF00FFU;
+    x = (x | (x << 4)) & 0x0F0F0F0FU;
+    x = (x | (x << 2)) & 0x33333333U;
+    x = (x | (x << 1)) & 0x55555555U;
+
+    return x;
+}
+
+/**
+ * @brief       Spreads an 8-bit pin mask so that bit n lands on bit 4n.
+ * @note        Same idea as gpio_spread_2bit, for the 4-bit AFRL/AFRH fields.
+ * @param[in]   pin_mask: pins to spread (bit n = pin n, or pin n + 8 for AFRH)
+ */
+static uint32_t gpio_spread_4bit(uint8_t pin_mask)
+{
+    uint32_t x = pin_mask;
+
+    x = (x | (x << 12)) & 0x000F000FU;
+    x = (x | (x << 6)) & 0x03030303U;
+    x = (x | (x << 3)) & 0x11111111U;
+
+    return x;
+}
+
+/**
+ * @brief       Returns the shadow of a port's configuration registers.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ */
+static gpio_shadow_t *gpio_shadow(GPIO_TypeDef *GPIOx)
+{
+    return &gpio_shadows[((uint32_t)GPIOx - GPIOA_BASE) >> 10]; /* ports are 0x400 apart */
+}
+
+/**
+ * @brief       Reloads a port's shadow from the hardware registers.
+ * @note        Only needed if something outside this driver (a bootloader, a debugger, direct
+ *              register writes) has changed the port's configuration since reset.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ */
+void gpio_shadow_sync(GPIO_TypeDef *GPIOx)
+{
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+
+    sh->moder = GPIOx->MODER;
+    sh->otyper = GPIOx->OTYPER;
+    sh->ospeedr = GPIOx->OSPEEDR;
+    sh->pupdr = GPIOx->PUPDR;
+    sh->afr[0] = GPIOx->AFR[0];
+    sh->afr[1] = GPIOx->AFR[1];
+    sh->lckr = GPIOx->LCKR;
+}
+
+/**
+ * @brief       Writes a register image to a port with one store per register.
+ * @note        New values are merged into the port's shadow and stored; the hardware registers are
+ *              never read. AFR words with no pins to write are skipped. MODER is written last so a
+ *              pin never runs in its new mode with its old output settings. Locked pins are left
+ *              unchanged.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   img: register image to apply
+ * @return      GPIO_OK, or GPIO_LOCKED if some of the image's pins are locked (the rest are applied)
+ */
+GPIO_Status gpio_apply_image(GPIO_TypeDef *GPIOx, const gpio_port_image_t *img)
+{
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+    uint16_t locked = (uint16_t)(sh->lckr & img->pins);
+    uint32_t pins = img->pins & ~(uint32_t)locked;
+    uint32_t mask2 = img->mask2 & ~(gpio_spread_2bit(locked) * 3U);
+    uint32_t afr_mask_lo = img->afr_mask[0] & ~(gpio_spread_4bit(locked & 0xFF) * 0xFU);
+    uint32_t afr_mask_hi = img->afr_mask[1] & ~(gpio_spread_4bit(locked >> 8) * 0xFU);
+
+    sh->otyper = (sh->otyper & ~pins) | (img->otyper & pins);
+    GPIOx->OTYPER = sh->otyper;
+    sh->ospeedr = (sh->ospeedr & ~mask2) | (img->ospeedr & mask2);
+    GPIOx->OSPEEDR = sh->ospeedr;
+    sh->pupdr = (sh->pupdr & ~mask2) | (img->pupdr & mask2);
+    GPIOx->PUPDR = sh->pupdr;
+
+    if (afr_mask_lo)
+    {
+        sh->afr[0] = (sh->afr[0] & ~afr_mask_lo) | (img->afr[0] & afr_mask_lo);
+        GPIOx->AFR[0] = sh->afr[0];
+    }
+    if (afr_mask_hi)
+    {
+        sh->afr[1] = (sh->afr[1] & ~afr_mask_hi) | (img->afr[1] & afr_mask_hi);
+        GPIOx->AFR[1] = sh->afr[1];
+    }
+
+    sh->moder = (sh->moder & ~mask2) | (img->moder & mask2);
+    GPIOx->MODER = sh->moder;
+
+    return locked ? GPIO_LOCKED : GPIO_OK;
+}
+
+/**
+ * @brief       Applies one configuration to any number of pins on a port.
+ * @note        Builds the register image in CPU registers, then writes it with gpio_apply_image.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin_mask: pins to configure (bit n = pin n)
+ * @param[in]   cfg: configuration to apply
+ * @return      GPIO_OK, or GPIO_LOCKED if some of the pins are locked (the rest are configured)
+ */
+GPIO_Status gpio_configure(GPIO_TypeDef *GPIOx, uint16_t pin_mask, const gpio_config_t *cfg)
+{
+    uint32_t field2 = gpio_spread_2bit(pin_mask); /* 01 in every selected 2-bit field */
+    gpio_port_image_t img = {0};
+
+    img.pins = pin_mask;
+    img.mask2 = field2 * 3U;
+    img.moder = field2 * (uint32_t)cfg->mode;
+    img.otyper = (uint32_t)cfg->type * pin_mask;
+    img.ospeedr = field2 * (uint32_t)cfg->speed;
+    img.pupdr = field2 * (uint32_t)cfg->pull;
+
+    if (cfg->mode == ALTERNATE)
+    {
+        uint32_t field4_lo = gpio_spread_4bit(pin_mask & 0xFF); /* 0001 in every selected 4-bit field */
+        uint32_t field4_hi = gpio_spread_4bit(pin_mask >> 8);
+
+        img.afr_mask[0] = field4_lo * 0xFU;
+        img.afr_mask[1] = field4_hi * 0xFU;
+        img.afr[0] = field4_lo * (uint32_t)cfg->af;
+        img.afr[1] = field4_hi * (uint32_t)cfg->af;
+    }
+
+    return gpio_apply_image(GPIOx, &img);
+}
+
+/**
+ * @brief       Replaces one bit field of a shadowed configuration register.
+ * @param[in]   shadow: shadow copy of the register
+ * @param[in]   shift: position of the field's lowest bit
+ * @param[in]   width_mask: field mask before shifting (e.g., 0x3 for a 2-bit field)
+ * @param[in]   value: new field value
+ * @return      the new register value, to be stored to the hardware register
+ */
+static uint32_t gpio_write_field(uint32_t *shadow, uint8_t shift, uint32_t width_mask, uint32_t value)
+{
+    *shadow = (*shadow & ~(width_mask << shift)) | ((value & width_mask) << shift);
+
+    return *shadow;
+}
 
 /**
  * @brief       Map an alternate function to a GPIO pin.
+ * @note        Does nothing if the pin is locked.
  * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
  * @param[in]   pin: the pin to set
  * @param[in]   fn: alternate function number
  */
 void gpio_map_alternate_fn(GPIO_TypeDef *GPIOx, uint8_t pin, Alt_Function fn)
 {
-    uint8_t hi_lo = pin < 8 ? 0 : 1; /* use AFR[0] for pins 0-7, AFR[1] for pins 8-15 */
-    uint8_t bit_0 = pin < 8 ? (pin * 4) : ((pin - 8) * 4);
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+
+    if (sh->lckr & (1U << pin))
+    {
+        return;
+    }
+
+    /* AFR[0] holds pins 0-7, AFR[1] pins 8-15, four bits per pin */
+    GPIOx->AFR[pin >> 3] = gpio_write_field(&sh->afr[pin >> 3], (pin & 7) * 4, 0xFU, fn);
+}
+
+/**
+ * @brief       Maps the alternate function of every pin on a port with one store to each of AFRL
+ *              and AFRH.
+ * @note        Pins that aren't in alternate mode get whatever is in af[] for them too (AF0 if the
+ *              caller doesn't care); only MODER decides whether a pin actually uses its alternate
+ *              function. Locked pins keep their mapping.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   af: alternate function number for pins 0-15
+ */
+void gpio_map_alternate_fn_port(GPIO_TypeDef *GPIOx, const uint8_t af[16])
+{
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+    uint16_t locked = (uint16_t)sh->lckr;
+    uint32_t keep_lo = gpio_spread_4bit(locked & 0xFF) * 0xFU;
+    uint32_t keep_hi = gpio_spread_4bit(locked >> 8) * 0xFU;
+    uint32_t afr[2] = {0, 0};
 
-    switch (fn)
+    for (uint8_t pin = 0; pin < 16; pin++)
     {
-    case AF0:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF1:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF2:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF3:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF4:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF5:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF6:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF7:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 3);
-        break;
-    case AF8:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF9:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF10:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF11:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF12:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF13:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF14:
-        GPIOx->AFR[hi_lo] &= ~(1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    case AF15:
-        GPIOx->AFR[hi_lo] |= (1U << bit_0);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 1);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 2);
-        GPIOx->AFR[hi_lo] |= (1U << bit_0 + 3);
-        break;
-    default:
-        break;
+        afr[pin >> 3] |= (uint32_t)(af[pin] & 0xFU) << ((pin & 7) * 4);
     }
+
+    sh->afr[0] = (sh->afr[0] & keep_lo) | (afr[0] & ~keep_lo);
+    sh->afr[1] = (sh->afr[1] & keep_hi) | (afr[1] & ~keep_hi);
+    GPIOx->AFR[0] = sh->afr[0];
+    GPIOx->AFR[1] = sh->afr[1];
 }
 
 /**
  * @brief       Sets the mode on a GPIO pin.
+ * @note        Does nothing if the pin is locked.
  * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
  * @param[in]   pin: the pin to set (0-15)
  * @param[in]   mode: mode to set the pin to
  */
 void gpio_set_mode(GPIO_TypeDef *GPIOx, uint8_t pin, GPIO_Mode mode)
 {
-    uint8_t lowbit = pin * 2;
-    uint8_t highbit = lowbit + 1;
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
 
-    switch (mode)
+    if (sh->lckr & (1U << pin))
     {
-    case INPUT: /* 00 */
-        GPIOx->MODER &= ~(1U << lowbit);
-        GPIOx->MODER &= ~(1U << highbit);
-        break;
-    case OUTPUT: /* 01 */
-        GPIOx->MODER |= (1U << lowbit);
-        GPIOx->MODER &= ~(1U << highbit);
-        break;
-    case ALTERNATE: /* 10 */
-        GPIOx->MODER &= ~(1U << lowbit);
-        GPIOx->MODER |= (1U << highbit);
-        break;
-    case ANALOG: /* 11 */
-        GPIOx->MODER |= (1U << lowbit);
-        GPIOx->MODER |= (1U << highbit);
-        break;
-    default:
-        break;
+        return;
     }
+
+    GPIOx->MODER = gpio_write_field(&sh->moder, pin * 2, 0x3U, mode); /* 00 input, 01 output, 10 alternate, 11 analog */
 }
 
 /**
- * @brief       Sets a GPIOB pin to an output type.
+ * @brief       Sets a GPIO pin to an output type.
+ * @note        Does nothing if the pin is locked.
  * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
  * @param[in]   pin: pin number to set (0-15)
  * @param[in]   type: push-pull or open-drain
  */
 void gpio_set_output_type(GPIO_TypeDef *GPIOx, uint8_t pin, Output_Type type)
 {
-    switch (type)
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+
+    if (sh->lckr & (1U << pin))
     {
-    case PUSH_PULL:
-        GPIOx->OTYPER &= ~(1U << pin);
-        break;
-    case OPEN_DRAIN:
-        GPIOx->OTYPER |= (1U << pin);
-    default:
-        break;
+        return;
     }
+
+    GPIOx->OTYPER = gpio_write_field(&sh->otyper, pin, 0x1U, type);
+}
+
+/**
+ * @brief       Sets a GPIO pin's output speed.
+ * @note        Does nothing if the pin is locked.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: pin number to set (0-15)
+ * @param[in]   speed: low, medium or high
+ */
+void gpio_set_output_speed(GPIO_TypeDef *GPIOx, uint8_t pin, Output_Speed speed)
+{
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+
+    if (sh->lckr & (1U << pin))
+    {
+        return;
+    }
+
+    GPIOx->OSPEEDR = gpio_write_field(&sh->ospeedr, pin * 2, 0x3U, speed);
 }
 
 /**
  * @brief       Sets a GPIO pin's pull-up/pull-down.
+ * @note        Does nothing if the pin is locked.
  * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
  * @param[in]   pin: the pin to set
  * @param[in]   pull_t: the type (none, pull-up, or pull-down)
  */
-void gpiob_set_pullup_pulldown(GPIO_TypeDef *GPIOx, uint8_t pin, PullUp_PullDown pull_t)
+void gpio_set_pullup_pulldown(GPIO_TypeDef *GPIOx, uint8_t pin, PullUp_PullDown pull_t)
+{
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+
+    if (sh->lckr & (1U << pin))
+    {
+        return;
+    }
+
+    GPIOx->PUPDR = gpio_write_field(&sh->pupdr, pin * 2, 0x3U, pull_t);
+}
+
+/**
+ * @brief       Returns a pin's mode from the shadow.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin (0-15)
+ */
+GPIO_Mode gpio_get_mode(GPIO_TypeDef *GPIOx, uint8_t pin)
+{
+    return (GPIO_Mode)((gpio_shadow(GPIOx)->moder >> (pin * 2)) & 0x3U);
+}
+
+/**
+ * @brief       Returns a pin's output type from the shadow.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin (0-15)
+ */
+Output_Type gpio_get_output_type(GPIO_TypeDef *GPIOx, uint8_t pin)
+{
+    return (Output_Type)((gpio_shadow(GPIOx)->otyper >> pin) & 0x1U);
+}
+
+/**
+ * @brief       Returns a pin's output speed from the shadow.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin (0-15)
+ */
+Output_Speed gpio_get_output_speed(GPIO_TypeDef *GPIOx, uint8_t pin)
+{
+    uint32_t speed = (gpio_shadow(GPIOx)->ospeedr >> (pin * 2)) & 0x3U;
+
+    return (speed == 2) ? LOW_SPEED : (Output_Speed)speed; /* 10 is also low speed */
+}
+
+/**
+ * @brief       Returns a pin's pull-up/pull-down setting from the shadow.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin (0-15)
+ */
+PullUp_PullDown gpio_get_pullup_pulldown(GPIO_TypeDef *GPIOx, uint8_t pin)
+{
+    return (PullUp_PullDown)((gpio_shadow(GPIOx)->pupdr >> (pin * 2)) & 0x3U);
+}
+
+/**
+ * @brief       Returns a pin's alternate function mapping from the shadow.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin (0-15)
+ */
+Alt_Function gpio_get_alternate_fn(GPIO_TypeDef *GPIOx, uint8_t pin)
+{
+    return (Alt_Function)((gpio_shadow(GPIOx)->afr[pin >> 3] >> ((pin & 7) * 4)) & 0xFU);
+}
+
+/**
+ * @brief       Freezes the configuration of a set of pins until the next reset.
+ * @note        Runs the LCKR key sequence (write LCKK=1, LCKK=0, LCKK=1 with the same pin mask, then
+ *              read back) with interrupts masked, since any other access in between aborts it. A
+ *              port can only be locked once per reset: after that LCKR itself is frozen, so choose
+ *              every pin to lock in one call. The pins' output levels can still be changed.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin_mask: pins to lock (bit n = pin n)
+ * @return      GPIO_OK, GPIO_LOCKED if the port was already locked, or GPIO_INVALID if the
+ *              hardware didn't accept the sequence
+ */
+GPIO_Status gpio_lock_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask)
 {
-    uint8_t lowbit = pin * 2;
-    uint8_t highbit = lowbit + 1;
+    gpio_shadow_t *sh = gpio_shadow(GPIOx);
+    uint32_t key = GPIO_LCKR_LCKK | pin_mask;
+    uint32_t primask;
+    uint32_t lckr;
 
-    switch (pull_t)
+    if (sh->lckr & GPIO_LCKR_LCKK)
     {
-    case NONE:
-        GPIOx->PUPDR &= ~(1U << lowbit);
-        GPIOx->PUPDR &= ~(1U << highbit);
-        break;
-    case PULL_UP:
-        GPIOx->PUPDR |= (1U << lowbit);
-        GPIOx->PUPDR &= ~(1U << highbit);
-        break;
-    case PULL_DOWN:
-        GPIOx->PUPDR &= ~(1U << lowbit);
-        GPIOx->PUPDR |= (1U << highbit);
-        break;
-    default:
-        break;
+        return GPIO_LOCKED;
     }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    GPIOx->LCKR = key;
+    GPIOx->LCKR = pin_mask;
+    GPIOx->LCKR = key;
+    (void)GPIOx->LCKR;
+    lckr = GPIOx->LCKR;
+
+    __set_PRIMASK(primask);
+
+    if (!(lckr & GPIO_LCKR_LCKK))
+    {
+        return GPIO_INVALID;
+    }
+
+    sh->lckr = lckr;
+
+    return GPIO_OK;
+}
+
+/**
+ * @brief       Returns the locked pins of a port (bit n = pin n).
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ */
+uint16_t gpio_locked_pins(GPIO_TypeDef *GPIOx)
+{
+    return (uint16_t)gpio_shadow(GPIOx)->lckr;
 }
 
 /**
@@ -235,7 +480,66 @@ void gpiob_set_pullup_pulldown(GPIO_TypeDef *GPIOx, uint8_t pin, PullUp_PullDown
  */
 void gpioa_enable_led(void)
 {
-    gpio_set_mode(GPIOA, 5, OUTPUT);
+    GPIO_PINMAP_APPLY(LED_PINS, A);
+}
+
+/**
+ * @brief       Sets and resets any number of pins on a port with a single store to BSRR.
+ * @note        BSRR is write-only and the set/reset happens in hardware, so no other pin on the
+ *              port is touched and an ISR writing the same port can't be overwritten. If a pin is
+ *              in both masks, the set wins.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   set_mask: pins to drive high (bit n = pin n)
+ * @param[in]   reset_mask: pins to drive low (bit n = pin n)
+ */
+void gpio_write_pins(GPIO_TypeDef *GPIOx, uint16_t set_mask, uint16_t reset_mask)
+{
+    GPIOx->BSRR = ((uint32_t)reset_mask << 16) | set_mask; // BR[15:0] in bits 31:16, BS[15:0] in bits 15:0
+}
+
+/**
+ * @brief       Drives a set of pins high with a single store to BSRR.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin_mask: pins to set (bit n = pin n)
+ */
+void gpio_set_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask)
+{
+    GPIOx->BSRR = pin_mask;
+}
+
+/**
+ * @brief       Drives a set of pins low with a single store to BRR.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin_mask: pins to reset (bit n = pin n)
+ */
+void gpio_reset_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask)
+{
+    GPIOx->BRR = pin_mask;
+}
+
+/**
+ * @brief       Toggles a set of pins with one load from ODR and one store to BSRR.
+ * @note        Only the pins in pin_mask are written, so unlike ODR ^= mask this can't undo a
+ *              change an ISR made to another pin between the load and the store.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin_mask: pins to toggle (bit n = pin n)
+ */
+void gpio_toggle_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask)
+{
+    uint32_t odr = GPIOx->ODR;
+
+    GPIOx->BSRR = ((odr & pin_mask) << 16) | (~odr & pin_mask); // reset the pins that are high, set the ones that are low
+}
+
+/**
+ * @brief       Reads the input level of a set of pins.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin_mask: pins to read (bit n = pin n)
+ * @return      IDR masked with pin_mask
+ */
+uint16_t gpio_read_pins(GPIO_TypeDef *GPIOx, uint16_t pin_mask)
+{
+    return (uint16_t)(GPIOx->IDR & pin_mask);
 }
 
 /**
@@ -243,7 +547,7 @@ void gpioa_enable_led(void)
  */
 void gpioa_led_on(void)
 {
-    GPIOA->ODR |= LED_PIN;
+    gpio_set_pins(GPIOA, LED_PIN);
 }
 
 /**
@@ -251,15 +555,15 @@ void gpioa_led_on(void)
  */
 void gpioa_led_off(void)
 {
-    GPIOA->ODR &= ~(LED_PIN);
+    gpio_reset_pins(GPIOA, LED_PIN);
 }
 
 /**
- * @brief   Toggles the on-board LED by XOR'ing PA5.
+ * @brief   Toggles the on-board LED.
  */
 void gpioa_led_toggle(void)
 {
-    GPIOA->ODR ^= LED_PIN;
+    gpio_toggle_pins(GPIOA, LED_PIN);
 }
 
 /**
@@ -268,12 +572,248 @@ void gpioa_led_toggle(void)
  */
 void gpiob_use_I2C(void)
 {
-    gpio_set_mode(GPIOB, 8, ALTERNATE);
-    gpio_set_mode(GPIOB, 9, ALTERNATE);
-    gpio_set_output_type(GPIOB, 8, OPEN_DRAIN);
-    gpio_set_output_type(GPIOB, 9, OPEN_DRAIN);
-    gpio_set_pullup_pulldown(GPIOB, 8, PULL_UP);
-    gpio_set_pullup_pulldown(GPIOB, 9, PULL_UP);
-    gpio_map_alternate_fn(GPIOB, 8, AF4);
-    gpio_map_alternate_fn(GPIOB, 9, AF4);
-}
\ No newline at end of file
+    GPIO_PINMAP_APPLY(I2C1_PINS, B);
+}
+
+/**
+ * @brief       Adds an event to the queue. Called from interrupt context only.
+ * @param[in]   evt: event to add
+ */
+static void gpio_event_push(const gpio_event_t *evt)
+{
+    uint32_t head = gpio_event_head;
+
+    if (head - gpio_event_tail == GPIO_EVENT_QUEUE_LEN)
+    {
+        gpio_event_drops++;
+        return;
+    }
+
+    gpio_event_queue[head & (GPIO_EVENT_QUEUE_LEN - 1)] = *evt;
+    __DMB(); // the event must be visible before the new head
+    gpio_event_head = head + 1;
+}
+
+/**
+ * @brief       EXTI handler for pins with events enabled.
+ * @note        Debouncing is a lockout: an edge within debounce_us of the last reported one is
+ *              dropped, with no waiting in the interrupt. With EXTI_BOTH only real level changes are
+ *              reported, and an edge dropped in the lockout marks the line so gpio_event_dispatch
+ *              can report the level it finally settled at. The window is only checked while the
+ *              line is armed: gpio_event_settle disarms it once the window has passed, so a last
+ *              from before a CYCCNT wrap (about 60 s at 72 MHz) can't put a new edge inside it.
+ * @param[in]   line: EXTI line (= pin number)
+ * @param[in]   ctx: unused
+ */
+static void gpio_event_isr(uint8_t line, void *ctx)
+{
+    gpio_event_line_t *ln = &gpio_event_lines[line];
+    uint32_t now = DWT->CYCCNT;
+    gpio_event_t evt;
+
+    (void)ctx;
+
+    evt.GPIOx = ln->GPIOx;
+    evt.pin = line;
+    evt.level = (uint8_t)((ln->GPIOx->IDR >> line) & 1U);
+    evt.timestamp = now;
+
+    if (ln->armed && (now - ln->last < ln->debounce))
+    {
+        ln->unsettled = (ln->edge == EXTI_BOTH);
+        return;
+    }
+
+    if ((ln->edge == EXTI_BOTH) && (evt.level == ln->level))
+    {
+        return;
+    }
+
+    ln->last = now;
+    ln->armed = (ln->debounce != 0);
+    ln->level = evt.level;
+    ln->unsettled = 0;
+    gpio_event_push(&evt);
+}
+
+/**
+ * @brief       Reports edges on a pin as timestamped events.
+ * @note        The SYSCFG clock must be enabled and the pin configured as an input. Every EXTI
+ *              interrupt used for events must have the same NVIC priority (the default), since the
+ *              queue has a single producer. Starts the DWT cycle counter used for timestamps and,
+ *              for a debounced EXTI_BOTH pin, the SysTick time base if it isn't running.
+ * @param[in]   GPIOx: a defined GPIO pointer (e.g., GPIOA, GPIOB, etc.)
+ * @param[in]   pin: the pin to watch (0-15); pin n of only one port can be watched at a time
+ * @param[in]   edge: rising, falling or both
+ * @param[in]   debounce_us: edges closer than this to the last reported one are dropped (0 = off)
+ * @param[in]   handler: called for the pin's events by gpio_event_dispatch, or NULL
+ * @param[in]   ctx: passed back to handler
+ */
+void gpio_event_enable(GPIO_TypeDef *GPIOx, uint8_t pin, EXTI_Edge edge, uint32_t debounce_us,
+                       gpio_event_handler_t handler, void *ctx)
+{
+    gpio_event_line_t *ln = &gpio_event_lines[pin];
+
+    dwt_init();
+
+    ln->GPIOx = GPIOx;
+    ln->edge = edge;
+    ln->level = (uint8_t)((GPIOx->IDR >> pin) & 1U);
+    ln->unsettled = 0;
+    ln->armed = 0; // the first edge is never inside the window
+    ln->debounce = dwt_us_to_cycles(debounce_us);
+    ln->last = DWT->CYCCNT;
+    ln->handler = handler;
+    ln->ctx = ctx;
+
+    if ((edge == EXTI_BOTH) && debounce_us && !(SysTick->CTRL & CTRL_ENABLE))
+    {
+        systick_init(); // wakes gpio_event_wait to catch up a level that settled in the window
+    }
+
+    exti_enable_pin(GPIOx, pin, edge, gpio_event_isr, 0);
+}
+
+/**
+ * @brief       Stops reporting events on a pin. Events already queued are still delivered.
+ * @param[in]   pin: the pin (0-15)
+ */
+void gpio_event_disable(uint8_t pin)
+{
+    exti_disable_pin(pin);
+    gpio_event_lines[pin].handler = 0;
+}
+
+/**
+ * @brief       Takes the oldest event off the queue. Main loop only.
+ * @param[out]  evt: the event
+ * @return      1 if an event was returned, 0 if the queue was empty
+ */
+uint8_t gpio_event_pop(gpio_event_t *evt)
+{
+    uint32_t tail = gpio_event_tail;
+
+    if (tail == gpio_event_head)
+    {
+        return 0;
+    }
+
+    __DMB(); // read the event only after seeing the head that published it
+    *evt = gpio_event_queue[tail & (GPIO_EVENT_QUEUE_LEN - 1)];
+    __DMB(); // finish reading before handing the slot back
+    gpio_event_tail = tail + 1;
+
+    return 1;
+}
+
+/**
+ * @brief       Disarms lines whose debounce window has passed, and catches up EXTI_BOTH lines
+ *              whose last edge fell inside it.
+ * @note        Once the window has passed, the pin is sampled and, if it settled at a level other
+ *              than the last one reported, an event is queued for it (which opens a new window).
+ *              Each line is checked with interrupts masked so the queue still has one producer at
+ *              a time; the caller's PRIMASK is restored afterwards.
+ */
+static void gpio_event_settle(void)
+{
+    for (uint8_t pin = 0; pin < 16; pin++)
+    {
+        gpio_event_line_t *ln = &gpio_event_lines[pin];
+        uint32_t primask;
+        uint32_t now;
+
+        if (!ln->armed)
+        {
+            continue;
+        }
+
+        primask = __get_PRIMASK();
+        __disable_irq();
+
+        now = DWT->CYCCNT;
+
+        if (ln->armed && (now - ln->last >= ln->debounce))
+        {
+            gpio_event_t evt = {ln->GPIOx, pin, (uint8_t)((ln->GPIOx->IDR >> pin) & 1U), now};
+
+            ln->armed = 0;
+
+            if (ln->unsettled && (evt.level != ln->level))
+            {
+                ln->last = now;
+                ln->armed = 1;
+                ln->level = evt.level;
+                gpio_event_push(&evt);
+            }
+
+            ln->unsettled = 0;
+        }
+
+        __set_PRIMASK(primask);
+    }
+}
+
+/**
+ * @brief       Delivers every queued event to its pin's handler. Main loop only.
+ * @return      number of events taken off the queue
+ */
+uint32_t gpio_event_dispatch(void)
+{
+    gpio_event_t evt;
+    uint32_t n = 0;
+
+    gpio_event_settle();
+
+    while (gpio_event_pop(&evt))
+    {
+        gpio_event_line_t *ln = &gpio_event_lines[evt.pin];
+
+        if (ln->handler)
+        {
+            ln->handler(&evt, ln->ctx);
+        }
+
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * @brief   Sleeps until at least one event is queued.
+ * @note    WFI runs with interrupts masked, so an event arriving between the queue check and the
+ *          sleep still wakes the core; the interrupt is taken as soon as they're unmasked. Lines
+ *          left unsettled by a debounce window are caught up before each sleep, and the SysTick
+ *          tick (started by gpio_event_enable) wakes the core to check them again. The caller's
+ *          PRIMASK is restored on return.
+ */
+void gpio_event_wait(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    while (1)
+    {
+        gpio_event_settle();
+
+        if (gpio_event_head != gpio_event_tail)
+        {
+            break;
+        }
+
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief   Number of events dropped because the queue was full.
+ */
+uint32_t gpio_event_dropped(void)
+{
+    return gpio_event_drops;
+}
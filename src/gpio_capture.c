@@ -0,0 +1,255 @@
+/**
+ ******************************************************************************
+ * @file    gpio_capture.c
+ * @author  Loren Snow
+ * @brief   DMA-driven GPIO logic-analyzer capture source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "gpio_capture.h"
+#include "dma.h"
+#include "tim.h"
+
+/**
+ * @brief       Index of the buffer slot the DMA will write next.
+ * @param[in]   cap: running capture
+ */
+static uint16_t gpio_capture_position(const gpio_capture_t *cap)
+{
+    uint16_t pos = cap->len - dma_channel_remaining(cap->ch);
+
+    return (pos == cap->len) ? 0 : pos;
+}
+
+/**
+ * @brief       EXTI handler for the trigger pin. Records where the trigger landed and how many
+ *              half-buffer boundaries to wait for before stopping.
+ * @note        Stopping at the first boundary at least len / 2 samples after the edge keeps the
+ *              trigger sample in the buffer whatever the DMA position was when it fired.
+ * @param[in]   line: EXTI line (unused)
+ * @param[in]   ctx: the gpio_capture_t
+ */
+static void gpio_capture_trigger(uint8_t line, void *ctx)
+{
+    gpio_capture_t *cap = ctx;
+    uint16_t half = cap->len / 2;
+    uint16_t pos;
+
+    (void)line;
+    exti_disable_pin(cap->trig_pin); // one trigger per capture
+
+    if (cap->state != CAPTURE_RUNNING)
+    {
+        return;
+    }
+
+    pos = gpio_capture_position(cap);
+    cap->trig_index = pos;
+    cap->triggered = 1;
+    cap->boundaries = (((pos < half) ? half : cap->len) - pos >= half) ? 1 : 2;
+    cap->state = CAPTURE_TRIGGERED;
+}
+
+/**
+ * @brief       DMA callback: tracks ring wrap-around and ends a triggered capture.
+ * @param[in]   events: DMA_EVT_* mask
+ * @param[in]   ctx: the gpio_capture_t
+ */
+static void gpio_capture_dma_event(uint32_t events, void *ctx)
+{
+    gpio_capture_t *cap = ctx;
+
+    if (events & DMA_EVT_FULL)
+    {
+        cap->wrapped = 1;
+    }
+
+    if (events & DMA_EVT_ERROR)
+    {
+        gpio_capture_stop(cap);
+        return;
+    }
+
+    if ((cap->state == CAPTURE_TRIGGERED) && (events & (DMA_EVT_HALF | DMA_EVT_FULL)))
+    {
+        if (--cap->boundaries == 0)
+        {
+            gpio_capture_stop(cap);
+        }
+    }
+}
+
+/**
+ * @brief       Starts sampling a port and, if a trigger pin is set, arms the trigger.
+ * @note        The GPIO, DMA and timer clocks must be enabled, plus SYSCFG when a trigger is used.
+ *              The call returns immediately; poll gpio_capture_done from the main loop.
+ * @param[in]   cap: capture to start
+ * @return      GPIO_OK, GPIO_INVALID if the timer has no update DMA request, the rate can't be
+ *              reached or len is odd or 0, or GPIO_BUSY if the DMA channel is in use
+ */
+GPIO_Status gpio_capture_start(gpio_capture_t *cap)
+{
+    DMA_Channel_TypeDef *ch = tim_update_dma_channel(cap->TIMx);
+
+    if (!ch || !cap->len || (cap->len & 1))
+    {
+        return GPIO_INVALID;
+    }
+
+    if (dma_channel_busy(ch))
+    {
+        return GPIO_BUSY;
+    }
+
+    if (!tim_set_update_rate(cap->TIMx, cap->rate_hz))
+    {
+        return GPIO_INVALID;
+    }
+
+    cap->ch = ch;
+    cap->wrapped = 0;
+    cap->triggered = 0;
+    cap->boundaries = 0;
+    cap->trig_index = 0;
+    cap->end_index = 0;
+    cap->state = CAPTURE_RUNNING;
+
+    /* peripheral-to-memory, 16-bit IDR reads into a circular buffer */
+    dma_channel_set_callback(ch, gpio_capture_dma_event, cap);
+    dma_channel_configure(ch, &cap->GPIOx->IDR, cap->buf, cap->len,
+                          DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 | DMA_CCR_PL_1 |
+                              DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE);
+    dma_channel_start(ch);
+
+    if (cap->trig_port)
+    {
+        exti_enable_pin(cap->trig_port, cap->trig_pin, cap->trig_edge, gpio_capture_trigger, cap);
+    }
+
+    tim_enable_update_dma(cap->TIMx);
+    tim_start(cap->TIMx);
+
+    return GPIO_OK;
+}
+
+/**
+ * @brief       Stops sampling and freezes the buffer.
+ * @note        Called by the driver at the end of a triggered capture; call it directly to end an
+ *              untriggered one or to abandon a trigger.
+ * @param[in]   cap: capture to stop
+ */
+void gpio_capture_stop(gpio_capture_t *cap)
+{
+    if ((cap->state == CAPTURE_IDLE) || (cap->state == CAPTURE_DONE))
+    {
+        return;
+    }
+
+    tim_stop(cap->TIMx);
+    dma_channel_stop(cap->ch);
+
+    if (cap->trig_port)
+    {
+        exti_disable_pin(cap->trig_pin);
+    }
+
+    cap->end_index = gpio_capture_position(cap);
+    cap->state = CAPTURE_DONE;
+}
+
+/**
+ * @brief       Whether a capture has finished and its buffer can be read.
+ * @param[in]   cap: capture
+ */
+uint8_t gpio_capture_done(const gpio_capture_t *cap)
+{
+    return cap->state == CAPTURE_DONE;
+}
+
+/**
+ * @brief       Number of valid samples in a finished capture.
+ * @param[in]   cap: finished capture
+ */
+uint16_t gpio_capture_count(const gpio_capture_t *cap)
+{
+    return cap->wrapped ? cap->len : cap->end_index;
+}
+
+/**
+ * @brief       Position of the first post-trigger sample, counted from the oldest sample.
+ * @param[in]   cap: finished capture
+ * @return      sample offset, or -1 if the capture wasn't triggered
+ */
+int32_t gpio_capture_trigger_offset(const gpio_capture_t *cap)
+{
+    uint16_t oldest = cap->wrapped ? cap->end_index : 0;
+
+    if (!cap->triggered || (cap->state != CAPTURE_DONE))
+    {
+        return -1;
+    }
+
+    return (int32_t)((cap->trig_index + cap->len - oldest) % cap->len);
+}
+
+/**
+ * @brief       Dumps a finished capture, oldest sample first, as run-length encoded values.
+ * @note        Each call to emit is one (value, run length) pair; a port that sits idle for the
+ *              whole buffer comes out as a single call.
+ * @param[in]   cap: finished capture
+ * @param[in]   emit: output function
+ * @param[in]   ctx: passed back to emit
+ */
+void gpio_capture_dump(const gpio_capture_t *cap, gpio_capture_emit_t emit, void *ctx)
+{
+    uint16_t count = gpio_capture_count(cap);
+    uint16_t idx = cap->wrapped ? cap->end_index : 0;
+    uint16_t value;
+    uint32_t run = 0;
+
+    if (!count)
+    {
+        return;
+    }
+
+    value = cap->buf[idx];
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (cap->buf[idx] != value)
+        {
+            emit(value, run, ctx);
+            value = cap->buf[idx];
+            run = 0;
+        }
+
+        run++;
+        idx = (idx + 1 == cap->len) ? 0 : idx + 1;
+    }
+
+    emit(value, run, ctx);
+}
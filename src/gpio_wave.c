@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ * @file    gpio_wave.c
+ * @author  Loren Snow
+ * @brief   DMA-driven GPIO waveform source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "gpio_wave.h"
+#include "tim.h"
+
+/**
+ * @brief       Builds the BSRR word that drives a group of pins to a value.
+ * @param[in]   pin_mask: pins the word controls (bit n = pin n)
+ * @param[in]   value: level for each pin in pin_mask (bit n = pin n)
+ * @return      BSRR word setting the 1 bits and resetting the 0 bits of value within pin_mask
+ */
+uint32_t gpio_wave_word(uint16_t pin_mask, uint16_t value)
+{
+    return ((uint32_t)(pin_mask & ~value) << 16) | (pin_mask & value);
+}
+
+/**
+ * @brief       Encodes bytes for an 8-bit parallel bus on eight consecutive pins of a port.
+ * @note        Use for parallel LCD data lines or an R-2R DAC ladder: each byte becomes one BSRR word
+ *              that drives pins first_pin to first_pin + 7 and leaves the rest of the port alone.
+ * @param[out]  dst: BSRR words, len entries
+ * @param[in]   src: bus values
+ * @param[in]   len: number of values
+ * @param[in]   first_pin: pin carrying bit 0 of the bus (0-8)
+ */
+void gpio_wave_encode_bus(uint32_t *dst, const uint8_t *src, uint16_t len, uint8_t first_pin)
+{
+    uint16_t bus_mask = (uint16_t)(0xFFU << first_pin);
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        dst[i] = gpio_wave_word(bus_mask, (uint16_t)(src[i] << first_pin));
+    }
+}
+
+/**
+ * @brief       DMA callback: stops the timer once a one-shot pattern has finished and forwards the
+ *              event to the user.
+ * @param[in]   events: DMA_EVT_* mask
+ * @param[in]   ctx: the gpio_wave_t
+ */
+static void gpio_wave_dma_event(uint32_t events, void *ctx)
+{
+    gpio_wave_t *wave = ctx;
+
+    if ((events & DMA_EVT_ERROR) || ((events & DMA_EVT_FULL) && !wave->circular))
+    {
+        gpio_wave_stop(wave);
+    }
+
+    if (wave->callback)
+    {
+        wave->callback(events, wave->ctx);
+    }
+}
+
+/**
+ * @brief       Starts streaming a waveform to its port.
+ * @note        The GPIO, DMA and timer clocks must be enabled and the pins set to output mode. The
+ *              timer's update DMA channel is fixed by hardware (see tim_update_dma_channel), so two
+ *              waveforms can't share a timer or a channel. The timer is owned by the waveform until
+ *              gpio_wave_stop or, in one-shot mode, until the last word is written.
+ * @param[in]   wave: waveform to start
+ * @return      GPIO_OK, GPIO_INVALID if the timer has no update DMA request, the rate can't be
+ *              reached or the buffer is empty, or GPIO_BUSY if the DMA channel is in use
+ */
+GPIO_Status gpio_wave_start(gpio_wave_t *wave)
+{
+    DMA_Channel_TypeDef *ch = tim_update_dma_channel(wave->TIMx);
+    uint32_t ccr = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1 | DMA_CCR_PL | DMA_CCR_TEIE |
+                   DMA_CCR_TCIE;
+
+    if (!ch || !wave->len)
+    {
+        return GPIO_INVALID;
+    }
+
+    if (dma_channel_busy(ch))
+    {
+        return GPIO_BUSY;
+    }
+
+    if (!tim_set_update_rate(wave->TIMx, wave->rate_hz))
+    {
+        return GPIO_INVALID;
+    }
+
+    if (wave->circular)
+    {
+        ccr |= DMA_CCR_CIRC;
+    }
+    if (wave->callback)
+    {
+        ccr |= DMA_CCR_HTIE;
+    }
+
+    wave->ch = ch;
+    dma_channel_set_callback(ch, gpio_wave_dma_event, wave);
+    dma_channel_configure(ch, &wave->GPIOx->BSRR, wave->buf, wave->len, ccr);
+    dma_channel_start(ch);
+
+    tim_enable_update_dma(wave->TIMx);
+    tim_start(wave->TIMx);
+
+    return GPIO_OK;
+}
+
+/**
+ * @brief       Stops a waveform. Pins keep the level of the last word written.
+ * @param[in]   wave: waveform to stop
+ */
+void gpio_wave_stop(gpio_wave_t *wave)
+{
+    tim_stop(wave->TIMx);
+
+    if (wave->ch)
+    {
+        dma_channel_stop(wave->ch);
+    }
+}
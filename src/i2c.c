@@ -31,209 +31,1636 @@
  */
 
 #include "i2c.h"
+#include "bitband.h"
+#include "dma.h"
+#include "dwt.h"
+#include "gpio.h"
+#include "i2c_target.h"
+#include "i2c_timing.h"
+#include <stddef.h>
+
+#define I2C_INSTANCE_COUNT 3
+#define I2C_NBYTES_MAX 0xFFU ///< NBYTES is 8 bits; longer transfers are sent in reloaded chunks
+
+#define I2C_ASYNC_IRQS \
+    (I2C_CR1_TXIE | I2C_CR1_RXIE | I2C_CR1_TCIE | I2C_CR1_NACKIE | I2C_CR1_STOPIE | I2C_CR1_ERRIE)
+#define I2C_DMA_ENABLES (I2C_CR1_TXDMAEN | I2C_CR1_RXDMAEN)
+#define I2C_ERRORS (I2C_ISR_ARLO | I2C_ISR_BERR | I2C_ISR_TIMEOUT)
+#define I2C_RECOVERY_HALF_PERIOD_US 5 ///< SCL half period while clocking a stuck target free (100 kHz)
+
+/**
+ * @brief   Where the bytes of a write come from: a buffer, a list of segments, a producer
+ *          callback, or segments followed by a producer.
+ */
+typedef struct
+{
+    const uint8_t *data;        ///< next byte of the current piece
+    uint32_t len;               ///< bytes left in the current piece
+    const i2c_segment_t *seg;   ///< next segment
+    uint32_t seg_count;         ///< segments left
+    i2c_producer_t producer;    ///< asked for the next piece once the segments run out, or NULL
+    void *producer_ctx;
+} i2c_source_t;
+
+/**
+ * @brief   State of an interrupt-driven transfer on one I2C instance.
+ */
+typedef struct
+{
+    i2c_source_t src;           ///< where the bytes for TXDR come from (interrupt-driven writes)
+    uint8_t *rx;                ///< where the next byte from RXDR goes (interrupt-driven reads)
+    uint32_t remaining;         ///< bytes the CPU still has to move; 0 when DMA moves them
+    uint32_t unscheduled;       ///< bytes not yet covered by an NBYTES chunk
+    uint32_t rx_pending;        ///< length of the read phase that follows the write phase, or 0
+    uint32_t bytes;             ///< bytes written and read by the whole transfer, for the counters
+    uint32_t end;               ///< I2C_CR2_AUTOEND on the last phase, 0 before a repeated START
+    uint32_t addr;              ///< SADD/ADD10 bits of CR2, kept for the repeated START
+    DMA_Channel_TypeDef *dma;   ///< channel moving the data, or NULL
+    i2c_callback_t cb;
+    void *ctx;
+    I2C_Status status;
+    volatile uint8_t busy;
+} i2c_xfer_t;
+
+/**
+ * @brief   GPIO pins an I2C instance is routed to, for bus recovery.
+ */
+typedef struct
+{
+    GPIO_TypeDef *scl_port; ///< NULL until I2C_set_bus_pins is called
+    GPIO_TypeDef *sda_port;
+    uint8_t scl_pin;
+    uint8_t sda_pin;
+} i2c_pins_t;
+
+/**
+ * @brief   Everything the driver knows about one I2C instance: its wiring to RCC, SYSCFG, the NVIC,
+ *          DMA and EXTI, and its own transfer state, so the instances run independently.
+ */
+typedef struct
+{
+    I2C_TypeDef *I2Cx;
+    i2c_wiring_t wiring;            ///< shared with the target mode driver (I2C_get_wiring)
+    struct i2c_target *target;      ///< target mode state, or NULL
+    uint8_t rst_bit;                ///< reset bit in RCC->APB1RSTR
+    uint8_t sw_bit;                 ///< kernel clock select bit in RCC->CFGR3
+    uint8_t fmp_bit;                ///< Fm+ drive bit in SYSCFG->CFGR1
+    i2c_xfer_t xfer;                ///< interrupt-driven transfer
+    i2c_pins_t pins;                ///< SCL/SDA, for bus recovery
+    uint32_t timingr;               ///< last TIMINGR applied, restored after a recovery
+    uint32_t timeout_us;            ///< per-event timeout of blocking transfers
+    uint32_t timeout;               ///< timeout_us in DWT cycles, for the blocking transfer in progress
+    i2c_bus_stats_t stats;
+#ifdef I2C_INSTRUMENT
+    i2c_instr_slot_t *instr_slot;   ///< slot of the transfer in progress
+    uint32_t instr_start;           ///< DWT cycle count when it started
+    i2c_instr_slot_t instr[I2C_INSTR_ADDRS];
+#endif
+} i2c_bus_t;
+
+/* DMA1 request mapping from the reference manual; I2C3's requests need a SYSCFG remap this
+   driver doesn't set up, so it always moves bytes from its interrupt */
+static i2c_bus_t i2c_buses[I2C_INSTANCE_COUNT] = {
+    {.I2Cx = I2C1,
+     .wiring = {I2C1_EV_IRQn, I2C1_ER_IRQn, DMA1_Channel6, DMA1_Channel7, EXTI_IMR_MR23},
+     .rst_bit = RCC_APB1RSTR_I2C1RST_Pos,
+     .sw_bit = RCC_CFGR3_I2C1SW_Pos,
+     .fmp_bit = SYSCFG_CFGR1_I2C1_FMP_Pos,
+     .timeout_us = I2C_TIMEOUT_US},
+    {.I2Cx = I2C2,
+     .wiring = {I2C2_EV_IRQn, I2C2_ER_IRQn, DMA1_Channel4, DMA1_Channel5, EXTI_IMR_MR24},
+     .rst_bit = RCC_APB1RSTR_I2C2RST_Pos,
+     .sw_bit = RCC_CFGR3_I2C2SW_Pos,
+     .fmp_bit = SYSCFG_CFGR1_I2C2_FMP_Pos,
+     .timeout_us = I2C_TIMEOUT_US},
+    {.I2Cx = I2C3,
+     .wiring = {I2C3_EV_IRQn, I2C3_ER_IRQn, NULL, NULL, EXTI_IMR_MR27},
+     .rst_bit = RCC_APB1RSTR_I2C3RST_Pos,
+     .sw_bit = RCC_CFGR3_I2C3SW_Pos,
+     .fmp_bit = SYSCFG_CFGR1_I2C3_FMP_Pos,
+     .timeout_us = I2C_TIMEOUT_US},
+};
+
+static const uint32_t i2c_mode_hz[] = {100000, 400000, 1000000}; // indexed by I2C_Mode
+
+static uint32_t I2C_cr2_addr(uint16_t addr);
+static uint32_t I2C_cr2_read_restart(uint32_t addr, uint32_t len);
+static i2c_bus_t *I2C_bus(I2C_TypeDef *I2Cx);
+static void I2C_reset(const i2c_bus_t *bus);
+static I2C_Status I2C_apply_timing(i2c_bus_t *bus, uint32_t timingr, uint32_t bus_hz);
+static void I2C_enable(const i2c_bus_t *bus);
+static void I2C_recovery_edge(GPIO_TypeDef *GPIOx, uint8_t pin, uint8_t level);
+static uint8_t I2C_source_next(i2c_source_t *src);
+static uint32_t I2C_segments_len(const i2c_segment_t *segs, uint32_t count);
+static I2C_Status I2C_write_source(i2c_bus_t *bus, uint16_t target_addr, i2c_source_t *src, uint32_t len);
+static I2C_Status I2C_transmit(const i2c_bus_t *bus, i2c_source_t *src, uint32_t len, uint32_t end);
+static I2C_Status I2C_receive(const i2c_bus_t *bus, uint8_t *data, uint32_t len);
+static I2C_Status I2C_wait(const i2c_bus_t *bus, uint32_t flag);
+static I2C_Status I2C_end(i2c_bus_t *bus, I2C_Status status, uint32_t bytes);
+static I2C_Status I2C_check(const i2c_bus_t *bus, uint16_t target_addr);
+static I2C_Status I2C_acquire(i2c_bus_t *bus, uint16_t target_addr);
+static void I2C_count(i2c_bus_t *bus, I2C_Status status, uint32_t bytes);
+static void I2C_finish(i2c_bus_t *bus, I2C_Status status);
+#ifdef I2C_INSTRUMENT
+static void I2C_instr_begin(i2c_bus_t *bus, uint16_t target_addr);
+static void I2C_instr_end(i2c_bus_t *bus, I2C_Status status, uint32_t bytes);
+#endif
+static uint32_t I2C_cr2_chunk(uint32_t len, uint32_t end);
+static void I2C_reload(I2C_TypeDef *I2Cx, uint32_t len, uint32_t end);
+static I2C_Status I2C_start(i2c_bus_t *bus, uint16_t target_addr, const i2c_source_t *src, uint32_t tx_len,
+                            uint8_t *rx, uint32_t rx_len, uint8_t use_dma, i2c_callback_t cb, void *ctx);
+static void I2C_ev_irq(i2c_bus_t *bus);
+static void I2C_er_irq(i2c_bus_t *bus);
+
+/**
+ * @brief       Initiates an I2C as controller
+ * @note        TIMINGR comes from the reference manual's tables when the kernel clock is 8, 16 or
+ *              48 MHz and from i2c_timing_solve otherwise; a kernel clock too slow for the mode's
+ *              top speed gets the fastest rate it can meet (see i2c_timing_lookup). Fast_Plus
+ *              needs the SYSCFG clock (rcc_enable_syscfg) for the Fm+ drive setting.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   mode: Standard, Fast or Fast_Plus
+ * @return      I2C_OK, or I2C_INVALID for a bad instance or mode, or if no timing fits the kernel
+ *              clock (the peripheral is left disabled)
+ */
+I2C_Status I2C_init(I2C_TypeDef *I2Cx, I2C_Mode mode)
+{
+    /* see figure 298.I2C in reference manual for initialization flow, page 838 */
+
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    uint32_t bus_hz;
+
+    if (!bus || (mode > Fast_Plus))
+    {
+        return I2C_INVALID;
+    }
+
+    bus_hz = i2c_mode_hz[mode];
+    dwt_init(); // time base of the blocking timeouts and of bus recovery
+    I2C_reset(bus);
+#ifdef I2C_INSTRUMENT
+    I2C_instr_clear(I2Cx);
+#endif
+
+    return I2C_apply_timing(bus, i2c_timing_lookup(I2C_get_clock(I2Cx), bus_hz), bus_hz);
+}
+
+/**
+ * @brief       Puts an I2C instance through an RCC reset, clearing every register.
+ * @param[in]   bus: the instance
+ */
+static void I2C_reset(const i2c_bus_t *bus)
+{
+    BITBAND_PERIPH(RCC->APB1RSTR, bus->rst_bit) = 1; // pulse the reset; the peripheral stays in reset until it's released
+    BITBAND_PERIPH(RCC->APB1RSTR, bus->rst_bit) = 0;
+}
+
+/**
+ * @brief       Returns the kernel clock (I2CCLK) of an I2C instance.
+ * @note        Each instance runs from HSI or SYSCLK, selected in RCC->CFGR3. SYSCLK is taken to be
+ *              SystemCoreClock, i.e. the AHB prescaler is assumed to be 1.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @return      I2CCLK in Hz, or 0 for a bad instance
+ */
+uint32_t I2C_get_clock(I2C_TypeDef *I2Cx)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    if (!bus)
+    {
+        return 0;
+    }
+
+    return BITBAND_PERIPH(RCC->CFGR3, bus->sw_bit) ? SystemCoreClock : I2C_HSI_CLOCK_HZ;
+}
+
+/**
+ * @brief       Selects the kernel clock (I2CCLK) of an I2C instance.
+ * @note        TIMINGR depends on the kernel clock, so call this before I2C_init or
+ *              I2C_set_bus_speed.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   clock: I2C_CLOCK_HSI or I2C_CLOCK_SYSCLK
+ * @return      I2C_OK, or I2C_INVALID for a bad instance
+ */
+I2C_Status I2C_set_clock(I2C_TypeDef *I2Cx, I2C_Clock clock)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    if (!bus)
+    {
+        return I2C_INVALID;
+    }
+
+    BITBAND_PERIPH(RCC->CFGR3, bus->sw_bit) = (clock == I2C_CLOCK_SYSCLK);
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Sets an I2C instance's bus speed for a given rise and fall time.
+ * @note        Use this instead of the mode presets in I2C_init for odd speeds or buses with
+ *              measured edge times. The peripheral is briefly disabled, so call it between
+ *              transfers.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   bus_hz: wanted SCL frequency (at most 1 MHz); the actual one is at or below it
+ * @param[in]   rise_ns: SCL/SDA rise time
+ * @param[in]   fall_ns: SCL/SDA fall time
+ * @return      I2C_OK, or I2C_INVALID for a bad instance or if no timing fits (the peripheral is
+ *              left disabled)
+ */
+I2C_Status I2C_set_bus_speed(I2C_TypeDef *I2Cx, uint32_t bus_hz, uint32_t rise_ns, uint32_t fall_ns)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    if (!bus)
+    {
+        return I2C_INVALID;
+    }
+
+    return I2C_apply_timing(bus, i2c_timing_solve(I2C_get_clock(I2Cx), bus_hz, rise_ns, fall_ns), bus_hz);
+}
+
+/**
+ * @brief       Writes TIMINGR and the Fm+ drive setting, then enables the peripheral.
+ * @param[in]   bus: the instance
+ * @param[in]   timingr: TIMINGR value, or 0 if none was found
+ * @param[in]   bus_hz: SCL frequency timingr was computed for
+ */
+static I2C_Status I2C_apply_timing(i2c_bus_t *bus, uint32_t timingr, uint32_t bus_hz)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+
+    BITBAND_PERIPH(I2Cx->CR1, I2C_CR1_PE_Pos) = 0; // TIMINGR can only be written with the peripheral disabled
+
+    if (!timingr)
+    {
+        return I2C_INVALID;
+    }
+
+    I2Cx->TIMINGR = timingr;
+    bus->timingr = timingr;
+
+    /* slower modes only clear the Fm+ setting if SYSCFG is clocked, so they don't need rcc_enable_syscfg */
+    if ((bus_hz > 400000) || BITBAND_PERIPH(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN_Pos))
+    {
+        BITBAND_PERIPH(SYSCFG->CFGR1, bus->fmp_bit) = (bus_hz > 400000); // stronger drive for fast mode plus
+    }
+
+    I2C_enable(bus);
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Arms the SCL low timeout and enables the peripheral.
+ * @note        TIMEOUTA counts in units of 2048 I2CCLK periods. A target holding SCL low for longer
+ *              than I2C_SCL_TIMEOUT_US sets TIMEOUT, which ends the transfer with I2C_TIMEOUT.
+ * @param[in]   bus: the instance
+ */
+static void I2C_enable(const i2c_bus_t *bus)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    uint32_t units = (uint32_t)(((uint64_t)I2C_get_clock(I2Cx) * I2C_SCL_TIMEOUT_US) / (2048U * 1000000ULL));
+
+    if (units > 0x1000U)
+    {
+        units = 0x1000U; // TIMEOUTA is 12 bits
+    }
+
+    I2Cx->TIMEOUTR = 0; // TIMEOUTA can only be written with TIMOUTEN clear
+    I2Cx->TIMEOUTR = (units ? units - 1 : 0) | I2C_TIMEOUTR_TIMOUTEN;
+
+    BITBAND_PERIPH(I2Cx->CR1, I2C_CR1_PE_Pos) = 1; // set peripheral enable bit
+}
+
+/**
+ * @brief       Sets how long a blocking transfer waits for any one bus event (a byte, a reload,
+ *              the STOP) before giving up with I2C_TIMEOUT.
+ * @note        A blocking transfer of n bytes is bounded by about (n + 3) times this, plus a
+ *              recovery if the bus has to be freed.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   timeout_us: timeout in microseconds (I2C_TIMEOUT_US by default)
+ */
+void I2C_set_timeout(I2C_TypeDef *I2Cx, uint32_t timeout_us)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    if (bus)
+    {
+        bus->timeout_us = timeout_us;
+    }
+}
+
+/**
+ * @brief       Tells the driver which pins an I2C instance uses, so it can free a stuck bus.
+ * @note        The pins must already be set up for I2C (open-drain, alternate function). Without
+ *              them I2C_recover can only reset the peripheral.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   scl_port: SCL's GPIO port (e.g., GPIOB)
+ * @param[in]   scl_pin: SCL's pin (0-15)
+ * @param[in]   sda_port: SDA's GPIO port
+ * @param[in]   sda_pin: SDA's pin (0-15)
+ */
+void I2C_set_bus_pins(I2C_TypeDef *I2Cx, GPIO_TypeDef *scl_port, uint8_t scl_pin, GPIO_TypeDef *sda_port,
+                      uint8_t sda_pin)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    if (bus)
+    {
+        bus->pins.scl_port = scl_port;
+        bus->pins.scl_pin = scl_pin;
+        bus->pins.sda_port = sda_port;
+        bus->pins.sda_pin = sda_pin;
+    }
+}
+
+/**
+ * @brief       Frees a stuck bus and re-initializes the peripheral.
+ * @note        A target that was reset or glitched in the middle of a read can hold SDA low while it
+ *              waits for clocks that never come. With the pins registered, SCL is driven as a GPIO
+ *              for up to nine clocks until the target lets go of SDA, then a STOP is sent. The
+ *              peripheral then goes through the same RCC reset as I2C_init and gets its timing,
+ *              own addresses (OAR1, OAR2) and CR1 settings back. Takes at most about 110 us.
+ *              Pins whose configuration is locked (gpio_lock_pins) can't be switched to GPIO, so
+ *              the bus isn't clocked; the peripheral is still reset.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @return      I2C_OK if the bus is free afterwards, I2C_BUSY if SDA is still held low (or, without
+ *              registered pins, the bus is still busy), I2C_INVALID for a bad instance or if a
+ *              registered pin is locked
+ */
+I2C_Status I2C_recover(I2C_TypeDef *I2Cx)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    const i2c_pins_t *pins;
+    I2C_Status status = I2C_OK;
+    uint32_t cr1, oar1, oar2;
+
+    if (!bus)
+    {
+        return I2C_INVALID;
+    }
+
+    pins = &bus->pins;
+    BITBAND_PERIPH(I2Cx->CR1, I2C_CR1_PE_Pos) = 0;
+    cr1 = I2Cx->CR1; // the RCC reset below clears these
+    oar1 = I2Cx->OAR1;
+    oar2 = I2Cx->OAR2;
+
+    if (pins->scl_port && ((gpio_locked_pins(pins->scl_port) & (1U << pins->scl_pin)) ||
+                           (gpio_locked_pins(pins->sda_port) & (1U << pins->sda_pin))))
+    {
+        status = I2C_INVALID; // gpio_set_mode would silently leave them as they are
+    }
+    else if (pins->scl_port)
+    {
+        gpio_set_pins(pins->scl_port, 1U << pins->scl_pin); // released (open-drain) once in output mode
+        gpio_set_pins(pins->sda_port, 1U << pins->sda_pin);
+        gpio_set_mode(pins->scl_port, pins->scl_pin, OUTPUT);
+        gpio_set_mode(pins->sda_port, pins->sda_pin, OUTPUT);
+
+        for (uint8_t i = 0; (i < 9) && !gpio_read_pins(pins->sda_port, 1U << pins->sda_pin); i++)
+        {
+            I2C_recovery_edge(pins->scl_port, pins->scl_pin, 0);
+            I2C_recovery_edge(pins->scl_port, pins->scl_pin, 1);
+        }
+
+        /* STOP: SDA rises while SCL is high */
+        I2C_recovery_edge(pins->scl_port, pins->scl_pin, 0);
+        I2C_recovery_edge(pins->sda_port, pins->sda_pin, 0);
+        I2C_recovery_edge(pins->scl_port, pins->scl_pin, 1);
+        I2C_recovery_edge(pins->sda_port, pins->sda_pin, 1);
+
+        if (!gpio_read_pins(pins->sda_port, 1U << pins->sda_pin))
+        {
+            status = I2C_BUSY;
+        }
+
+        gpio_set_mode(pins->scl_port, pins->scl_pin, ALTERNATE);
+        gpio_set_mode(pins->sda_port, pins->sda_pin, ALTERNATE);
+    }
+
+    I2C_reset(bus);
+    I2Cx->TIMINGR = bus->timingr;
+    I2Cx->OAR1 = oar1;
+    I2Cx->OAR2 = oar2;
+    I2Cx->CR1 = cr1; // filters and interrupt enables; PE is still clear
+    I2C_enable(bus);
+
+    if (!pins->scl_port && BITBAND_PERIPH(I2Cx->ISR, I2C_ISR_BUSY_Pos))
+    {
+        status = I2C_BUSY;
+    }
+
+    return status;
+}
+
+/**
+ * @brief       Drives a recovery pin to a level and holds it for half an SCL period.
+ * @param[in]   GPIOx: the pin's port
+ * @param[in]   pin: the pin (0-15)
+ * @param[in]   level: 0 to pull low, 1 to release
+ */
+static void I2C_recovery_edge(GPIO_TypeDef *GPIOx, uint8_t pin, uint8_t level)
+{
+    uint32_t start = dwt_cycles();
+    uint32_t half = dwt_us_to_cycles(I2C_RECOVERY_HALF_PERIOD_US);
+
+    if (level)
+    {
+        gpio_set_pins(GPIOx, 1U << pin);
+    }
+    else
+    {
+        gpio_reset_pins(GPIOx, 1U << pin);
+    }
+
+    while (dwt_cycles() - start < half)
+    {
+        ;
+    }
+}
+
+/**
+ * @brief       Returns the address bits of CR2 (SADD and ADD10) for a target.
+ * @param[in]   addr: target device 7 or 10-bit address
+ */
+static uint32_t I2C_cr2_addr(uint16_t addr)
+{
+    if (addr > 127) // we're using 10-bit addressing
+    {
+        return I2C_CR2_ADD10 | addr; // CR2 bits 9:0 hold the target address
+    }
+
+    return (uint32_t)addr << 1; // CR2 bits 7:1 hold the target address
+}
+
+/**
+ * @brief       Returns CR2, without START, for the read phase that follows a write to the same target.
+ * @note        With a 10-bit address HEAD10R is set, so the repeated START is followed by only the
+ *              read header; the target is still addressed from the write phase. Without it the
+ *              hardware would resend the full write header and restart again.
+ * @param[in]   addr: address bits from I2C_cr2_addr
+ * @param[in]   len: number of bytes to read
+ */
+static uint32_t I2C_cr2_read_restart(uint32_t addr, uint32_t len)
+{
+    uint32_t cr2 = addr | I2C_CR2_RD_WRN | I2C_cr2_chunk(len, I2C_CR2_AUTOEND);
+
+    if (addr & I2C_CR2_ADD10)
+    {
+        cr2 |= I2C_CR2_HEAD10R;
+    }
+
+    return cr2;
+}
+
+/**
+ * @brief       Checks that a blocking or interrupt-driven transfer can be started.
+ * @param[in]   bus: the instance, or NULL if the caller passed a bad one
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @return      I2C_OK, I2C_INVALID for a bad instance or address, or I2C_BUSY if the bus is in use
+ */
+static I2C_Status I2C_check(const i2c_bus_t *bus, uint16_t target_addr)
+{
+    if (!bus || (target_addr > 1023)) // address is more than 10 bits; invalid
+    {
+        return I2C_INVALID;
+    }
+
+    if (bus->xfer.busy || BITBAND_PERIPH(bus->I2Cx->ISR, I2C_ISR_BUSY_Pos))
+    {
+        return I2C_BUSY;
+    }
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Gets the bus for a blocking transfer, freeing it first if it's stuck.
+ * @note        Waits up to the instance's timeout for a transfer by another controller to end. If
+ *              the bus is still busy after that, a recovery is tried.
+ *              Also sets the per-event timeout the transfer's waits use.
+ * @param[in]   bus: the instance, or NULL if the caller passed a bad one
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @return      I2C_OK, I2C_INVALID, I2C_BUSY if an interrupt-driven transfer is in flight, or
+ *              I2C_TIMEOUT if the bus couldn't be freed
+ */
+static I2C_Status I2C_acquire(i2c_bus_t *bus, uint16_t target_addr)
+{
+    I2C_Status status = I2C_check(bus, target_addr);
+
+    if ((status == I2C_INVALID) || ((status == I2C_BUSY) && bus->xfer.busy))
+    {
+        return status;
+    }
+
+    bus->timeout = dwt_us_to_cycles(bus->timeout_us);
+
+    if ((status == I2C_BUSY) && (I2C_wait(bus, 0) == I2C_TIMEOUT) && (I2C_recover(bus->I2Cx) != I2C_OK))
+    {
+        return I2C_TIMEOUT;
+    }
+
+#ifdef I2C_INSTRUMENT
+    I2C_instr_begin(bus, target_addr);
+#endif
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Writes a number of bytes to the target device.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   data: address of data array to send
+ * @param[in]   len: length of data array
+ * @return      I2C_OK, I2C_NACK, I2C_ARLO, I2C_BERR, I2C_TIMEOUT, I2C_BUSY or I2C_INVALID
+ */
+I2C_Status I2C_write_bytes(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *data, uint32_t len)
+{
+    i2c_source_t src = {data, len, NULL, 0, NULL, NULL};
+
+    return I2C_write_source(I2C_bus(I2Cx), target_addr, &src, len);
+}
+
+/**
+ * @brief       Checks whether a target device acknowledges its address, with a write of no bytes.
+ * @note        Also how to poll a device that ignores its address while busy, e.g. an EEPROM in
+ *              its write cycle.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @return      I2C_OK if it acknowledged, I2C_NACK if not, or I2C_ARLO, I2C_BERR, I2C_TIMEOUT,
+ *              I2C_BUSY or I2C_INVALID
+ */
+I2C_Status I2C_probe(I2C_TypeDef *I2Cx, uint16_t target_addr)
+{
+    i2c_source_t src = {NULL, 0, NULL, 0, NULL, NULL};
+
+    return I2C_write_source(I2C_bus(I2Cx), target_addr, &src, 0);
+}
+
+/**
+ * @brief       Writes a list of buffers to the target device as one transfer.
+ * @note        The segments go out back to back after a single address, so a header and a payload
+ *              held in different places don't need to be copied together first.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   segs: segments to send, in order
+ * @param[in]   count: number of segments
+ * @return      I2C_OK, I2C_NACK, I2C_ARLO, I2C_BERR, I2C_TIMEOUT, I2C_BUSY or I2C_INVALID
+ */
+I2C_Status I2C_write_segments(I2C_TypeDef *I2Cx, uint16_t target_addr, const i2c_segment_t *segs, uint32_t count)
+{
+    i2c_source_t src = {NULL, 0, segs, count, NULL, NULL};
+
+    return I2C_write_source(I2C_bus(I2Cx), target_addr, &src, I2C_segments_len(segs, count));
+}
+
+/**
+ * @brief       Writes bytes pulled from a producer callback to the target device as one transfer.
+ * @note        The producer is called whenever the previous piece has been sent, and points *data at
+ *              the next piece and returns its length. It must supply len bytes in total; if it
+ *              returns 0 first, the rest of the transfer is padded with 0xFF. Only the current piece
+ *              has to exist in memory, however long the transfer.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   len: total number of bytes to send
+ * @param[in]   producer: supplies the bytes
+ * @param[in]   producer_ctx: passed to producer
+ * @return      I2C_OK, I2C_NACK, I2C_ARLO, I2C_BERR, I2C_TIMEOUT, I2C_BUSY or I2C_INVALID
+ */
+I2C_Status I2C_write_stream(I2C_TypeDef *I2Cx, uint16_t target_addr, uint32_t len, i2c_producer_t producer,
+                            void *producer_ctx)
+{
+    i2c_source_t src = {NULL, 0, NULL, 0, producer, producer_ctx};
+
+    return I2C_write_source(I2C_bus(I2Cx), target_addr, &src, len);
+}
+
+/**
+ * @brief       Blocking write of len bytes from a source, ending with STOP.
+ * @param[in]   bus: the instance, or NULL if the caller passed a bad one
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   src: where the bytes come from
+ * @param[in]   len: number of bytes to send
+ */
+static I2C_Status I2C_write_source(i2c_bus_t *bus, uint16_t target_addr, i2c_source_t *src, uint32_t len)
+{
+    I2C_Status status = I2C_acquire(bus, target_addr);
+
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    bus->I2Cx->CR2 = I2C_cr2_addr(target_addr) | I2C_cr2_chunk(len, I2C_CR2_AUTOEND) | I2C_CR2_START;
+
+    return I2C_end(bus, I2C_transmit(bus, src, len, I2C_CR2_AUTOEND), len);
+}
+
+/**
+ * @brief       Total length of a list of segments.
+ * @param[in]   segs: segments
+ * @param[in]   count: number of segments
+ */
+static uint32_t I2C_segments_len(const i2c_segment_t *segs, uint32_t count)
+{
+    uint32_t len = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        len += segs[i].len;
+    }
+
+    return len;
+}
+
+/**
+ * @brief       Returns the next byte of a source, moving on to the next segment or asking the
+ *              producer for the next piece when the current one is used up.
+ * @param[in]   src: source
+ * @return      the byte, or 0xFF once the source has run dry
+ */
+static uint8_t I2C_source_next(i2c_source_t *src)
+{
+    while (!src->len)
+    {
+        if (src->seg_count)
+        {
+            src->data = src->seg->data;
+            src->len = src->seg->len;
+            src->seg++;
+            src->seg_count--;
+        }
+        else if (src->producer)
+        {
+            src->len = src->producer(&src->data, src->producer_ctx);
+
+            if (!src->len)
+            {
+                src->producer = NULL; // dry; don't ask again
+            }
+        }
+        else
+        {
+            return 0xFF;
+        }
+    }
+
+    src->len--;
+
+    return *src->data++;
+}
+
+/**
+ * @brief       Reads a number of bytes from the target device.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[out]  data: where to put the received bytes
+ * @param[in]   len: number of bytes to read (at least 1)
+ * @return      I2C_OK, I2C_NACK, I2C_ARLO, I2C_BERR, I2C_TIMEOUT, I2C_BUSY or I2C_INVALID
+ */
+I2C_Status I2C_read_bytes(I2C_TypeDef *I2Cx, uint16_t target_addr, uint8_t *data, uint32_t len)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    I2C_Status status;
+
+    if (!len)
+    {
+        return I2C_INVALID; // a read always clocks in at least one byte
+    }
+
+    status = I2C_acquire(bus, target_addr);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    /* HEAD10R stays clear, so a 10-bit read sends the full write header, then restarts with the read header */
+    I2Cx->CR2 = I2C_cr2_addr(target_addr) | I2C_CR2_RD_WRN | I2C_cr2_chunk(len, I2C_CR2_AUTOEND) | I2C_CR2_START;
+
+    return I2C_end(bus, I2C_receive(bus, data, len), len);
+}
+
+/**
+ * @brief       Writes bytes to the target device, then reads from it after a repeated START.
+ * @note        There is no STOP between the phases, so no other controller can take the bus and
+ *              the target keeps any register pointer set by the write. This is the usual way to read
+ *              a sensor register: tx holds the register address.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   tx: bytes to send
+ * @param[in]   tx_len: number of bytes to send
+ * @param[out]  rx: where to put the received bytes
+ * @param[in]   rx_len: number of bytes to read (at least 1)
+ * @return      I2C_OK, I2C_NACK, I2C_ARLO, I2C_BERR, I2C_TIMEOUT, I2C_BUSY or I2C_INVALID
+ */
+I2C_Status I2C_write_read(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *tx, uint32_t tx_len, uint8_t *rx,
+                          uint32_t rx_len)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    uint32_t addr = I2C_cr2_addr(target_addr);
+    i2c_source_t src = {tx, tx_len, NULL, 0, NULL, NULL};
+    I2C_Status status;
+
+    if (!rx_len)
+    {
+        return I2C_INVALID;
+    }
+
+    status = I2C_acquire(bus, target_addr);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    I2Cx->CR2 = addr | I2C_cr2_chunk(tx_len, 0) | I2C_CR2_START; // no AUTOEND: the hardware holds the bus with TC set
+
+    status = I2C_transmit(bus, &src, tx_len, 0);
+
+    if (status == I2C_OK)
+    {
+        status = I2C_wait(bus, I2C_ISR_TC); // I2C_NACK if the last byte was NACKed
+    }
+    if (status != I2C_OK)
+    {
+        return I2C_end(bus, status, 0);
+    }
+
+    I2Cx->CR2 = I2C_cr2_read_restart(addr, rx_len) | I2C_CR2_START;
+
+    return I2C_end(bus, I2C_receive(bus, rx, rx_len), tx_len + rx_len);
+}
+
+/**
+ * @brief       Sends bytes from a source to a target device, reloading NBYTES every 255 bytes.
+ * @note        The caller has already written the first chunk to CR2 and set START. Stack use is
+ *              the same for any length.
+ * @param[in]   bus: the instance
+ * @param[in]   src: where the bytes come from
+ * @param[in]   len: number of bytes to send
+ * @param[in]   end: I2C_CR2_AUTOEND to send STOP after the last byte, 0 to hold the bus with TC set
+ * @return      I2C_OK, or the error that ended the transfer (after I2C_NACK the hardware sends STOP)
+ */
+static I2C_Status I2C_transmit(const i2c_bus_t *bus, i2c_source_t *src, uint32_t len, uint32_t end)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    I2C_Status status = I2C_OK;
+
+    while (len && (status == I2C_OK))
+    {
+        uint32_t n_bytes = (len > I2C_NBYTES_MAX) ? I2C_NBYTES_MAX : len;
+
+        for (uint32_t i = 0; (i < n_bytes) && (status == I2C_OK); i++)
+        {
+            status = I2C_wait(bus, I2C_ISR_TXIS);
+
+            if (status == I2C_OK)
+            {
+                I2Cx->TXDR = I2C_source_next(src); // put next byte in the TXDR register
+            }
+        }
+
+        len -= n_bytes;
+
+        if (len && (status == I2C_OK))
+        {
+            status = I2C_wait(bus, I2C_ISR_TCR);
+
+            if (status == I2C_OK)
+            {
+                I2C_reload(I2Cx, len, end);
+            }
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief       Receives bytes from a target device, reloading NBYTES every 255 bytes.
+ * @note        The caller has already written the first chunk to CR2 and set START. The last
+ *              chunk always ends with AUTOEND.
+ * @param[in]   bus: the instance
+ * @param[out]  data: where to put the received bytes
+ * @param[in]   len: number of bytes to receive
+ * @return      I2C_OK, or the error that ended the transfer
+ */
+static I2C_Status I2C_receive(const i2c_bus_t *bus, uint8_t *data, uint32_t len)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    I2C_Status status = I2C_OK;
+
+    while (len && (status == I2C_OK))
+    {
+        uint32_t n_bytes = (len > I2C_NBYTES_MAX) ? I2C_NBYTES_MAX : len;
+
+        for (uint32_t i = 0; (i < n_bytes) && (status == I2C_OK); i++)
+        {
+            status = I2C_wait(bus, I2C_ISR_RXNE);
+
+            if (status == I2C_OK)
+            {
+                *data++ = (uint8_t)I2Cx->RXDR;
+            }
+        }
+
+        len -= n_bytes;
+
+        if (len && (status == I2C_OK))
+        {
+            status = I2C_wait(bus, I2C_ISR_TCR);
+
+            if (status == I2C_OK)
+            {
+                I2C_reload(I2Cx, len, I2C_CR2_AUTOEND);
+            }
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief       Spins until an ISR flag is set, an error is flagged or the bus's timeout runs out.
+ * @note        NACKF counts as an error except while waiting for STOPF, which follows it. With flag
+ *              0 it waits for the bus to go idle (BUSY clear) instead.
+ * @param[in]   bus: the instance
+ * @param[in]   flag: I2C_ISR_* flag to wait for, or 0
+ * @return      I2C_OK, I2C_NACK, I2C_ARLO, I2C_BERR or I2C_TIMEOUT
+ */
+static I2C_Status I2C_wait(const i2c_bus_t *bus, uint32_t flag)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    uint32_t errors = I2C_ERRORS | ((flag == I2C_ISR_STOPF) ? 0 : I2C_ISR_NACKF);
+    uint32_t start = dwt_cycles();
+
+    while (1)
+    {
+        uint32_t isr = I2Cx->ISR;
+
+        if (flag ? (isr & flag) : !(isr & I2C_ISR_BUSY))
+        {
+            return I2C_OK;
+        }
+        if (flag && (isr & errors))
+        {
+            if (isr & I2C_ISR_NACKF)
+            {
+                return I2C_NACK;
+            }
+            if (isr & I2C_ISR_ARLO)
+            {
+                return I2C_ARLO;
+            }
+
+            return (isr & I2C_ISR_BERR) ? I2C_BERR : I2C_TIMEOUT; // TIMEOUT: SCL held low too long
+        }
+        if (dwt_cycles() - start >= bus->timeout)
+        {
+            return I2C_TIMEOUT;
+        }
+    }
+}
 
 /**
- * @brief       Initiates an I2C as controller
- * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
- * @param[in]   mode: Standard, Fast or Fast_Plus
+ * @brief       Ends a blocking transfer: waits for its STOP, clears the flags, frees the bus if
+ *              the transfer broke down and counts it.
+ * @param[in]   bus: the instance
+ * @param[in]   status: result of the transfer
+ * @param[in]   bytes: bytes the transfer moves if it succeeds
+ * @return      status, or the error that came up while waiting for the STOP
  */
-void I2C_init(I2C_TypeDef *I2Cx, I2C_Mode mode)
+static I2C_Status I2C_end(i2c_bus_t *bus, I2C_Status status, uint32_t bytes)
 {
-    /* see figure 298.I2C in reference manual for initialization flow, page 838 */
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+
+    if ((status == I2C_OK) || (status == I2C_NACK)) // both end with a STOP sent by the hardware
+    {
+        I2C_Status stop = I2C_wait(bus, I2C_ISR_STOPF);
 
-    if (I2Cx == I2C1)
+        if (stop != I2C_OK)
+        {
+            status = stop;
+        }
+        else if (I2Cx->ISR & I2C_ISR_NACKF) // a NACKed address with no bytes to send isn't waited on
+        {
+            status = I2C_NACK;
+        }
+    }
+
+    I2Cx->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF | I2C_ICR_ARLOCF | I2C_ICR_BERRCF | I2C_ICR_TIMOUTCF;
+    I2Cx->ISR = I2C_ISR_TXE; // flush a byte left in TXDR by a NACK
+
+    if ((status == I2C_BERR) || (status == I2C_TIMEOUT))
     {
-        RCC->APB1RSTR |= (1U << 21); // reset I2C1
+        I2C_recover(I2Cx);
     }
-    else if (I2Cx == I2C2)
+
+    I2C_count(bus, status, bytes);
+
+    return status;
+}
+
+/**
+ * @brief       Adds a finished transfer to the bus's counters.
+ * @param[in]   bus: the instance
+ * @param[in]   status: result of the transfer
+ * @param[in]   bytes: bytes the transfer moves if it succeeds
+ */
+static void I2C_count(i2c_bus_t *bus, I2C_Status status, uint32_t bytes)
+{
+    bus->stats.transfers++;
+
+    if (status == I2C_OK)
     {
-        RCC->APB1RSTR |= (1U << 22); // reset I2C2
+        bus->stats.bytes += bytes;
     }
     else
     {
-        RCC->APB1RSTR |= (1U << 30); // reset I2C3
+        bus->stats.errors++;
+    }
+
+#ifdef I2C_INSTRUMENT
+    I2C_instr_end(bus, status, bytes);
+#endif
+}
+
+/**
+ * @brief       Copies an instance's transfer counters.
+ * @note        The counters cover blocking and interrupt-driven controller transfers. They are
+ *              copied with interrupts masked, so they're consistent with each other.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[out]  stats: where to put the counters
+ * @return      I2C_OK, or I2C_INVALID for a bad instance
+ */
+I2C_Status I2C_get_stats(I2C_TypeDef *I2Cx, i2c_bus_stats_t *stats)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    uint32_t primask;
+
+    if (!bus)
+    {
+        return I2C_INVALID;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = bus->stats;
+    __set_PRIMASK(primask);
+
+    return I2C_OK;
+}
+
+#ifdef I2C_INSTRUMENT
+/**
+ * @brief       Notes the start of a transfer: its time, and the slot of its target address.
+ * @note        The first I2C_INSTR_ADDRS - 1 addresses seen get a slot each; the last slot
+ *              collects every other address.
+ * @param[in]   bus: the instance
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ */
+static void I2C_instr_begin(i2c_bus_t *bus, uint16_t target_addr)
+{
+    i2c_instr_slot_t *slot = bus->instr;
+
+    while ((slot < &bus->instr[I2C_INSTR_ADDRS - 1]) && (slot->addr != target_addr) &&
+           (slot->addr != I2C_INSTR_ADDR_NONE))
+    {
+        slot++;
+    }
+
+    if (slot->addr == I2C_INSTR_ADDR_NONE)
+    {
+        slot->addr = (slot == &bus->instr[I2C_INSTR_ADDRS - 1]) ? I2C_INSTR_ADDR_OTHER : target_addr;
+    }
+
+    bus->instr_slot = slot;
+    bus->instr_start = dwt_cycles();
+}
+
+/**
+ * @brief       Adds a finished transfer to its address's counters and latency histogram.
+ * @note        Bucket 0 holds latencies under 2^I2C_INSTR_SHIFT cycles and bucket k those under
+ *              2^(I2C_INSTR_SHIFT + k); the last bucket also takes anything longer.
+ * @param[in]   bus: the instance
+ * @param[in]   status: result of the transfer
+ * @param[in]   bytes: bytes the transfer moves if it succeeds
+ */
+static void I2C_instr_end(i2c_bus_t *bus, I2C_Status status, uint32_t bytes)
+{
+    i2c_instr_slot_t *slot = bus->instr_slot;
+    uint32_t now = dwt_cycles();
+    uint32_t latency = now - bus->instr_start;
+    uint32_t scaled = latency >> I2C_INSTR_SHIFT;
+    uint32_t bucket = scaled ? 32U - __CLZ(scaled) : 0;
+
+    slot->transactions++;
+    slot->last_end = now;
+    slot->latency[(bucket < I2C_INSTR_BUCKETS) ? bucket : I2C_INSTR_BUCKETS - 1]++;
+
+    if (latency > slot->max_latency)
+    {
+        slot->max_latency = latency;
     }
 
-    switch (mode)
+    switch (status)
     {
-    case Standard:
-        I2C_set_standard_timing(I2Cx);
+    case I2C_OK:
+        slot->bytes += bytes;
+        break;
+    case I2C_NACK:
+        slot->nacks++;
         break;
-    case Fast:
-        I2C_set_fast_timing(I2Cx);
+    case I2C_ARLO:
+        slot->arb_lost++;
         break;
-    case Fast_Plus:
-        I2C_set_fast_plus_timing(I2Cx);
+    case I2C_TIMEOUT:
+        slot->timeouts++;
         break;
     default:
+        slot->bus_errors++;
         break;
     }
+}
+
+/**
+ * @brief       Copies an instance's per-address counters and histograms, e.g. for export over a
+ *              UART.
+ * @note        The copy is taken with interrupts masked, so it's consistent. Slots with addr
+ *              I2C_INSTR_ADDR_NONE are unused.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[out]  snap: where to put the copy
+ * @return      I2C_OK, or I2C_INVALID for a bad instance
+ */
+I2C_Status I2C_instr_snapshot(I2C_TypeDef *I2Cx, i2c_instr_snapshot_t *snap)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    uint32_t primask;
+
+    if (!bus)
+    {
+        return I2C_INVALID;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    snap->taken_at = dwt_cycles();
+    for (uint8_t i = 0; i < I2C_INSTR_ADDRS; i++)
+    {
+        snap->slots[i] = bus->instr[i];
+    }
+
+    __set_PRIMASK(primask);
 
-    I2Cx->CR1 |= (1U << 0); // set peripheral enable bit
+    return I2C_OK;
 }
 
 /**
- * @brief       Sets necessary I2C registers to perform a write operation.
+ * @brief       Zeroes an instance's per-address counters and frees their slots. I2C_init does
+ *              this too.
  * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
- * @param[in]   addr: target device 7 or 10-bit address
+ * @return      I2C_OK, or I2C_INVALID for a bad instance
  */
-static void I2C_set_CR2_reg_for_write(I2C_TypeDef *I2Cx, uint16_t addr)
+I2C_Status I2C_instr_clear(I2C_TypeDef *I2Cx)
 {
-    if (addr > 127) // we're using 10-bit addressing
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+    static const i2c_instr_slot_t empty = {.addr = I2C_INSTR_ADDR_NONE};
+    uint32_t primask;
+
+    if (!bus)
+    {
+        return I2C_INVALID;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint8_t i = 0; i < I2C_INSTR_ADDRS; i++)
+    {
+        bus->instr[i] = empty;
+    }
+    bus->instr_slot = &bus->instr[I2C_INSTR_ADDRS - 1];
+
+    __set_PRIMASK(primask);
+
+    return I2C_OK;
+}
+
+#endif /* I2C_INSTRUMENT */
+
+/**
+ * @brief       Finds an instance's driver state.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @return      the instance's state, or NULL if I2Cx isn't an I2C instance
+ */
+static i2c_bus_t *I2C_bus(I2C_TypeDef *I2Cx)
+{
+    for (uint8_t i = 0; i < I2C_INSTANCE_COUNT; i++)
     {
-        I2Cx->CR2 |= I2C_CR2_ADD10;
-        I2Cx->CR2 |= ((uint32_t)addr);   // set I2C->CR2 bits 9:0 to target address
-        I2Cx->CR2 &= ~(I2C_CR2_HEAD10R); // send 10-bit address header
+        if (i2c_buses[i].I2Cx == I2Cx)
+        {
+            return &i2c_buses[i];
+        }
     }
-    else // we're using 7-bit addressing
+
+    return NULL;
+}
+
+/**
+ * @brief       Returns the NBYTES/RELOAD/AUTOEND bits of CR2 for the next chunk of a transfer.
+ * @note        Chunks of 255 bytes are sent with RELOAD set, so the hardware stops with TCR set and
+ *              SCL stretched until NBYTES is reloaded. The last chunk gets end: with AUTOEND the
+ *              STOP condition follows it without CPU help, without it TC is set and the bus held.
+ * @param[in]   len: bytes left to schedule
+ * @param[in]   end: I2C_CR2_AUTOEND or 0
+ */
+static uint32_t I2C_cr2_chunk(uint32_t len, uint32_t end)
+{
+    if (len > I2C_NBYTES_MAX)
     {
-        I2Cx->CR2 &= ~(I2C_CR2_ADD10);
-        I2Cx->CR2 |= ((uint32_t)addr << 1); // set I2C->CR2 bits 7:1 to target address
-        I2Cx->CR2 |= I2C_CR2_HEAD10R;       // send 7-bit address header
+        return (I2C_NBYTES_MAX << I2C_CR2_NBYTES_Pos) | I2C_CR2_RELOAD;
     }
 
-    I2Cx->CR2 &= ~(I2C_CR2_RD_WRN); // 0 = controller requests a write transfer
+    return (len << I2C_CR2_NBYTES_Pos) | end;
 }
 
 /**
- * @brief       Set timing registers for an I2C instance to fast mode (400 kHz).
+ * @brief       Loads the next chunk after TCR. Writing NBYTES releases SCL and clears TCR.
  * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   len: bytes left to schedule
+ * @param[in]   end: I2C_CR2_AUTOEND or 0
+ */
+static void I2C_reload(I2C_TypeDef *I2Cx, uint32_t len, uint32_t end)
+{
+    I2Cx->CR2 = (I2Cx->CR2 & ~(I2C_CR2_NBYTES | I2C_CR2_RELOAD | I2C_CR2_AUTOEND)) | I2C_cr2_chunk(len, end);
+}
+
+/**
+ * @brief       Starts a controller transfer and returns immediately.
+ * @note        With tx and rx both set the write phase is followed by a repeated START and the read
+ *              phase; with only one set the transfer goes in that direction. With use_dma, a DMA
+ *              channel moves the bytes of a one-direction transfer and the interrupt only reloads
+ *              NBYTES and ends it; otherwise the interrupt moves every byte. Instances without a
+ *              DMA mapping always use the interrupt.
+ * @param[in]   bus: the instance, or NULL if the caller passed a bad one
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   src: where the bytes to send come from, or NULL for a read
+ * @param[in]   tx_len: number of bytes to send
+ * @param[out]  rx: where to put received bytes, or NULL for a write
+ * @param[in]   rx_len: number of bytes to read
+ * @param[in]   use_dma: 1 to move the bytes with DMA if the instance has a channel for it
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
  */
-static void I2C_set_fast_timing(I2C_TypeDef *I2Cx)
+static I2C_Status I2C_start(i2c_bus_t *bus, uint16_t target_addr, const i2c_source_t *src, uint32_t tx_len,
+                            uint8_t *rx, uint32_t rx_len, uint8_t use_dma, i2c_callback_t cb, void *ctx)
 {
-    /*
-     * I2C1 uses 8 MHz HSI clock by default; can use SYSCLOCK by setting bit 4 on RCC->CFGR3.
-     * See table 149 in reference manual, page 862, for timing calculations using 8 MHz I2CCLK
-     *
-     * Note - PRESC[3:0] is 0x0 in fast mode.
-     */
+    I2C_Status status = I2C_check(bus, target_addr);
+    uint8_t reading = (src == NULL); // the first phase is a read
+    uint32_t len = reading ? rx_len : tx_len;
+    uint32_t cr1_irqs = I2C_CR1_TCIE | I2C_CR1_NACKIE | I2C_CR1_STOPIE | I2C_CR1_ERRIE;
+    I2C_TypeDef *I2Cx;
+    i2c_xfer_t *xfer;
+
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+    if ((rx && !rx_len) || (use_dma && (len > 0xFFFFU)))
+    {
+        return I2C_INVALID;
+    }
+
+    I2Cx = bus->I2Cx;
+    xfer = &bus->xfer;
+
+    if (src)
+    {
+        xfer->src = *src;
+    }
+    xfer->rx = rx;
+    xfer->remaining = len;
+    xfer->unscheduled = (len > I2C_NBYTES_MAX) ? len - I2C_NBYTES_MAX : 0;
+    xfer->rx_pending = (src && rx) ? rx_len : 0;
+    xfer->bytes = (src ? tx_len : 0) + (rx ? rx_len : 0);
+    xfer->end = xfer->rx_pending ? 0 : I2C_CR2_AUTOEND;
+    xfer->addr = I2C_cr2_addr(target_addr);
+    xfer->dma = NULL;
+    xfer->cb = cb;
+    xfer->ctx = ctx;
+    xfer->status = I2C_OK;
+    xfer->busy = 1;
+#ifdef I2C_INSTRUMENT
+    I2C_instr_begin(bus, target_addr);
+#endif
+
+    /* DMA needs the bytes in one buffer */
+    if (use_dma && len && !xfer->rx_pending && (reading || (!src->seg_count && !src->producer)))
+    {
+        xfer->dma = reading ? bus->wiring.dma_rx : bus->wiring.dma_tx;
+    }
+
+    /* don't let flags from an earlier transfer end this one */
+    I2Cx->ICR = I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_ARLOCF | I2C_ICR_BERRCF | I2C_ICR_TIMOUTCF;
+
+    if (xfer->dma)
+    {
+        xfer->remaining = 0;
+
+        /* completion is seen on STOPF, so the channel needs no interrupt of its own */
+        dma_channel_set_callback(xfer->dma, NULL, NULL);
+
+        if (reading)
+        {
+            dma_channel_configure(xfer->dma, &I2Cx->RXDR, rx, (uint16_t)len,
+                                  DMA_CCR_MINC | DMA_CCR_PL_1);
+            cr1_irqs |= I2C_CR1_RXDMAEN;
+        }
+        else
+        {
+            dma_channel_configure(xfer->dma, &I2Cx->TXDR, src->data, (uint16_t)len,
+                                  DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PL_1);
+            cr1_irqs |= I2C_CR1_TXDMAEN;
+        }
+
+        dma_channel_start(xfer->dma);
+    }
+    else
+    {
+        cr1_irqs |= reading ? I2C_CR1_RXIE : I2C_CR1_TXIE;
+    }
 
-    I2Cx->TIMINGR |= (1U << 16); // SDADEL[3:0] (bits 19:16) = 0x1 = 0001
+    I2Cx->CR1 |= cr1_irqs;
+    NVIC_EnableIRQ(bus->wiring.ev_irq);
+    NVIC_EnableIRQ(bus->wiring.er_irq);
 
-    I2Cx->TIMINGR |= (1U << 20); // SCLDEL[3:0] (bits 23:20) = 0x3 = 0011
-    I2Cx->TIMINGR |= (1U << 21);
+    I2Cx->CR2 = xfer->addr | (reading ? I2C_CR2_RD_WRN : 0) | I2C_cr2_chunk(len, xfer->end) | I2C_CR2_START;
+
+    return I2C_OK;
+}
 
-    I2Cx->TIMINGR |= (1U << 8); // SCLH[7:0] (bits 15:8) = 0x3 = 0000 0011
-    I2Cx->TIMINGR |= (1U << 9);
+/**
+ * @brief       Starts an interrupt-driven write and returns immediately.
+ * @note        The transfer is driven by the instance's event interrupt: TXIS loads the next byte,
+ *              TCR reloads NBYTES every 255 bytes, and STOPF ends the transfer and calls cb. A
+ *              length of 0 sends only the address, which is a quick way to probe for a device.
+ *              data must stay valid until cb is called.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   data: bytes to send
+ * @param[in]   len: number of bytes to send
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
+ */
+I2C_Status I2C_write_async(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *data, uint32_t len,
+                           i2c_callback_t cb, void *ctx)
+{
+    i2c_source_t src = {data, len, NULL, 0, NULL, NULL};
 
-    I2Cx->TIMINGR |= (1U << 0); // SCLL[7:0] (bits 7:0) = 0x9 = 0000 1001
-    I2Cx->TIMINGR |= (1U << 3);
+    return I2C_start(I2C_bus(I2Cx), target_addr, &src, len, NULL, 0, 0, cb, ctx);
 }
 
 /**
- * @brief       Set timing registers for an I2C instance to fast-plus mode (500 kHz).
+ * @brief       Starts an interrupt-driven write of a list of buffers and returns immediately.
+ * @note        See I2C_write_segments. The segment array and the buffers must stay valid until cb
+ *              is called.
  * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   segs: segments to send, in order
+ * @param[in]   count: number of segments
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
  */
-static void I2C_set_fast_plus_timing(I2C_TypeDef *I2Cx)
+I2C_Status I2C_write_segments_async(I2C_TypeDef *I2Cx, uint16_t target_addr, const i2c_segment_t *segs,
+                                    uint32_t count, i2c_callback_t cb, void *ctx)
 {
-    /*
-     * I2Cx uses 8 MHz HSI clock by default; can use SYSCLOCK by setting bit 4 on RCC->CFGR3.
-     * See table 149 in reference manual, page 862, for timing calculations using 8 MHz I2CCLK
-     *
-     * Note - PRESC[3:0] and SDADEL[3:0] are both 0x0 in fast-plus mode.
-     */
+    i2c_source_t src = {NULL, 0, segs, count, NULL, NULL};
 
-    I2Cx->TIMINGR |= (1U << 20); // SCLDEL[3:0] (bits 23:20) = 0x1 = 0001
+    return I2C_start(I2C_bus(I2Cx), target_addr, &src, I2C_segments_len(segs, count), NULL, 0, 0, cb, ctx);
+}
 
-    I2Cx->TIMINGR |= (1U << 8); // SCLH[7:0] (bits 15:8) = 0x3 = 0000 0011
-    I2Cx->TIMINGR |= (1U << 9);
+/**
+ * @brief       Starts an interrupt-driven write of bytes pulled from a producer, and returns
+ *              immediately.
+ * @note        See I2C_write_stream. The producer is called from the instance's event interrupt.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   len: total number of bytes to send
+ * @param[in]   producer: supplies the bytes
+ * @param[in]   producer_ctx: passed to producer
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
+ */
+I2C_Status I2C_write_stream_async(I2C_TypeDef *I2Cx, uint16_t target_addr, uint32_t len, i2c_producer_t producer,
+                                  void *producer_ctx, i2c_callback_t cb, void *ctx)
+{
+    i2c_source_t src = {NULL, 0, NULL, 0, producer, producer_ctx};
 
-    I2Cx->TIMINGR |= (1U << 1); // SCLL[7:0] (bits 7:0) = 0x6 = 0000 0110
-    I2Cx->TIMINGR |= (1U << 2);
+    return I2C_start(I2C_bus(I2Cx), target_addr, &src, len, NULL, 0, 0, cb, ctx);
 }
 
 /**
- * @brief       Set timing registers for an I2C instance to standard mode (100 kHz).
+ * @brief       Starts an interrupt-driven read and returns immediately.
  * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[out]  data: where to put the received bytes
+ * @param[in]   len: number of bytes to read (at least 1)
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
  */
-static void I2C_set_standard_timing(I2C_TypeDef *I2Cx)
+I2C_Status I2C_read_async(I2C_TypeDef *I2Cx, uint16_t target_addr, uint8_t *data, uint32_t len, i2c_callback_t cb,
+                          void *ctx)
 {
-    /*
-     * I2C1 uses 8 MHz HSI clock by default; can use SYSCLOCK by setting bit 4 on RCC->CFGR3.
-     * See table 149 in reference manual, page 862, for timing calculations using 8 MHz I2CCLK
-     */
-    I2Cx->TIMINGR |= (1U << 28); // PRESC[3:0] (bits 31:28) = 0x1 = 0001
+    return I2C_start(I2C_bus(I2Cx), target_addr, NULL, 0, data, len, 0, cb, ctx);
+}
 
-    I2Cx->TIMINGR |= (1U << 17); // SDADEL[3:0] (bits 19:16) = 0x2 = 0010
+/**
+ * @brief       Starts an interrupt-driven write, repeated START and read, and returns immediately.
+ * @note        See I2C_write_read. When the write phase ends with TC set, the interrupt issues the
+ *              repeated START into the read phase.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   tx: bytes to send
+ * @param[in]   tx_len: number of bytes to send
+ * @param[out]  rx: where to put the received bytes
+ * @param[in]   rx_len: number of bytes to read (at least 1)
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
+ */
+I2C_Status I2C_write_read_async(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *tx, uint32_t tx_len,
+                                uint8_t *rx, uint32_t rx_len, i2c_callback_t cb, void *ctx)
+{
+    i2c_source_t src = {tx, tx_len, NULL, 0, NULL, NULL};
 
-    I2Cx->TIMINGR |= (1U << 22); // SCLDEL[3:0] (bits 23:20) = 0x4 = 0100
+    return I2C_start(I2C_bus(I2Cx), target_addr, &src, tx_len, rx, rx_len, 0, cb, ctx);
+}
 
-    I2Cx->TIMINGR |= (1U << 8); // SCLH[7:0] (bits 15:8) = 0xF = 0000 1111
-    I2Cx->TIMINGR |= (1U << 9);
-    I2Cx->TIMINGR |= (1U << 10);
-    I2Cx->TIMINGR |= (1U << 11);
+/**
+ * @brief       Starts a write whose bytes are fed to TXDR by DMA, and returns immediately.
+ * @note        The CPU only takes an interrupt every 255 bytes (to reload NBYTES) and one at the
+ *              end, so a 1 KB framebuffer costs five interrupts instead of 1024. I2C1 uses DMA1
+ *              channel 6 and I2C2 DMA1 channel 4; the DMA1 clock must already be enabled
+ *              (rcc_enable_dma1). I2C3 has no channel and falls back to I2C_write_async.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   target_addr: the target device's 7 or 10-bit device address
+ * @param[in]   data: bytes to send; must stay valid until cb is called
+ * @param[in]   len: number of bytes to send (at most 65535)
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
+ */
+I2C_Status I2C_write_dma(I2C_TypeDef *I2Cx, uint16_t target_addr, const uint8_t *data, uint32_t len,
+                         i2c_callback_t cb, void *ctx)
+{
+    i2c_source_t src = {data, len, NULL, 0, NULL, NULL};
 
-    I2Cx->TIMINGR |= (1U << 0); // SCLL[7:0] (bits 7:0) = 0x13 = 0001 0011
-    I2Cx->TIMINGR |= (1U << 1);
-    I2Cx->TIMINGR |= (1U << 4);
+    return I2C_start(I2C_bus(I2Cx), target_addr, &src, len, NULL, 0, 1, cb, ctx);
 }
 
 /**
- * @brief       Writes a number of bytes to the target device.
+ * @brief       Starts a read whose bytes are stored from RXDR by DMA, and returns immediately.
+ * @note        I2C1 uses DMA1 channel 7 and I2C2 DMA1 channel 5; the DMA1 clock must already be
+ *              enabled (rcc_enable_dma1). I2C3 has no channel and moves bytes from its interrupt.
  * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
  * @param[in]   target_addr: the target device's 7 or 10-bit device address
- * @param[in]   data: address of data array to send
- * @param[in]   len: length of data array
+ * @param[out]  data: where to put the received bytes
+ * @param[in]   len: number of bytes to read (1 to 65535)
+ * @param[in]   cb: completion callback, or NULL to poll I2C_busy instead
+ * @param[in]   ctx: passed back to cb
+ * @return      I2C_OK if the transfer was started, I2C_BUSY or I2C_INVALID otherwise
  */
-void I2C_write_bytes(I2C_TypeDef *I2Cx, uint16_t target_addr, char *data, uint32_t len)
+I2C_Status I2C_read_dma(I2C_TypeDef *I2Cx, uint16_t target_addr, uint8_t *data, uint32_t len,
+                        i2c_callback_t cb, void *ctx)
 {
-    if (target_addr > 1023)
+    return I2C_start(I2C_bus(I2Cx), target_addr, NULL, 0, data, len, 1, cb, ctx);
+}
+
+/**
+ * @brief       Whether an interrupt-driven transfer is in flight on an instance.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ */
+uint8_t I2C_busy(I2C_TypeDef *I2Cx)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    return bus ? bus->xfer.busy : 0;
+}
+
+/**
+ * @brief       Returns how an instance is wired to the NVIC, DMA1 and EXTI.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @return      the instance's wiring, or NULL for a bad instance
+ */
+const i2c_wiring_t *I2C_get_wiring(I2C_TypeDef *I2Cx)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    return bus ? &bus->wiring : NULL;
+}
+
+/**
+ * @brief       Hands an instance's interrupts to a target mode driver whenever no controller
+ *              transfer is in flight.
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   t: target state, or NULL to take them back
+ * @return      I2C_OK, or I2C_INVALID for a bad instance
+ */
+I2C_Status I2C_set_target(I2C_TypeDef *I2Cx, struct i2c_target *t)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    if (!bus)
     {
-        return; // address is more than 10 bits; invalid
+        return I2C_INVALID;
     }
 
-    I2C_set_CR2_reg_for_write(I2Cx, target_addr);
+    bus->target = t;
 
-    I2C_recursive_transmit(I2Cx, data, len);
+    return I2C_OK;
 }
 
 /**
- * @brief       Recursively sends bytes to a target device until all data has been sent.
- * @note        We use a recursive function because the F303RE NBYTES register is only 8 bits. So,
- *              if we are sending 256 or more bytes, we need to continually reload NBYTES every 255
- *              bytes until we have less than 256 bytes left to send.
+ * @brief       Returns the target mode state an instance's interrupts go to.
  * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
- * @param[in]   data: address of data array to send
- * @param[in]   len: length of remaining data array (or full length of data array on initial
- *              function call)
+ * @return      the state set with I2C_set_target, or NULL
+ */
+struct i2c_target *I2C_get_target(I2C_TypeDef *I2Cx)
+{
+    i2c_bus_t *bus = I2C_bus(I2Cx);
+
+    return bus ? bus->target : NULL;
+}
+
+/**
+ * @brief       Common event interrupt handler. Advances the instance's transfer state machine.
+ * @param[in]   bus: the instance
  */
-static void I2C_recursive_transmit(I2C_TypeDef *I2Cx, char *data, uint32_t len)
+static void I2C_ev_irq(i2c_bus_t *bus)
 {
-    uint8_t n_bytes;
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    i2c_xfer_t *xfer = &bus->xfer;
+    uint32_t isr = I2Cx->ISR;
 
-    if (len < 0x100) // base case - we have less than 256 bytes left to send
+    if (!xfer->busy && bus->target)
     {
-        n_bytes = len;
-        I2Cx->CR2 &= ~(I2C_CR2_RELOAD); // clear reload bit
-        I2Cx->CR2 |= I2C_CR2_AUTOEND;   // set automatic end mode to send STOP signal after n_bytes have been sent
+        i2c_target_irq(bus->target);
+        return;
     }
-    else
+
+    if (isr & I2C_ISR_NACKF)
+    {
+        /* the hardware sends STOP after a NACK; finish up when STOPF arrives */
+        I2Cx->ICR = I2C_ICR_NACKCF;
+        xfer->status = I2C_NACK;
+    }
+    else if ((isr & I2C_ISR_TXIS) && xfer->remaining)
+    {
+        I2Cx->TXDR = I2C_source_next(&xfer->src);
+        xfer->remaining--;
+    }
+    else if ((isr & I2C_ISR_RXNE) && xfer->remaining)
+    {
+        *xfer->rx++ = (uint8_t)I2Cx->RXDR;
+        xfer->remaining--;
+    }
+    else if (isr & I2C_ISR_TCR)
     {
-        n_bytes = 0xFF;
+        I2C_reload(I2Cx, xfer->unscheduled, xfer->end);
+        xfer->unscheduled = (xfer->unscheduled > I2C_NBYTES_MAX) ? xfer->unscheduled - I2C_NBYTES_MAX : 0;
     }
+    else if ((isr & I2C_ISR_TC) && xfer->rx_pending)
+    {
+        /* write phase done with the bus held: repeated START into the read phase */
+        xfer->remaining = xfer->rx_pending;
+        xfer->unscheduled = (xfer->remaining > I2C_NBYTES_MAX) ? xfer->remaining - I2C_NBYTES_MAX : 0;
+        xfer->rx_pending = 0;
+        xfer->end = I2C_CR2_AUTOEND;
 
-    I2Cx->CR2 |= ((uint32_t)n_bytes << 16);
-    I2Cx->CR2 |= I2C_CR2_START;
+        I2Cx->CR1 = (I2Cx->CR1 & ~I2C_CR1_TXIE) | I2C_CR1_RXIE;
+        I2Cx->CR2 = I2C_cr2_read_restart(xfer->addr, xfer->remaining) | I2C_CR2_START;
+    }
+    else if (isr & I2C_ISR_TC)
+    {
+        BITBAND_PERIPH(I2Cx->CR2, I2C_CR2_STOP_Pos) = 1; // only reached without AUTOEND
+    }
 
-    for (int i = 0; i < n_bytes; i++)
+    if ((isr & I2C_ISR_STOPF) && xfer->busy)
     {
-        if (I2Cx->ISR & I2C_ISR_NACKF) // error - we got a NACK from the target
-        {
-            return;
-        }
+        I2Cx->ICR = I2C_ICR_STOPCF;
+        I2C_finish(bus, xfer->status);
+    }
+}
 
-        while (!(I2Cx->ISR & I2C_ISR_TXE)) // TXDR is not empty
-        {
-            ; // wait for previous bits in TXDR to send and clear
-        }
+/**
+ * @brief       Common error interrupt handler. Ends the transfer with the error.
+ * @note        After arbitration loss the other controller owns the bus and no STOPF will come for
+ *              this transfer. After a bus error or an SCL low timeout the bus is recovered before
+ *              the callback runs.
+ * @param[in]   bus: the instance
+ */
+static void I2C_er_irq(i2c_bus_t *bus)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    uint32_t isr = I2Cx->ISR;
+    I2C_Status status;
 
-        I2Cx->TXDR = *data++; // put next byte in the TXDR register
+    if (!bus->xfer.busy && bus->target)
+    {
+        i2c_target_irq(bus->target);
+        return;
     }
 
-    if ((n_bytes < 0xFF) || (len - n_bytes == 0)) // those were the last bytes
+    I2Cx->ICR = I2C_ICR_ARLOCF | I2C_ICR_BERRCF | I2C_ICR_TIMOUTCF | I2C_ICR_OVRCF | I2C_ICR_PECCF;
+
+    if (!bus->xfer.busy)
     {
         return;
     }
 
-    I2C_recursive_transmit(I2Cx, data, len - 0xFF);
+    if (isr & I2C_ISR_ARLO)
+    {
+        status = I2C_ARLO;
+    }
+    else if (isr & I2C_ISR_BERR)
+    {
+        status = I2C_BERR;
+    }
+    else
+    {
+        status = I2C_TIMEOUT;
+    }
+
+    I2Cx->CR1 &= ~(I2C_ASYNC_IRQS | I2C_DMA_ENABLES);
+
+    if (status != I2C_ARLO)
+    {
+        I2C_recover(I2Cx);
+    }
+
+    I2C_finish(bus, status);
+}
+
+/**
+ * @brief       Ends an interrupt-driven transfer, counts it and reports it.
+ * @param[in]   bus: the instance
+ * @param[in]   status: result of the transfer
+ */
+static void I2C_finish(i2c_bus_t *bus, I2C_Status status)
+{
+    I2C_TypeDef *I2Cx = bus->I2Cx;
+    i2c_xfer_t *xfer = &bus->xfer;
+
+    I2Cx->CR1 &= ~(I2C_ASYNC_IRQS | I2C_DMA_ENABLES);
+    I2Cx->ISR = I2C_ISR_TXE; // flush a byte left in TXDR by a NACK
+
+    if (xfer->dma)
+    {
+        dma_channel_stop(xfer->dma); // still holds the unsent bytes after a NACK
+    }
+
+    I2C_count(bus, status, xfer->bytes);
+    xfer->busy = 0;
+
+    if (xfer->cb)
+    {
+        xfer->cb(status, xfer->ctx);
+    }
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+    I2C_ev_irq(&i2c_buses[0]);
+}
+
+void I2C2_EV_IRQHandler(void)
+{
+    I2C_ev_irq(&i2c_buses[1]);
+}
+
+void I2C3_EV_IRQHandler(void)
+{
+    I2C_ev_irq(&i2c_buses[2]);
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+    I2C_er_irq(&i2c_buses[0]);
+}
+
+void I2C2_ER_IRQHandler(void)
+{
+    I2C_er_irq(&i2c_buses[1]);
+}
+
+void I2C3_ER_IRQHandler(void)
+{
+    I2C_er_irq(&i2c_buses[2]);
 }
@@ -0,0 +1,320 @@
+/**
+ ******************************************************************************
+ * @file    i2c_queue.c
+ * @author  Loren Snow
+ * @brief   I2C transaction queue source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_queue.h"
+#include "dwt.h"
+#include <stddef.h>
+
+static i2c_txn_t *i2c_queue_dispatch(i2c_queue_t *q);
+static void i2c_queue_report(i2c_txn_t *failed);
+static void i2c_queue_done(I2C_Status status, void *ctx);
+
+/**
+ * @brief       Prepares an empty queue for an I2C instance.
+ * @note        The instance must already be initialized with I2C_init. Once transactions go
+ *              through a queue, don't start transfers on the same instance directly.
+ * @param[in]   q: queue to initialize
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ */
+void i2c_queue_init(i2c_queue_t *q, I2C_TypeDef *I2Cx)
+{
+    q->I2Cx = I2Cx;
+    q->active = NULL;
+
+    for (uint8_t p = 0; p < I2C_PRIORITY_COUNT; p++)
+    {
+        q->head[p] = NULL;
+        q->tail[p] = NULL;
+    }
+}
+
+/**
+ * @brief       Adds a transaction to the queue, starting it at once if the bus is idle.
+ * @note        Safe to call from interrupt context, including from a transaction's callback.
+ * @param[in]   q: queue
+ * @param[in]   txn: transaction; must not be modified until its callback runs
+ * @return      I2C_OK, or I2C_INVALID for a transaction with an unknown priority
+ */
+I2C_Status i2c_queue_submit(i2c_queue_t *q, i2c_txn_t *txn)
+{
+    i2c_txn_t *failed = NULL;
+    uint32_t primask;
+
+    if (txn->priority >= I2C_PRIORITY_COUNT)
+    {
+        return I2C_INVALID;
+    }
+
+    txn->next = NULL;
+    txn->submitted_at = dwt_cycles();
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (q->tail[txn->priority])
+    {
+        q->tail[txn->priority]->next = txn;
+    }
+    else
+    {
+        q->head[txn->priority] = txn;
+    }
+    q->tail[txn->priority] = txn;
+
+    if (!q->active)
+    {
+        failed = i2c_queue_dispatch(q);
+    }
+
+    __set_PRIMASK(primask);
+
+    i2c_queue_report(failed);
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Starts the next waiting transaction if the bus has become free.
+ * @note        A transaction that finds the bus busy (another controller, or the instance serving
+ *              a host in target mode) stays at the head of the queue. It is retried by the next
+ *              submit or completion, or by this call; call it from the main loop or a timer while
+ *              the queue isn't idle.
+ * @param[in]   q: queue
+ */
+void i2c_queue_poll(i2c_queue_t *q)
+{
+    i2c_txn_t *failed = NULL;
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (!q->active)
+    {
+        failed = i2c_queue_dispatch(q);
+    }
+
+    __set_PRIMASK(primask);
+
+    i2c_queue_report(failed);
+}
+
+/**
+ * @brief       Whether the queue has no transaction on the bus or waiting.
+ * @param[in]   q: queue
+ */
+uint8_t i2c_queue_idle(const i2c_queue_t *q)
+{
+    if (q->active)
+    {
+        return 0;
+    }
+
+    for (uint8_t p = 0; p < I2C_PRIORITY_COUNT; p++)
+    {
+        if (q->head[p])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief       Counts a finished transaction against its device.
+ * @param[in]   txn: finished transaction
+ * @param[in]   status: how it finished
+ */
+static void i2c_queue_account(i2c_txn_t *txn, I2C_Status status)
+{
+    i2c_device_stats_t *stats = txn->stats;
+    uint32_t now = dwt_cycles();
+    uint32_t latency = now - txn->submitted_at;
+
+    if (!stats)
+    {
+        return;
+    }
+
+    stats->transactions++;
+    stats->wait_cycles += latency;
+    stats->busy_cycles += now - txn->started_at;
+
+    if (latency > stats->max_latency)
+    {
+        stats->max_latency = latency;
+    }
+
+    if (status == I2C_OK)
+    {
+        stats->bytes += txn->tx_len + txn->rx_len;
+    }
+    else
+    {
+        stats->errors++;
+    }
+}
+
+/**
+ * @brief       Starts a transaction on the bus.
+ * @param[in]   q: queue
+ * @param[in]   txn: transaction
+ * @return      I2C_OK if it started, otherwise why not
+ */
+static I2C_Status i2c_queue_start(i2c_queue_t *q, i2c_txn_t *txn)
+{
+    if (txn->tx && txn->rx)
+    {
+        return I2C_write_read_async(q->I2Cx, txn->addr, txn->tx, txn->tx_len, txn->rx, txn->rx_len,
+                                    i2c_queue_done, q);
+    }
+    if (txn->rx)
+    {
+        return txn->use_dma ? I2C_read_dma(q->I2Cx, txn->addr, txn->rx, txn->rx_len, i2c_queue_done, q)
+                            : I2C_read_async(q->I2Cx, txn->addr, txn->rx, txn->rx_len, i2c_queue_done, q);
+    }
+
+    return txn->use_dma ? I2C_write_dma(q->I2Cx, txn->addr, txn->tx, txn->tx_len, i2c_queue_done, q)
+                        : I2C_write_async(q->I2Cx, txn->addr, txn->tx, txn->tx_len, i2c_queue_done, q);
+}
+
+/**
+ * @brief       Starts the highest-priority waiting transaction, if any.
+ * @note        Called with interrupts masked or from the instance's interrupt. If the bus is busy
+ *              the transaction stays at the head of its queue for a later retry. A transaction
+ *              that can't be started for any other reason is taken off the queue and the next one
+ *              is tried; the failed ones are returned so their callbacks can run once interrupts
+ *              are unmasked (i2c_queue_report).
+ * @param[in]   q: queue with no active transaction
+ * @return      list of transactions that failed to start, linked through next, or NULL
+ */
+static i2c_txn_t *i2c_queue_dispatch(i2c_queue_t *q)
+{
+    i2c_txn_t *failed = NULL;
+    i2c_txn_t **last = &failed;
+    uint8_t p = 0;
+
+    while (p < I2C_PRIORITY_COUNT)
+    {
+        i2c_txn_t *txn = q->head[p];
+        I2C_Status status;
+
+        if (!txn)
+        {
+            p++;
+            continue;
+        }
+
+        q->active = txn;
+        txn->started_at = dwt_cycles();
+        status = i2c_queue_start(q, txn);
+
+        if (status == I2C_BUSY)
+        {
+            q->active = NULL;
+            break; // the bus is taken; retried by i2c_queue_poll or the next submit
+        }
+
+        q->head[p] = txn->next;
+        if (!q->head[p])
+        {
+            q->tail[p] = NULL;
+        }
+
+        if (status == I2C_OK)
+        {
+            break;
+        }
+
+        q->active = NULL;
+        i2c_queue_account(txn, status);
+        txn->status = status;
+        txn->next = NULL;
+        *last = txn;
+        last = &txn->next;
+    }
+
+    return failed;
+}
+
+/**
+ * @brief       Calls the callbacks of transactions that failed to start.
+ * @note        Called with the caller's PRIMASK restored. A callback may submit again, including
+ *              the same transaction.
+ * @param[in]   failed: list from i2c_queue_dispatch
+ */
+static void i2c_queue_report(i2c_txn_t *failed)
+{
+    while (failed)
+    {
+        i2c_txn_t *txn = failed;
+
+        failed = txn->next;
+
+        if (txn->cb)
+        {
+            txn->cb(txn->status, txn->ctx);
+        }
+    }
+}
+
+/**
+ * @brief       Completion callback for every queued transfer. Starts the next transaction before
+ *              reporting this one, so the bus goes back to work as soon as possible.
+ * @param[in]   status: result of the transfer
+ * @param[in]   ctx: the queue
+ */
+static void i2c_queue_done(I2C_Status status, void *ctx)
+{
+    i2c_queue_t *q = ctx;
+    i2c_txn_t *txn = q->active;
+    i2c_txn_t *failed;
+    uint32_t primask;
+
+    i2c_queue_account(txn, status);
+
+    primask = __get_PRIMASK();
+    __disable_irq(); // a higher-priority interrupt may be submitting to this queue
+
+    q->active = NULL;
+    failed = i2c_queue_dispatch(q);
+
+    __set_PRIMASK(primask);
+
+    if (txn->cb)
+    {
+        txn->cb(status, txn->ctx);
+    }
+
+    i2c_queue_report(failed);
+}
@@ -0,0 +1,320 @@
+/**
+ ******************************************************************************
+ * @file    i2c_regmap.c
+ * @author  Loren Snow
+ * @brief   Cached I2C device register map source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_regmap.h"
+#include <stddef.h>
+
+/**
+ * @brief       Tests a register's bit in a per-register bitmap.
+ * @param[in]   map: bitmap, I2C_REGMAP_WORDS(size) words
+ * @param[in]   reg: register
+ * @return      1 if the register's bit is set, 0 otherwise
+ */
+static inline uint8_t i2c_regmap_test(const uint32_t *map, uint32_t reg)
+{
+    return (map[reg >> 5] >> (reg & 31U)) & 1U;
+}
+
+/**
+ * @brief       Sets or clears a register's bit in a per-register bitmap.
+ * @param[in]   map: bitmap, I2C_REGMAP_WORDS(size) words
+ * @param[in]   reg: register
+ * @param[in]   set: 1 to set the bit, 0 to clear it
+ */
+static inline void i2c_regmap_mark(uint32_t *map, uint32_t reg, uint8_t set)
+{
+    if (set)
+    {
+        map[reg >> 5] |= 1UL << (reg & 31U);
+    }
+    else
+    {
+        map[reg >> 5] &= ~(1UL << (reg & 31U));
+    }
+}
+
+/**
+ * @brief       Checks whether a register is never cached.
+ * @param[in]   m: register map
+ * @param[in]   reg: register
+ * @return      1 if the register is in the map's volatile set, 0 otherwise
+ */
+static inline uint8_t i2c_regmap_volatile(const i2c_regmap_t *m, uint32_t reg)
+{
+    return m->cfg->volatile_regs && i2c_regmap_test(m->cfg->volatile_regs, reg);
+}
+
+/**
+ * @brief       Writes a run of registers to the device in one auto-increment burst.
+ * @param[in]   m: register map
+ * @param[in]   reg: first register
+ * @param[in]   data: values to write
+ * @param[in]   len: number of registers
+ * @return      I2C_OK, or the bus error
+ */
+static I2C_Status i2c_regmap_burst(i2c_regmap_t *m, uint8_t reg, const uint8_t *data, uint32_t len)
+{
+    const i2c_segment_t segs[2] = {
+        {.data = &reg, .len = 1},
+        {.data = data, .len = len},
+    };
+
+    return I2C_write_segments(m->cfg->I2Cx, m->cfg->addr, segs, 2);
+}
+
+/**
+ * @brief       Prepares a register map with an empty cache.
+ * @param[in]   m: register map to initialize
+ * @param[in]   cfg: device description; must stay valid while the map is in use
+ */
+void i2c_regmap_init(i2c_regmap_t *m, const i2c_regmap_config_t *cfg)
+{
+    m->cfg = cfg;
+    m->cache_only = 0;
+    i2c_regmap_invalidate(m);
+}
+
+/**
+ * @brief       Reads a run of registers, from the cache when it holds all of them.
+ * @note        Any volatile or uncached register in the run makes it one write-read of the whole
+ *              run from the device. Registers with unsynced writes (see i2c_regmap_cache_only) keep
+ *              and return their cached value.
+ * @param[in]   m: register map
+ * @param[in]   reg: first register
+ * @param[out]  data: where to put the values
+ * @param[in]   len: number of registers
+ * @return      I2C_OK, I2C_INVALID for a run past the end of the map, or the bus error
+ */
+I2C_Status i2c_regmap_read(i2c_regmap_t *m, uint8_t reg, uint8_t *data, uint32_t len)
+{
+    const i2c_regmap_config_t *cfg = m->cfg;
+    uint8_t hit = 1;
+    I2C_Status status;
+
+    if (!len || reg + len > cfg->size)
+    {
+        return I2C_INVALID;
+    }
+
+    for (uint32_t r = reg; r < reg + len; r++)
+    {
+        if (i2c_regmap_volatile(m, r) || !i2c_regmap_test(cfg->valid, r))
+        {
+            hit = 0;
+            break;
+        }
+    }
+
+    if (hit)
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            data[i] = cfg->cache[reg + i];
+        }
+        return I2C_OK;
+    }
+
+    status = I2C_write_read(cfg->I2Cx, cfg->addr, &reg, 1, data, len);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint32_t r = reg + i;
+
+        if (i2c_regmap_volatile(m, r))
+        {
+            continue;
+        }
+        if (i2c_regmap_test(cfg->dirty, r))
+        {
+            data[i] = cfg->cache[r];
+            continue;
+        }
+        cfg->cache[r] = data[i];
+        i2c_regmap_mark(cfg->valid, r, 1);
+    }
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Writes a run of registers through the cache, as one burst on the bus.
+ * @note        In cache-only mode a run of cacheable registers just updates the cache and is sent
+ *              by i2c_regmap_sync; a run with a volatile register still goes out at once.
+ * @param[in]   m: register map
+ * @param[in]   reg: first register
+ * @param[in]   data: values to write
+ * @param[in]   len: number of registers
+ * @return      I2C_OK, I2C_INVALID for a run past the end of the map, or the bus error (the cache
+ *              is then left invalid for the run)
+ */
+I2C_Status i2c_regmap_write(i2c_regmap_t *m, uint8_t reg, const uint8_t *data, uint32_t len)
+{
+    const i2c_regmap_config_t *cfg = m->cfg;
+    uint8_t defer = m->cache_only;
+    I2C_Status status = I2C_OK;
+
+    if (!len || reg + len > cfg->size)
+    {
+        return I2C_INVALID;
+    }
+
+    for (uint32_t r = reg; r < reg + len && defer; r++)
+    {
+        defer = !i2c_regmap_volatile(m, r);
+    }
+
+    if (!defer)
+    {
+        status = i2c_regmap_burst(m, reg, data, len);
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint32_t r = reg + i;
+
+        if (i2c_regmap_volatile(m, r))
+        {
+            continue;
+        }
+        cfg->cache[r] = data[i];
+        i2c_regmap_mark(cfg->valid, r, status == I2C_OK);
+        i2c_regmap_mark(cfg->dirty, r, defer);
+    }
+
+    return status;
+}
+
+/**
+ * @brief       Read-modify-writes a register, touching the bus only for what the cache can't do.
+ * @note        With the register cached this costs no read, and no write either when the value
+ *              doesn't change.
+ * @param[in]   m: register map
+ * @param[in]   reg: register
+ * @param[in]   mask: bits to change
+ * @param[in]   value: new value of the masked bits
+ * @return      I2C_OK, I2C_INVALID for a register past the end of the map, or the bus error
+ */
+I2C_Status i2c_regmap_update_bits(i2c_regmap_t *m, uint8_t reg, uint8_t mask, uint8_t value)
+{
+    uint8_t old;
+    uint8_t val;
+    I2C_Status status;
+
+    status = i2c_regmap_read(m, reg, &old, 1);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    val = (old & ~mask) | (value & mask);
+    if (val == old && !i2c_regmap_volatile(m, reg))
+    {
+        return I2C_OK;
+    }
+
+    return i2c_regmap_write(m, reg, &val, 1);
+}
+
+/**
+ * @brief       Starts or ends cache-only mode, in which writes to cacheable registers are held
+ *              as dirty until i2c_regmap_sync.
+ * @note        Useful to build up a configuration change, or while the device is powered down.
+ *              Ending the mode doesn't sync.
+ * @param[in]   m: register map
+ * @param[in]   enable: 1 to start, 0 to end
+ */
+void i2c_regmap_cache_only(i2c_regmap_t *m, uint8_t enable)
+{
+    m->cache_only = enable;
+}
+
+/**
+ * @brief       Sends every dirty register to the device, one burst per contiguous run.
+ * @note        Stops at the first bus error; the run that failed and those after it stay dirty.
+ * @param[in]   m: register map
+ * @return      I2C_OK, or the bus error
+ */
+I2C_Status i2c_regmap_sync(i2c_regmap_t *m)
+{
+    const i2c_regmap_config_t *cfg = m->cfg;
+    uint32_t r = 0;
+
+    while (r < cfg->size)
+    {
+        uint32_t first;
+        I2C_Status status;
+
+        if (!i2c_regmap_test(cfg->dirty, r))
+        {
+            r++;
+            continue;
+        }
+
+        first = r;
+        while (r < cfg->size && i2c_regmap_test(cfg->dirty, r))
+        {
+            r++;
+        }
+
+        status = i2c_regmap_burst(m, (uint8_t)first, &cfg->cache[first], r - first);
+        if (status != I2C_OK)
+        {
+            return status;
+        }
+
+        for (uint32_t d = first; d < r; d++)
+        {
+            i2c_regmap_mark(cfg->dirty, d, 0);
+        }
+    }
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Forgets every cached value and unsynced write, e.g. after the device was reset.
+ * @param[in]   m: register map
+ */
+void i2c_regmap_invalidate(i2c_regmap_t *m)
+{
+    const i2c_regmap_config_t *cfg = m->cfg;
+
+    for (uint32_t w = 0; w < I2C_REGMAP_WORDS(cfg->size); w++)
+    {
+        cfg->valid[w] = 0;
+        cfg->dirty[w] = 0;
+    }
+}
@@ -0,0 +1,446 @@
+/**
+ ******************************************************************************
+ * @file    i2c_target.c
+ * @author  Loren Snow
+ * @brief   I2C target mode source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_target.h"
+#include "dma.h"
+#include "rcc.h"
+#include <stddef.h>
+
+#define I2C_TARGET_IRQS (I2C_CR1_ADDRIE | I2C_CR1_RXIE | I2C_CR1_STOPIE | I2C_CR1_ERRIE)
+#define I2C_TARGET_ERRORS (I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_TIMEOUT | I2C_ISR_OVR)
+#define I2C_TARGET_DMA_CCR (DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PL_1 | DMA_CCR_TCIE)
+
+static void i2c_target_arm(i2c_target_t *t);
+static void i2c_target_dma_wrap(uint32_t events, void *ctx);
+static uint8_t i2c_target_writable(const i2c_target_config_t *cfg, uint8_t reg);
+static void i2c_target_receive(i2c_target_t *t, uint8_t byte);
+static void i2c_target_end_write(i2c_target_t *t);
+static void i2c_target_end_read(i2c_target_t *t);
+static void i2c_target_end(i2c_target_t *t);
+static void i2c_target_fail(i2c_target_t *t, uint32_t isr);
+
+/**
+ * @brief       Puts an I2C instance in target mode, serving a register file to a host.
+ * @note        The host writes a register pointer byte, optionally followed by data for the
+ *              registers from there on; it reads from the pointer on, usually after a write of
+ *              just the pointer and a repeated START. The pointer auto-increments and wraps at the
+ *              end of the file. Reads are fed to TXDR by DMA (I2C1: DMA1 channel 6, I2C2: DMA1
+ *              channel 4; the DMA1 clock must be enabled), which is loaded with the bytes at the
+ *              pointer as soon as it moves, so answering a read only takes enabling the request
+ *              in the address match interrupt. I2C3 feeds TXDR from its interrupt. Don't start
+ *              controller DMA transfers on an instance in target mode; they share the channel.
+ *              With wake_from_stop the kernel clock is switched to HSI (the only one running in
+ *              Stop mode) and the instance can wake the MCU from i2c_target_stop.
+ * @param[in]   t: target state
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   cfg: addresses and register file; must stay valid while in target mode
+ * @return      I2C_OK, or I2C_INVALID for a bad instance, address or register file
+ */
+I2C_Status i2c_target_init(i2c_target_t *t, I2C_TypeDef *I2Cx, const i2c_target_config_t *cfg)
+{
+    const i2c_wiring_t *wiring = I2C_get_wiring(I2Cx);
+    I2C_Status status;
+
+    if (!wiring || (cfg->own_addr > 1023) || (cfg->alt_addr > 127) || (cfg->alt_mask > 7) ||
+        !cfg->regs || !cfg->size || (cfg->size > 256))
+    {
+        return I2C_INVALID;
+    }
+
+    if (cfg->wake_from_stop)
+    {
+        I2C_set_clock(I2Cx, I2C_CLOCK_HSI); // before I2C_init, which times the bus for the kernel clock
+    }
+
+    status = I2C_init(I2Cx, cfg->mode);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    t->I2Cx = I2Cx;
+    t->cfg = cfg;
+    t->dma = wiring->dma_tx;
+    t->addr = cfg->own_addr;
+    t->ptr = 0;
+    t->transmitting = 0;
+    t->ptr_pending = 0;
+    t->rx_count = 0;
+    t->armed = 0;
+    t->loaded = 0;
+    t->errors = 0;
+    t->error = I2C_OK;
+
+    /* OA1EN has to be clear while the address is changed */
+    I2Cx->OAR1 = 0;
+    I2Cx->OAR1 = ((cfg->own_addr > 127) ? (I2C_OAR1_OA1MODE | cfg->own_addr) : ((uint32_t)cfg->own_addr << 1)) |
+                 I2C_OAR1_OA1EN;
+
+    I2Cx->OAR2 = 0;
+    if (cfg->alt_addr)
+    {
+        I2Cx->OAR2 = ((uint32_t)cfg->alt_addr << I2C_OAR2_OA2_Pos) | ((uint32_t)cfg->alt_mask << I2C_OAR2_OA2MSK_Pos) |
+                     I2C_OAR2_OA2EN;
+    }
+
+    if (t->dma)
+    {
+        dma_channel_set_callback(t->dma, i2c_target_dma_wrap, t); // before configuring, to enable its interrupt
+    }
+    i2c_target_arm(t);
+
+    if (cfg->wake_from_stop)
+    {
+        /* the digital filter must be off for wakeup; I2C_init leaves it off */
+        I2Cx->CR1 |= I2C_CR1_WUPEN;
+        EXTI->IMR |= wiring->wake_line; // an internal line, so only the mask needs setting
+    }
+
+    I2C_set_target(I2Cx, t);
+    I2Cx->CR1 |= I2C_TARGET_IRQS;
+    NVIC_EnableIRQ(wiring->ev_irq);
+    NVIC_EnableIRQ(wiring->er_irq);
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Takes an instance out of target mode. It stops answering to its addresses.
+ * @param[in]   t: target state
+ */
+void i2c_target_disable(i2c_target_t *t)
+{
+    if (!t->I2Cx || (I2C_get_target(t->I2Cx) != t))
+    {
+        return;
+    }
+
+    t->I2Cx->CR1 &= ~(I2C_TARGET_IRQS | I2C_CR1_TXIE | I2C_CR1_TXDMAEN | I2C_CR1_WUPEN);
+    EXTI->IMR &= ~I2C_get_wiring(t->I2Cx)->wake_line;
+    t->I2Cx->OAR1 = 0;
+    t->I2Cx->OAR2 = 0;
+
+    if (t->dma)
+    {
+        dma_channel_stop(t->dma);
+        dma_channel_set_callback(t->dma, NULL, NULL);
+    }
+
+    I2C_set_target(t->I2Cx, NULL);
+}
+
+/**
+ * @brief       Sleeps in Stop mode until the host addresses the target (or another wakeup source
+ *              fires), then restores the system clock.
+ * @note        The address match wakes HSI for the I2C, which stretches SCL until ADDR is cleared,
+ *              so the host just sees a slow ACK and no byte is lost. The MCU only stops if the bus
+ *              is idle; otherwise it returns at once. Interrupts are masked around Stop so the
+ *              clocks are back (rcc_enter_stop) before the event interrupt serves the host.
+ *              SysTick and DWT don't count while stopped.
+ * @param[in]   t: target state, initialized with wake_from_stop
+ * @return      I2C_OK after waking, I2C_BUSY if the bus or the target was busy, I2C_INVALID if the
+ *              target wasn't set up to wake from Stop
+ */
+I2C_Status i2c_target_stop(i2c_target_t *t)
+{
+    I2C_TypeDef *I2Cx = t->I2Cx;
+    I2C_Status status = I2C_OK;
+    uint32_t primask;
+
+    if (!t->cfg || !t->cfg->wake_from_stop)
+    {
+        return I2C_INVALID;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((I2Cx->ISR & (I2C_ISR_BUSY | I2C_ISR_ADDR)) || t->transmitting || t->ptr_pending || t->rx_count)
+    {
+        status = I2C_BUSY;
+    }
+    else
+    {
+        rcc_enter_stop();
+    }
+
+    __set_PRIMASK(primask); // the waking interrupt runs here
+
+    return status;
+}
+
+/**
+ * @brief       Handles an instance's event or error interrupt in target mode.
+ * @note        Called by the I2C interrupt handlers when no controller transfer is in flight
+ *              (i2c_target_init registers t with I2C_set_target).
+ * @param[in]   t: target state
+ */
+void i2c_target_irq(i2c_target_t *t)
+{
+    I2C_TypeDef *I2Cx = t->I2Cx;
+    uint32_t isr = I2Cx->ISR;
+
+    /* a byte received just before a repeated START or STOP belongs to the phase that's ending */
+    if (isr & I2C_ISR_RXNE)
+    {
+        i2c_target_receive(t, (uint8_t)I2Cx->RXDR);
+    }
+
+    if ((isr & I2C_ISR_TXIS) && t->transmitting && !t->dma)
+    {
+        I2Cx->TXDR = t->cfg->regs[(t->ptr + t->loaded) % t->cfg->size];
+        t->loaded++;
+    }
+
+    if (isr & I2C_ISR_ADDR)
+    {
+        uint8_t code = (uint8_t)((isr & I2C_ISR_ADDCODE) >> I2C_ISR_ADDCODE_Pos);
+
+        i2c_target_end(t); // a repeated START ends the previous phase
+
+        /* a 10-bit match reports the header's two address bits; only OA1 can be 10-bit */
+        t->addr = ((t->cfg->own_addr > 127) && ((code & 0x7CU) == 0x78U)) ? t->cfg->own_addr : code;
+
+        if (isr & I2C_ISR_DIR) // the host reads
+        {
+            t->transmitting = 1;
+            t->loaded = 0;
+            I2Cx->ISR = I2C_ISR_TXE; // drop whatever is left in TXDR
+            I2Cx->CR1 |= t->dma ? I2C_CR1_TXDMAEN : I2C_CR1_TXIE;
+        }
+        else
+        {
+            t->ptr_pending = 1;
+            t->rx_count = 0;
+        }
+
+        I2Cx->ICR = I2C_ICR_ADDRCF; // releases SCL
+    }
+
+    if (isr & I2C_TARGET_ERRORS)
+    {
+        I2Cx->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF | I2C_ICR_TIMOUTCF |
+                    I2C_ICR_OVRCF;
+        i2c_target_fail(t, isr);
+    }
+    else if (isr & I2C_ISR_STOPF)
+    {
+        I2Cx->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF;
+        i2c_target_end(t);
+    }
+}
+
+/**
+ * @brief       Loads the DMA channel with the registers from the pointer to the end of the file,
+ *              ready for the next host read.
+ * @note        The channel is enabled but idle until TXDMAEN is set on an address match.
+ * @param[in]   t: target state
+ */
+static void i2c_target_arm(i2c_target_t *t)
+{
+    if (!t->dma)
+    {
+        return;
+    }
+
+    t->armed = t->cfg->size - t->ptr;
+    dma_channel_configure(t->dma, &t->I2Cx->TXDR, &t->cfg->regs[t->ptr], t->armed, I2C_TARGET_DMA_CCR);
+    dma_channel_start(t->dma);
+}
+
+/**
+ * @brief       DMA callback: the channel reached the end of the register file, so it wraps to the
+ *              start. TXDR still holds the last byte, which gives a byte time to reload.
+ * @param[in]   events: DMA_EVT_* mask
+ * @param[in]   ctx: target state
+ */
+static void i2c_target_dma_wrap(uint32_t events, void *ctx)
+{
+    i2c_target_t *t = ctx;
+
+    if (!(events & DMA_EVT_FULL) || !t->transmitting)
+    {
+        return;
+    }
+
+    t->loaded += t->armed;
+    t->armed = t->cfg->size;
+    dma_channel_configure(t->dma, &t->I2Cx->TXDR, t->cfg->regs, t->armed, I2C_TARGET_DMA_CCR);
+    dma_channel_start(t->dma);
+}
+
+/**
+ * @brief       Whether the host may write a register.
+ * @param[in]   cfg: target setup
+ * @param[in]   reg: register
+ */
+static uint8_t i2c_target_writable(const i2c_target_config_t *cfg, uint8_t reg)
+{
+    for (uint8_t i = 0; i < cfg->region_count; i++)
+    {
+        if ((reg >= cfg->regions[i].first) && (reg <= cfg->regions[i].last))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Takes a byte of a host write: the pointer first, then data for the registers from
+ *              there on.
+ * @param[in]   t: target state
+ * @param[in]   byte: byte from RXDR
+ */
+static void i2c_target_receive(i2c_target_t *t, uint8_t byte)
+{
+    const i2c_target_config_t *cfg = t->cfg;
+
+    if (t->ptr_pending)
+    {
+        t->ptr = (uint8_t)(byte % cfg->size);
+        t->ptr_pending = 0;
+        i2c_target_arm(t); // most pointer writes are followed by a read from there
+    }
+    else
+    {
+        uint8_t reg = (uint8_t)((t->ptr + t->rx_count) % cfg->size);
+
+        if (i2c_target_writable(cfg, reg))
+        {
+            cfg->regs[reg] = byte;
+        }
+
+        t->rx_count++;
+    }
+}
+
+/**
+ * @brief       Ends a host write: moves the pointer past the data and reports the write.
+ * @param[in]   t: target state
+ */
+static void i2c_target_end_write(i2c_target_t *t)
+{
+    const i2c_target_config_t *cfg = t->cfg;
+    uint8_t first = t->ptr;
+    uint16_t len = t->rx_count;
+
+    t->ptr_pending = 0;
+    t->rx_count = 0;
+
+    if (!len)
+    {
+        return;
+    }
+
+    t->ptr = (uint8_t)((first + len) % cfg->size);
+    i2c_target_arm(t);
+
+    if (cfg->on_write)
+    {
+        cfg->on_write(first, len, t->addr, cfg->ctx);
+    }
+}
+
+/**
+ * @brief       Ends a host read: moves the pointer past the bytes actually sent and reloads the
+ *              DMA channel from there.
+ * @note        The byte left in TXDR when the host NACKs wasn't sent, so it doesn't count.
+ * @param[in]   t: target state
+ */
+static void i2c_target_end_read(i2c_target_t *t)
+{
+    I2C_TypeDef *I2Cx = t->I2Cx;
+    uint32_t sent = t->loaded;
+
+    I2Cx->CR1 &= ~(I2C_CR1_TXDMAEN | I2C_CR1_TXIE);
+
+    if (t->dma)
+    {
+        sent += t->armed - dma_channel_remaining(t->dma);
+        dma_channel_stop(t->dma);
+    }
+    if (sent && !(I2Cx->ISR & I2C_ISR_TXE))
+    {
+        sent--;
+    }
+
+    I2Cx->ISR = I2C_ISR_TXE;
+    t->transmitting = 0;
+    t->ptr = (uint8_t)((t->ptr + sent) % t->cfg->size);
+    i2c_target_arm(t);
+}
+
+/**
+ * @brief       Ends the current phase, whichever direction it went.
+ * @param[in]   t: target state
+ */
+static void i2c_target_end(i2c_target_t *t)
+{
+    if (t->transmitting)
+    {
+        i2c_target_end_read(t);
+    }
+    else
+    {
+        i2c_target_end_write(t);
+    }
+}
+
+/**
+ * @brief       Ends the current phase after an error flag. The hardware has already released the
+ *              bus; the phase is ended as usual (a cut-short write is still reported, since its
+ *              bytes have landed) and the error is recorded in t->errors and t->error.
+ * @note        OVR can only be set with NOSTRETCH, which this driver doesn't use; it counts as a
+ *              bus error.
+ * @param[in]   t: target state
+ * @param[in]   isr: ISR as read by the interrupt
+ */
+static void i2c_target_fail(i2c_target_t *t, uint32_t isr)
+{
+    if (isr & I2C_ISR_ARLO)
+    {
+        t->error = I2C_ARLO;
+    }
+    else if (isr & I2C_ISR_TIMEOUT)
+    {
+        t->error = I2C_TIMEOUT;
+    }
+    else
+    {
+        t->error = I2C_BERR;
+    }
+
+    t->errors++;
+    i2c_target_end(t);
+}
@@ -0,0 +1,230 @@
+/**
+ ******************************************************************************
+ * @file    i2c_timing.c
+ * @author  Loren Snow
+ * @brief   I2C timing (TIMINGR) calculation source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_timing.h"
+
+#define I2C_TIMING_AF_MIN_PS 50000  ///< analog filter delay, minimum
+#define I2C_TIMING_AF_MAX_PS 260000 ///< analog filter delay, maximum
+
+/**
+ * @brief   I2C specification limits for one bus mode, in picoseconds.
+ */
+typedef struct
+{
+    uint32_t max_hz;
+    int32_t low_min;    ///< tLOW(min)
+    int32_t high_min;   ///< tHIGH(min)
+    int32_t su_dat_min; ///< tSU;DAT(min)
+    int32_t vd_dat_max; ///< tVD;DAT(max)
+} i2c_timing_spec_t;
+
+static const i2c_timing_spec_t i2c_timing_specs[] = {
+    {100000, 4700000, 4000000, 250000, 3450000}, /* standard mode */
+    {400000, 1300000, 600000, 100000, 900000},   /* fast mode */
+    {1000000, 500000, 260000, 50000, 450000},    /* fast mode plus */
+};
+
+/**
+ * @brief   Reference manual timings, used in preference to the solver for the clocks they cover.
+ */
+static const struct
+{
+    uint32_t clk_hz;
+    uint32_t bus_hz;
+    uint32_t timingr;
+} i2c_timing_table[] = {
+    {8000000, 100000, I2C_TIMINGR_8MHZ_100KHZ},   {8000000, 400000, I2C_TIMINGR_8MHZ_400KHZ},
+    {8000000, 500000, I2C_TIMINGR_8MHZ_500KHZ},   {16000000, 100000, I2C_TIMINGR_16MHZ_100KHZ},
+    {16000000, 400000, I2C_TIMINGR_16MHZ_400KHZ}, {16000000, 1000000, I2C_TIMINGR_16MHZ_1MHZ},
+    {48000000, 100000, I2C_TIMINGR_48MHZ_100KHZ}, {48000000, 400000, I2C_TIMINGR_48MHZ_400KHZ},
+    {48000000, 1000000, I2C_TIMINGR_48MHZ_1MHZ},
+};
+
+/**
+ * @brief       Divides, rounding up; a negative numerator gives 0.
+ */
+static int32_t i2c_timing_div_ceil(int32_t num, int32_t den)
+{
+    return (num > 0) ? (num + den - 1) / den : 0;
+}
+
+/**
+ * @brief       Computes TIMINGR for a kernel clock and bus frequency.
+ * @note        Follows the reference manual's timing equations with the digital filter off and the
+ *              analog filter on. SCL synchronization (tSYNC1/tSYNC2: the edge time, the analog
+ *              filter delay and two I2CCLK periods) is counted into the low and high times, so the
+ *              bus frequency comes out at or below bus_hz. The smallest workable PRESC is used, for
+ *              the finest resolution. The limits of the mode bus_hz falls in are met: standard up
+ *              to 100 kHz, fast up to 400 kHz and fast mode plus up to 1 MHz. So are the kernel
+ *              clock's own limits, tI2CCLK < (tLOW - tfilters) / 4 and tI2CCLK < tHIGH, taken on the
+ *              programmed SCLL and SCLH times with the analog filter's minimum delay, as the
+ *              reference manual's own tables are.
+ * @param[in]   clk_hz: I2CCLK frequency
+ * @param[in]   bus_hz: wanted SCL frequency (at most 1 MHz)
+ * @param[in]   rise_ns: SCL/SDA rise time
+ * @param[in]   fall_ns: SCL/SDA fall time
+ * @return      TIMINGR value, or 0 if there's no solution (the clock is too slow for the speed, or
+ *              the rise time too long for the mode)
+ */
+uint32_t i2c_timing_solve(uint32_t clk_hz, uint32_t bus_hz, uint32_t rise_ns, uint32_t fall_ns)
+{
+    const i2c_timing_spec_t *spec = i2c_timing_specs;
+    int32_t tclk;
+    int32_t rise = (int32_t)rise_ns * 1000;
+    int32_t fall = (int32_t)fall_ns * 1000;
+    int32_t sync_low;
+    int32_t sync_high;
+    int32_t period;
+
+    if ((clk_hz == 0) || (bus_hz == 0) || (bus_hz > 1000000) || (rise_ns > 1000) || (fall_ns > 1000))
+    {
+        return 0;
+    }
+
+    while (bus_hz > spec->max_hz)
+    {
+        spec++;
+    }
+
+    tclk = (int32_t)(1000000000000ULL / clk_hz);
+    period = (int32_t)(1000000000000ULL / bus_hz);
+    sync_low = fall + I2C_TIMING_AF_MIN_PS + 2 * tclk;  /* tSYNC1 */
+    sync_high = rise + I2C_TIMING_AF_MIN_PS + 2 * tclk; /* tSYNC2 */
+
+    for (int32_t presc = 0; presc < 16; presc++)
+    {
+        int32_t tpresc = (presc + 1) * tclk;
+        int32_t scldel = i2c_timing_div_ceil(rise + spec->su_dat_min, tpresc) - 1;
+        int32_t sdadel = i2c_timing_div_ceil(fall - I2C_TIMING_AF_MIN_PS - 3 * tclk, tpresc);
+        int32_t sdadel_max = (spec->vd_dat_max - rise - I2C_TIMING_AF_MAX_PS - 4 * tclk) / tpresc;
+        int32_t total = i2c_timing_div_ceil(period - sync_low - sync_high, tpresc); // SCLL + 1 + SCLH + 1
+        int32_t low_min = i2c_timing_div_ceil(spec->low_min - sync_low, tpresc);
+        int32_t high_min = i2c_timing_div_ceil(spec->high_min - sync_high, tpresc);
+        int32_t low;
+        int32_t high;
+
+        if (scldel < 0)
+        {
+            scldel = 0;
+        }
+        /* tI2CCLK < (tLOW - tfilters) / 4 and tI2CCLK < tHIGH */
+        if (low_min <= (4 * tclk + I2C_TIMING_AF_MIN_PS) / tpresc)
+        {
+            low_min = (4 * tclk + I2C_TIMING_AF_MIN_PS) / tpresc + 1;
+        }
+        if (high_min <= tclk / tpresc)
+        {
+            high_min = tclk / tpresc + 1;
+        }
+
+        /* the fixed delays of slow kernel clocks can exceed tVD;DAT at fast mode plus on their own;
+           no SDADEL (0) is then the best that can be done */
+        if (sdadel_max < 0)
+        {
+            sdadel_max = 0;
+        }
+
+        if ((sdadel > sdadel_max) || (sdadel > 15) || (scldel > 15) ||
+            (low_min + high_min > total))
+        {
+            continue;
+        }
+
+        /* share the period between low and high in the ratio of their minimums */
+        low = (int32_t)(((int64_t)total * spec->low_min + spec->low_min + spec->high_min - 1) /
+                        (spec->low_min + spec->high_min));
+        if (low < low_min)
+        {
+            low = low_min;
+        }
+        high = total - low;
+        if (high < high_min)
+        {
+            high = high_min;
+            low = total - high;
+        }
+
+        if ((low > 256) || (high > 256))
+        {
+            continue;
+        }
+
+        return I2C_TIMINGR(presc, scldel, sdadel, high - 1, low - 1);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Returns TIMINGR for exactly this kernel clock and bus frequency: the reference
+ *              manual's value if its tables have one, otherwise i2c_timing_solve's.
+ */
+static uint32_t i2c_timing_find(uint32_t clk_hz, uint32_t bus_hz)
+{
+    for (uint32_t i = 0; i < sizeof(i2c_timing_table) / sizeof(i2c_timing_table[0]); i++)
+    {
+        if ((i2c_timing_table[i].clk_hz == clk_hz) && (i2c_timing_table[i].bus_hz == bus_hz))
+        {
+            return i2c_timing_table[i].timingr;
+        }
+    }
+
+    return i2c_timing_solve(clk_hz, bus_hz, I2C_TIMING_RISE_NS, I2C_TIMING_FALL_NS);
+}
+
+/**
+ * @brief       Returns TIMINGR for a kernel clock and bus frequency, from the reference manual's
+ *              tables when they cover it and from i2c_timing_solve otherwise.
+ * @note        The solver uses I2C_TIMING_RISE_NS and I2C_TIMING_FALL_NS. A kernel clock too slow
+ *              for bus_hz gets the fastest rate it can meet within the same mode instead, looked
+ *              for in steps of 1% of bus_hz (8 MHz manages 500 kHz of fast mode plus, for example).
+ * @param[in]   clk_hz: I2CCLK frequency
+ * @param[in]   bus_hz: wanted SCL frequency (at most 1 MHz)
+ * @return      TIMINGR value, or 0 if there's no solution in the mode
+ */
+uint32_t i2c_timing_lookup(uint32_t clk_hz, uint32_t bus_hz)
+{
+    uint32_t floor_hz = (bus_hz > 400000) ? 400000 : ((bus_hz > 100000) ? 100000 : 0);
+    uint32_t step = (bus_hz + 99) / 100;
+
+    for (uint32_t hz = bus_hz; hz > floor_hz; hz = (hz > step) ? hz - step : 0)
+    {
+        uint32_t timingr = i2c_timing_find(clk_hz, hz);
+
+        if (timingr)
+        {
+            return timingr;
+        }
+    }
+
+    return 0;
+}
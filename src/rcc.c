@@ -31,13 +31,14 @@
  */
 
 #include "rcc.h"
+#include "bitband.h"
 
 /**
  * @brief   Enables the GPIO port A clock.
  */
 void rcc_enable_gpioa(void)
 {
-    RCC->AHBENR |= RCC_AHBENR_GPIOAEN;
+    BITBAND_PERIPH(RCC->AHBENR, RCC_AHBENR_GPIOAEN_Pos) = 1;
 }
 
 /**
@@ -45,7 +46,7 @@ void rcc_enable_gpioa(void)
  */
 void rcc_enable_gpiob(void)
 {
-    RCC->AHBENR |= RCC_AHBENR_GPIOBEN;
+    BITBAND_PERIPH(RCC->AHBENR, RCC_AHBENR_GPIOBEN_Pos) = 1;
 }
 
 /**
@@ -53,5 +54,116 @@ void rcc_enable_gpiob(void)
  */
 void rcc_enable_I2C1(void)
 {
-    RCC->APB1ENR |= RCC_APB1ENR_I2C1EN;
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_I2C1EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the DMA1 clock.
+ */
+void rcc_enable_dma1(void)
+{
+    BITBAND_PERIPH(RCC->AHBENR, RCC_AHBENR_DMA1EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the DMA2 clock.
+ */
+void rcc_enable_dma2(void)
+{
+    BITBAND_PERIPH(RCC->AHBENR, RCC_AHBENR_DMA2EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the TIM2 clock.
+ */
+void rcc_enable_tim2(void)
+{
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_TIM2EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the TIM3 clock.
+ */
+void rcc_enable_tim3(void)
+{
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_TIM3EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the TIM4 clock.
+ */
+void rcc_enable_tim4(void)
+{
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_TIM4EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the TIM6 clock.
+ */
+void rcc_enable_tim6(void)
+{
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_TIM6EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the TIM7 clock.
+ */
+void rcc_enable_tim7(void)
+{
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_TIM7EN_Pos) = 1;
+}
+
+/**
+ * @brief   Enables the SYSCFG clock (needed to route pins to EXTI lines).
+ */
+void rcc_enable_syscfg(void)
+{
+    BITBAND_PERIPH(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN_Pos) = 1;
+}
+
+/**
+ * @brief   Puts the MCU in Stop mode until an interrupt or wakeup event, then restores the system
+ *          clock.
+ * @note    Stop mode always exits on HSI with HSE and the PLL off, so they're turned back on and
+ *          reselected if they were in use. The regulator is in low-power mode while stopped.
+ *          SysTick, the DWT counter and every peripheral clock are stopped too; only peripherals
+ *          with a wakeup feature (EXTI lines, I2C with WUPEN, ...) can end it. Call with
+ *          interrupts masked (PRIMASK) to have the clocks back before the waking interrupt's
+ *          handler runs.
+ */
+void rcc_enter_stop(void)
+{
+    uint32_t was_on = RCC->CR & (RCC_CR_HSEON | RCC_CR_PLLON);
+    uint32_t sw = RCC->CFGR & RCC_CFGR_SW;
+
+    BITBAND_PERIPH(RCC->APB1ENR, RCC_APB1ENR_PWREN_Pos) = 1;
+    PWR->CR = (PWR->CR & ~PWR_CR_PDDS) | PWR_CR_LPDS; // Stop rather than Standby
+
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __DSB();
+    __WFI();
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+    if (was_on & RCC_CR_HSEON)
+    {
+        BITBAND_PERIPH(RCC->CR, RCC_CR_HSEON_Pos) = 1;
+        while (!(RCC->CR & RCC_CR_HSERDY))
+        {
+            ;
+        }
+    }
+    if (was_on & RCC_CR_PLLON)
+    {
+        BITBAND_PERIPH(RCC->CR, RCC_CR_PLLON_Pos) = 1;
+        while (!(RCC->CR & RCC_CR_PLLRDY))
+        {
+            ;
+        }
+    }
+
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | sw;
+    while (((RCC->CFGR & RCC_CFGR_SWS) >> RCC_CFGR_SWS_Pos) != sw)
+    {
+        ;
+    }
 }
@@ -0,0 +1,329 @@
+/**
+ ******************************************************************************
+ * @file    ssd1306.c
+ * @author  Loren Snow
+ * @brief   SSD1306 and SH1106 OLED display driver source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "ssd1306.h"
+
+#define SSD1306_CTRL_CMD_STREAM 0x00U ///< control byte: the rest of the transaction is commands
+#define SSD1306_CTRL_CMD        0x80U ///< control byte: one command follows, then another control byte
+#define SSD1306_CTRL_DATA       0x40U ///< control byte: the rest of the transaction is display data
+
+#define SH1106_COLUMN_OFFSET 2U       ///< first RAM column shown on a 128-column panel
+
+/* shared setup: display off, clock, mux, offset, start line, segment remap, COM scan direction,
+   COM pins, precharge, VCOMH, resume from RAM, normal (not inverted) */
+static const uint8_t ssd1306_init_common[] = {
+    SSD1306_CTRL_CMD_STREAM,
+    0xAE,
+    0xD5, 0x80,
+    0xA8, SSD1306_HEIGHT - 1U,
+    0xD3, 0x00,
+    0x40,
+    0xA1,
+    0xC8,
+    0xDA, 0x12,
+    0xD9, 0xF1,
+    0xDB, 0x40,
+    0xA4,
+    0xA6,
+};
+
+static const uint8_t ssd1306_init_pump[] = {SSD1306_CTRL_CMD_STREAM, 0x8D, 0x14}; ///< charge pump on
+static const uint8_t sh1106_init_pump[] = {SSD1306_CTRL_CMD_STREAM, 0xAD, 0x8B};  ///< DC-DC on
+
+static void ssd1306_mark(ssd1306_t *d, uint8_t page, uint8_t first, uint8_t last);
+
+/**
+ * @brief       Sets up the controller and clears the panel.
+ * @note        The I2C instance must already be initialized with I2C_init. The display is left
+ *              on; everything else starts at the controller's defaults, including page addressing.
+ * @param[in]   d: display state to initialize
+ * @param[in]   I2Cx: a defined I2C pointer (i.e., I2C1, I2C2, or I2C3)
+ * @param[in]   addr: the display's 7-bit address
+ * @param[in]   controller: SSD1306_CONTROLLER_SSD1306 or SSD1306_CONTROLLER_SH1106
+ * @return      I2C_OK, or the bus error
+ */
+I2C_Status ssd1306_init(ssd1306_t *d, I2C_TypeDef *I2Cx, uint16_t addr, SSD1306_Controller controller)
+{
+    const uint8_t *pump = (controller == SSD1306_CONTROLLER_SH1106) ? sh1106_init_pump : ssd1306_init_pump;
+    I2C_Status status;
+
+    d->I2Cx = I2Cx;
+    d->addr = addr;
+    d->controller = controller;
+
+    status = I2C_write_bytes(I2Cx, addr, ssd1306_init_common, sizeof(ssd1306_init_common));
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    status = I2C_write_bytes(I2Cx, addr, pump, sizeof(ssd1306_init_pump));
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    for (uint32_t i = 0; i < sizeof(d->fb); i++)
+    {
+        d->fb[i] = 0;
+    }
+    ssd1306_invalidate(d);
+
+    status = ssd1306_flush(d);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    return ssd1306_display_on(d, 1);
+}
+
+/**
+ * @brief       Turns the panel on or off (sleep). The display RAM is kept either way.
+ * @param[in]   d: display
+ * @param[in]   on: 1 for on, 0 for off
+ * @return      I2C_OK, or the bus error
+ */
+I2C_Status ssd1306_display_on(ssd1306_t *d, uint8_t on)
+{
+    const uint8_t cmd[] = {SSD1306_CTRL_CMD_STREAM, on ? 0xAF : 0xAE};
+
+    return I2C_write_bytes(d->I2Cx, d->addr, cmd, sizeof(cmd));
+}
+
+/**
+ * @brief       Sets the panel's contrast (segment drive current).
+ * @param[in]   d: display
+ * @param[in]   contrast: 0 to 255
+ * @return      I2C_OK, or the bus error
+ */
+I2C_Status ssd1306_set_contrast(ssd1306_t *d, uint8_t contrast)
+{
+    const uint8_t cmd[] = {SSD1306_CTRL_CMD_STREAM, 0x81, contrast};
+
+    return I2C_write_bytes(d->I2Cx, d->addr, cmd, sizeof(cmd));
+}
+
+/**
+ * @brief       Blanks the framebuffer. Only the columns that were lit are sent on the next flush.
+ * @param[in]   d: display
+ */
+void ssd1306_clear(ssd1306_t *d)
+{
+    ssd1306_fill_rect(d, 0, 0, SSD1306_WIDTH, SSD1306_HEIGHT, 0);
+}
+
+/**
+ * @brief       Lights or blanks one pixel in the framebuffer. Pixels off the panel are ignored.
+ * @param[in]   d: display
+ * @param[in]   x: column, 0 on the left
+ * @param[in]   y: row, 0 at the top
+ * @param[in]   on: 1 to light, 0 to blank
+ */
+void ssd1306_set_pixel(ssd1306_t *d, uint8_t x, uint8_t y, uint8_t on)
+{
+    uint8_t *col;
+    uint8_t val;
+
+    if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT)
+    {
+        return;
+    }
+
+    col = &d->fb[(y >> 3) * SSD1306_WIDTH + x];
+    val = on ? (*col | (1U << (y & 7U))) : (*col & ~(1U << (y & 7U)));
+
+    if (val != *col)
+    {
+        *col = val;
+        ssd1306_mark(d, y >> 3, x, x);
+    }
+}
+
+/**
+ * @brief       Lights or blanks a rectangle in the framebuffer, clipped to the panel.
+ * @param[in]   d: display
+ * @param[in]   x: left column
+ * @param[in]   y: top row
+ * @param[in]   w: width in columns
+ * @param[in]   h: height in rows
+ * @param[in]   on: 1 to light, 0 to blank
+ */
+void ssd1306_fill_rect(ssd1306_t *d, uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t on)
+{
+    uint32_t x_end = (uint32_t)x + w;
+    uint32_t y_end = (uint32_t)y + h;
+
+    if (x_end > SSD1306_WIDTH)
+    {
+        x_end = SSD1306_WIDTH;
+    }
+    if (y_end > SSD1306_HEIGHT)
+    {
+        y_end = SSD1306_HEIGHT;
+    }
+
+    for (uint32_t row = y; row < y_end;)
+    {
+        uint32_t page = row >> 3;
+        uint32_t stop = (y_end < (page + 1U) * 8U) ? y_end : (page + 1U) * 8U;
+        uint8_t mask = (uint8_t)((0xFFU << (row & 7U)) & (0xFFU >> (8U - (stop - page * 8U))));
+
+        for (uint32_t c = x; c < x_end; c++)
+        {
+            uint8_t *col = &d->fb[page * SSD1306_WIDTH + c];
+            uint8_t val = on ? (*col | mask) : (*col & ~mask);
+
+            if (val != *col)
+            {
+                *col = val;
+                ssd1306_mark(d, page, c, c);
+            }
+        }
+
+        row = stop;
+    }
+}
+
+/**
+ * @brief       Copies page-aligned column bytes (e.g. font glyphs) into the framebuffer, clipped
+ *              to the panel.
+ * @param[in]   d: display
+ * @param[in]   x: first column
+ * @param[in]   page: page (8-row band), 0 at the top
+ * @param[in]   cols: one byte per column, least significant bit on top
+ * @param[in]   len: number of columns
+ */
+void ssd1306_write_columns(ssd1306_t *d, uint8_t x, uint8_t page, const uint8_t *cols, uint8_t len)
+{
+    if (page >= SSD1306_PAGES)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < len && x + i < SSD1306_WIDTH; i++)
+    {
+        uint8_t *col = &d->fb[page * SSD1306_WIDTH + x + i];
+
+        if (*col != cols[i])
+        {
+            *col = cols[i];
+            ssd1306_mark(d, page, x + i, x + i);
+        }
+    }
+}
+
+/**
+ * @brief       Marks the whole framebuffer changed, so the next flush redraws the panel.
+ * @param[in]   d: display
+ */
+void ssd1306_invalidate(ssd1306_t *d)
+{
+    for (uint8_t p = 0; p < SSD1306_PAGES; p++)
+    {
+        d->dirty_first[p] = 0;
+        d->dirty_last[p] = SSD1306_WIDTH - 1U;
+    }
+}
+
+/**
+ * @brief       Sends the changed part of each page to the panel, one transaction per page.
+ * @note        Each transaction sets the page and start column (each command behind its own
+ *              control byte) and then streams the changed columns, so only the bounding range of
+ *              the page's changes crosses the bus. Page addressing works the same on both
+ *              controllers. On a bus error the pages not yet sent stay dirty.
+ * @param[in]   d: display
+ * @return      I2C_OK, or the bus error
+ */
+I2C_Status ssd1306_flush(ssd1306_t *d)
+{
+    uint8_t offset = (d->controller == SSD1306_CONTROLLER_SH1106) ? SH1106_COLUMN_OFFSET : 0U;
+
+    for (uint8_t p = 0; p < SSD1306_PAGES; p++)
+    {
+        uint8_t first = d->dirty_first[p];
+        uint8_t last = d->dirty_last[p];
+        uint8_t col;
+        I2C_Status status;
+
+        if (last < first)
+        {
+            continue;
+        }
+
+        col = first + offset;
+
+        const uint8_t hdr[] = {
+            SSD1306_CTRL_CMD, 0xB0U | p,                   // page
+            SSD1306_CTRL_CMD, 0x00U | (col & 0x0FU),       // column, low nibble
+            SSD1306_CTRL_CMD, 0x10U | (col >> 4),          // column, high nibble
+            SSD1306_CTRL_DATA,
+        };
+        const i2c_segment_t segs[2] = {
+            {.data = hdr, .len = sizeof(hdr)},
+            {.data = &d->fb[p * SSD1306_WIDTH + first], .len = (uint32_t)(last - first) + 1U},
+        };
+
+        status = I2C_write_segments(d->I2Cx, d->addr, segs, 2);
+        if (status != I2C_OK)
+        {
+            return status;
+        }
+
+        d->dirty_first[p] = SSD1306_WIDTH - 1U;
+        d->dirty_last[p] = 0;
+    }
+
+    return I2C_OK;
+}
+
+/**
+ * @brief       Widens a page's dirty range to cover some columns.
+ */
+static void ssd1306_mark(ssd1306_t *d, uint8_t page, uint8_t first, uint8_t last)
+{
+    if (d->dirty_last[page] < d->dirty_first[page])
+    {
+        d->dirty_first[page] = first;
+        d->dirty_last[page] = last;
+        return;
+    }
+
+    if (first < d->dirty_first[page])
+    {
+        d->dirty_first[page] = first;
+    }
+    if (last > d->dirty_last[page])
+    {
+        d->dirty_last[page] = last;
+    }
+}
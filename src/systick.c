@@ -32,23 +32,114 @@
 
 #include "systick.h"
 
+static volatile uint64_t systick_ms; ///< milliseconds since systick_init
+
+/**
+ * @brief       Starts the millisecond time base: SysTick runs from the core clock and interrupts
+ *              SYSTICK_HZ times a second.
+ * @note        The reload comes from SystemCoreClock, so call this again after changing the system
+ *              clock. The count carries on from where it was.
+ */
+void systick_init(void)
+{
+    SysTick->CTRL = 0;
+    SysTick->LOAD = (SystemCoreClock / SYSTICK_HZ) - 1U;
+    SysTick->VAL = 0;
+    SysTick->CTRL = CTRL_CLCKSRC | CTRL_TICKINT | CTRL_ENABLE;
+}
+
+/**
+ * @brief       Milliseconds since systick_init.
+ * @note        The 64-bit count is copied with interrupts masked, so it can't tear.
+ * @return      the time, in milliseconds
+ */
+uint64_t systick_millis(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint64_t ms;
+
+    __disable_irq();
+    ms = systick_ms;
+    __set_PRIMASK(primask);
+
+    return ms;
+}
+
+/**
+ * @brief       Microseconds since systick_init, from the millisecond count and the SysTick counter.
+ * @note        If the counter wrapped while the interrupt couldn't run yet (pending, or masked by
+ *              the caller), the pending millisecond is added and the counter read again, so the
+ *              result never goes backwards.
+ * @return      the time, in microseconds
+ */
+uint64_t systick_micros(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t load = SysTick->LOAD + 1U;
+    uint64_t ms;
+    uint32_t val;
+
+    __disable_irq();
+    ms = systick_ms;
+    val = SysTick->VAL;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        ms++;
+        val = SysTick->VAL; // the value read before may belong to the period that just ended
+    }
+    __set_PRIMASK(primask);
+
+    return (ms * 1000U) + ((uint64_t)(load - 1U - val) * 1000U) / load;
+}
+
 /**
- * @brief       Delays by a number of miliseconds, using the system timer
+ * @brief       Delays by a number of miliseconds, sleeping between ticks
+ * @note        Starts the time base if systick_init hasn't been called. Needs the SysTick
+ *              interrupt to run, so don't call it with interrupts masked.
  * @param[in]   delay: miliseconds to delay
  */
 void systick_delay_ms(uint32_t delay)
 {
-    SysTick->LOAD = ONE_MSEC_LOAD - 1;
-    SysTick->VAL = 0;
-    SysTick->CTRL = CTRL_CLCKSRC;
-    SysTick->CTRL |= CTRL_ENABLE;
+    uint64_t start;
 
-    for (int i = 0; i < delay; i++)
+    if (!(SysTick->CTRL & CTRL_ENABLE))
     {
-        while ((SysTick->CTRL & CTRL_COUNTFLAG) == 0)
-        {
-        }
+        systick_init();
     }
 
-    SysTick->CTRL = 0;
-}
\ No newline at end of file
+    start = systick_micros();
+
+    while (systick_micros() - start < (uint64_t)delay * 1000U)
+    {
+        __WFI(); // the next tick, or any other interrupt, wakes the core
+    }
+}
+
+/**
+ * @brief       Delays by a number of microseconds, busy-waiting on the time base
+ * @note        Starts the time base if systick_init hasn't been called.
+ * @param[in]   delay: microseconds to delay
+ */
+void systick_delay_us(uint32_t delay)
+{
+    uint64_t start;
+
+    if (!(SysTick->CTRL & CTRL_ENABLE))
+    {
+        systick_init();
+    }
+
+    start = systick_micros();
+
+    while (systick_micros() - start < delay)
+    {
+    }
+}
+
+/**
+ * @brief       Counts the milliseconds.
+ */
+void SysTick_Handler(void)
+{
+    systick_ms++;
+}
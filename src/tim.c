@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * @file    tim.c
+ * @author  Loren Snow
+ * @brief   Timer source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "tim.h"
+#include "bitband.h"
+#include "system_stm32f3xx.h"
+
+/**
+ * @brief       Divides a clock by an APB prescaler field from RCC->CFGR.
+ * @param[in]   clk: AHB clock in Hz
+ * @param[in]   ppre: PPRE1 or PPRE2 field value (0xx = /1, 100 = /2, ... 111 = /16)
+ */
+static uint32_t tim_apb_clock(uint32_t clk, uint32_t ppre)
+{
+    return (ppre & 0x4U) ? (clk >> ((ppre & 0x3U) + 1)) : clk;
+}
+
+/**
+ * @brief       Returns the kernel clock of a timer.
+ * @note        Timers run at their APB clock, doubled when the APB prescaler isn't 1 (see the clock
+ *              tree in the reference manual). Assumes the AHB prescaler is 1 and, for TIM1/8/20, that
+ *              RCC->CFGR3 selects PCLK2 rather than the PLL.
+ * @param[in]   TIMx: a defined timer pointer (e.g., TIM2, TIM3, etc.)
+ * @return      timer clock in Hz
+ */
+uint32_t tim_get_clock(TIM_TypeDef *TIMx)
+{
+    uint32_t ppre;
+
+    if ((uint32_t)TIMx >= APB2PERIPH_BASE)
+    {
+        ppre = (RCC->CFGR & RCC_CFGR_PPRE2_Msk) >> RCC_CFGR_PPRE2_Pos;
+    }
+    else
+    {
+        ppre = (RCC->CFGR & RCC_CFGR_PPRE1_Msk) >> RCC_CFGR_PPRE1_Pos;
+    }
+
+    return (ppre & 0x4U) ? 2 * tim_apb_clock(SystemCoreClock, ppre) : SystemCoreClock;
+}
+
+/**
+ * @brief       Sets a timer to overflow (generate update events) at a given rate.
+ * @note        Picks the smallest prescaler that keeps ARR within 16 bits, for the finest rate
+ *              resolution. The new PSC/ARR are loaded immediately by an update event, so this should
+ *              be called before DMA requests or interrupts on update are enabled.
+ * @param[in]   TIMx: a defined timer pointer (e.g., TIM2, TIM3, etc.)
+ * @param[in]   rate_hz: update events per second
+ * @return      the rate actually set, or 0 if rate_hz is 0 or above the timer clock
+ */
+uint32_t tim_set_update_rate(TIM_TypeDef *TIMx, uint32_t rate_hz)
+{
+    uint32_t clk = tim_get_clock(TIMx);
+    uint32_t ticks;
+    uint32_t psc;
+    uint32_t arr;
+
+    if ((rate_hz == 0) || (rate_hz > clk))
+    {
+        return 0;
+    }
+
+    ticks = clk / rate_hz;
+    psc = (ticks - 1) >> 16;
+    arr = ticks / (psc + 1) - 1;
+
+    BITBAND_PERIPH(TIMx->CR1, TIM_CR1_CEN_Pos) = 0;
+    TIMx->PSC = psc;
+    TIMx->ARR = arr;
+    TIMx->CNT = 0;
+    BITBAND_PERIPH(TIMx->CR1, TIM_CR1_URS_Pos) = 1; // only overflows raise UIF/DMA requests, not UG
+    TIMx->EGR = TIM_EGR_UG;                         // load PSC now rather than at the next overflow
+    TIMx->SR = 0;
+
+    return clk / ((psc + 1) * (arr + 1));
+}
+
+/**
+ * @brief       Returns the DMA channel that serves a timer's update request.
+ * @note        From the DMA request tables in the reference manual, with SYSCFG remaps left at
+ *              their reset values (TIM6/TIM7 updates on DMA2, TIM16/TIM17 on DMA1 channels 3 and 1).
+ * @param[in]   TIMx: a defined timer pointer (e.g., TIM2, TIM3, etc.)
+ * @return      the DMA channel, or NULL if the timer's update can't request DMA
+ */
+DMA_Channel_TypeDef *tim_update_dma_channel(TIM_TypeDef *TIMx)
+{
+    if (TIMx == TIM1)
+    {
+        return DMA1_Channel5;
+    }
+    else if (TIMx == TIM2)
+    {
+        return DMA1_Channel2;
+    }
+    else if (TIMx == TIM3)
+    {
+        return DMA1_Channel3;
+    }
+    else if (TIMx == TIM4)
+    {
+        return DMA1_Channel7;
+    }
+    else if (TIMx == TIM6)
+    {
+        return DMA2_Channel3;
+    }
+    else if (TIMx == TIM7)
+    {
+        return DMA2_Channel4;
+    }
+    else if (TIMx == TIM8)
+    {
+        return DMA2_Channel1;
+    }
+    else if (TIMx == TIM15)
+    {
+        return DMA1_Channel5;
+    }
+    else if (TIMx == TIM16)
+    {
+        return DMA1_Channel3;
+    }
+    else if (TIMx == TIM17)
+    {
+        return DMA1_Channel1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Makes every update event of a timer issue a DMA request.
+ * @param[in]   TIMx: a defined timer pointer (e.g., TIM2, TIM3, etc.)
+ */
+void tim_enable_update_dma(TIM_TypeDef *TIMx)
+{
+    BITBAND_PERIPH(TIMx->DIER, TIM_DIER_UDE_Pos) = 1;
+}
+
+/**
+ * @brief       Starts a timer counting.
+ * @param[in]   TIMx: a defined timer pointer (e.g., TIM2, TIM3, etc.)
+ */
+void tim_start(TIM_TypeDef *TIMx)
+{
+    BITBAND_PERIPH(TIMx->CR1, TIM_CR1_CEN_Pos) = 1;
+}
+
+/**
+ * @brief       Stops a timer and its update DMA requests.
+ * @param[in]   TIMx: a defined timer pointer (e.g., TIM2, TIM3, etc.)
+ */
+void tim_stop(TIM_TypeDef *TIMx)
+{
+    BITBAND_PERIPH(TIMx->CR1, TIM_CR1_CEN_Pos) = 0;
+    BITBAND_PERIPH(TIMx->DIER, TIM_DIER_UDE_Pos) = 0;
+}
@@ -0,0 +1,116 @@
+/**
+ ******************************************************************************
+ * @file    core_cm4.h
+ * @author  Loren Snow
+ * @brief   Host stand-in for the CMSIS compiler intrinsics, ahead of the real core_cm4.h.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+/*
+ * Host builds put tests/host ahead of the CMSIS include directory, so the device header's
+ * #include "core_cm4.h" lands here. The intrinsics in cmsis_gcc.h are Arm assembly; this file
+ * supplies host versions of them, routes PRIMASK and WFI through the simulator (sim.c), marks
+ * cmsis_gcc.h as already included and hands over to the real core_cm4.h for the register layouts.
+ */
+
+#ifndef HOST_CORE_CM4_H
+#define HOST_CORE_CM4_H
+
+#include <stdint.h>
+
+#define __CMSIS_GCC_H
+
+#define __ASM                  __asm
+#define __INLINE               inline
+#define __STATIC_INLINE        static inline
+#define __STATIC_FORCEINLINE   static inline
+#define __NO_RETURN            __attribute__((__noreturn__))
+#define __USED                 __attribute__((used))
+#define __WEAK                 __attribute__((weak))
+#define __PACKED               __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT        struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION         union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)           __attribute__((aligned(x)))
+#define __RESTRICT             __restrict
+#define __COMPILER_BARRIER()   __asm volatile("" ::: "memory")
+
+extern volatile uint32_t sim_primask;
+void sim_set_primask(uint32_t primask);
+void sim_wfi(void);
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return sim_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+    sim_set_primask(primask);
+}
+
+static inline void __disable_irq(void)
+{
+    sim_set_primask(1U);
+}
+
+static inline void __enable_irq(void)
+{
+    sim_set_primask(0U);
+}
+
+static inline void __NOP(void)
+{
+}
+
+static inline void __DSB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __ISB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __DMB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __WFI(void)
+{
+    sim_wfi();
+}
+
+static inline uint8_t __CLZ(uint32_t value)
+{
+    return (uint8_t)(value ? __builtin_clz(value) : 32U);
+}
+
+#include_next "core_cm4.h"
+
+#endif /* HOST_CORE_CM4_H */
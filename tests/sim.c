@@ -0,0 +1,1290 @@
+/**
+ ******************************************************************************
+ * @file    sim.c
+ * @author  Loren Snow
+ * @brief   Simulated peripheral bus for host tests source file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include "sim.h"
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#define SIM_PAGE 0x1000U
+#define SIM_BLOCKS 1024U             ///< 1 KB blocks counted per region
+#define SIM_TRAP_FLAG 0x100U         ///< x86 EFLAGS.TF: trap after the next instruction
+#define SIM_ERR_WRITE 0x2U           ///< page fault error code: the access was a write
+#define SIM_CYCLES_PER_READ 16U      ///< DWT cycles that pass between two reads of CYCCNT
+#define SIM_WATCHDOG_S 20U
+#define SIM_DMA_CHANNELS 12U         ///< DMA1 channels 1-7, then DMA2 channels 1-5
+#define SIM_ALIAS_SIZE 0x2000000U    ///< bit-band alias of the first megabyte of peripherals
+
+#define SIM_I2C_ICR_FLAGS (I2C_ICR_ADDRCF | I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF | \
+                           I2C_ICR_OVRCF | I2C_ICR_PECCF | I2C_ICR_TIMOUTCF | I2C_ICR_ALERTCF)
+#define SIM_I2C_ERR_FLAGS (I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_OVR | I2C_ISR_PECERR | I2C_ISR_TIMEOUT | \
+                           I2C_ISR_ALERT)
+
+#define SIM_REG(addr) (*sim_reg((uintptr_t)(addr)))
+#define SIM_I2C(i, reg) SIM_REG(sim_i2c_bases[i] + offsetof(I2C_TypeDef, reg))
+
+/**
+ * @brief   A simulated address range, mapped twice: at its real address, where watched pages are
+ *          kept inaccessible, and anywhere, where the models reach the registers freely.
+ */
+typedef struct
+{
+    uintptr_t base;
+    size_t size;
+    volatile uint8_t *raw;
+} sim_region_t;
+
+/**
+ * @brief   Peripheral access being single-stepped.
+ */
+typedef struct
+{
+    uintptr_t page;   ///< page opened for the access, 0 if none is in flight
+    uintptr_t reg;    ///< register accessed, in the peripheral region for bit-band accesses
+    uintptr_t alias;  ///< bit-band alias word accessed, or 0
+    uint32_t bit;     ///< bit of reg the alias word maps to
+    uint32_t old;     ///< reg before the access
+    uint8_t write;
+} sim_access_t;
+
+extern void DMA1_Channel1_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel2_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel3_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel4_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel5_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel6_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel7_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Channel1_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Channel2_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Channel3_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Channel4_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Channel5_IRQHandler(void) __attribute__((weak));
+extern void I2C1_EV_IRQHandler(void) __attribute__((weak));
+extern void I2C1_ER_IRQHandler(void) __attribute__((weak));
+extern void I2C2_EV_IRQHandler(void) __attribute__((weak));
+extern void I2C2_ER_IRQHandler(void) __attribute__((weak));
+extern void I2C3_EV_IRQHandler(void) __attribute__((weak));
+extern void I2C3_ER_IRQHandler(void) __attribute__((weak));
+
+static void (*const sim_vectors[])(void) = {
+    [DMA1_Channel1_IRQn] = DMA1_Channel1_IRQHandler,
+    [DMA1_Channel2_IRQn] = DMA1_Channel2_IRQHandler,
+    [DMA1_Channel3_IRQn] = DMA1_Channel3_IRQHandler,
+    [DMA1_Channel4_IRQn] = DMA1_Channel4_IRQHandler,
+    [DMA1_Channel5_IRQn] = DMA1_Channel5_IRQHandler,
+    [DMA1_Channel6_IRQn] = DMA1_Channel6_IRQHandler,
+    [DMA1_Channel7_IRQn] = DMA1_Channel7_IRQHandler,
+    [I2C1_EV_IRQn] = I2C1_EV_IRQHandler,
+    [I2C1_ER_IRQn] = I2C1_ER_IRQHandler,
+    [I2C2_EV_IRQn] = I2C2_EV_IRQHandler,
+    [I2C2_ER_IRQn] = I2C2_ER_IRQHandler,
+    [DMA2_Channel1_IRQn] = DMA2_Channel1_IRQHandler,
+    [DMA2_Channel2_IRQn] = DMA2_Channel2_IRQHandler,
+    [DMA2_Channel3_IRQn] = DMA2_Channel3_IRQHandler,
+    [DMA2_Channel4_IRQn] = DMA2_Channel4_IRQHandler,
+    [DMA2_Channel5_IRQn] = DMA2_Channel5_IRQHandler,
+    [I2C3_EV_IRQn] = I2C3_EV_IRQHandler,
+    [I2C3_ER_IRQn] = I2C3_ER_IRQHandler,
+};
+
+static sim_region_t sim_regions[] = {
+    {PERIPH_BASE, 0x100000U, NULL},     // APB1, APB2, AHB1
+    {AHB2PERIPH_BASE, 0x2000U, NULL},   // GPIOA-H
+    {0xE0000000U, 0x100000U, NULL},     // private peripheral bus: DWT, SysTick, NVIC, SCB
+};
+
+/* pages whose every access goes through a model */
+static const uintptr_t sim_watched[] = {
+    GPIOA_BASE, GPIOA_BASE + SIM_PAGE, I2C1_BASE & ~(SIM_PAGE - 1U), I2C3_BASE & ~(SIM_PAGE - 1U),
+    DMA1_BASE, RCC_BASE, DWT_BASE, SCS_BASE,
+};
+
+static const uintptr_t sim_i2c_bases[3] = {I2C1_BASE, I2C2_BASE, I2C3_BASE};
+static const IRQn_Type sim_i2c_ev_irqs[3] = {I2C1_EV_IRQn, I2C2_EV_IRQn, I2C3_EV_IRQn};
+static const IRQn_Type sim_i2c_er_irqs[3] = {I2C1_ER_IRQn, I2C2_ER_IRQn, I2C3_ER_IRQn};
+
+uint32_t SystemCoreClock = 8000000U;
+volatile uint32_t sim_primask;
+sim_i2c_t sim_i2c[3];
+uint16_t sim_gpio_held_low[8];
+uint32_t sim_irqs;
+sim_log_t sim_log[SIM_LOG_LEN];
+uint32_t sim_log_len;
+
+static uint32_t sim_hits[3][SIM_BLOCKS];
+static uint32_t sim_total;
+static sim_access_t sim_access;
+static uint8_t sim_in_handler;
+static uint16_t sim_dma_len[SIM_DMA_CHANNELS];  ///< CNDTR when each channel was last enabled
+static uint8_t sim_lock_step[8];                ///< progress through each port's LCKR key sequence
+
+/**
+ * @brief       Finds the simulated region holding an address.
+ * @return      the region's index, or -1
+ */
+static int sim_region(uintptr_t addr)
+{
+    for (int r = 0; r < 3; r++)
+    {
+        if (addr - sim_regions[r].base < sim_regions[r].size)
+        {
+            return r;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief       Returns a register's word in the unprotected view of its region.
+ */
+static volatile uint32_t *sim_reg(uintptr_t addr)
+{
+    int r = sim_region(addr);
+
+    if (r < 0)
+    {
+        sim_fail(__FILE__, __LINE__, "register outside the simulated regions");
+    }
+
+    return (volatile uint32_t *)(sim_regions[r].raw + ((addr - sim_regions[r].base) & ~(uintptr_t)3));
+}
+
+/**
+ * @brief       Returns a register's contents without going through its model.
+ * @param[in]   reg: register, e.g. &I2C1->ISR
+ */
+volatile uint32_t *sim_raw(const volatile void *reg)
+{
+    return sim_reg((uintptr_t)reg);
+}
+
+/**
+ * @brief       CPU accesses so far to the 1 KB block holding a peripheral (the usual spacing of
+ *              peripherals on the bus), bit-band accesses included.
+ * @param[in]   periph: peripheral or register, e.g. I2C1
+ */
+uint32_t sim_accesses(const volatile void *periph)
+{
+    uintptr_t addr = (uintptr_t)periph;
+    int r = sim_region(addr);
+
+    return (r < 0) ? 0 : sim_hits[r][(addr - sim_regions[r].base) >> 10];
+}
+
+/**
+ * @brief       CPU accesses so far to every modelled peripheral.
+ */
+uint32_t sim_accesses_total(void)
+{
+    return sim_total;
+}
+
+/**
+ * @brief       Fails the running test.
+ */
+void sim_fail(const char *file, int line, const char *what)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    exit(1);
+}
+
+/**
+ * @brief       Index of an I2C instance, or -1.
+ */
+static int sim_i2c_index(uintptr_t base)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (sim_i2c_bases[i] == base)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief       Returns the model of an I2C instance.
+ */
+sim_i2c_t *sim_i2c_model(const I2C_TypeDef *I2Cx)
+{
+    int i = sim_i2c_index((uintptr_t)I2Cx);
+
+    if (i < 0)
+    {
+        sim_fail(__FILE__, __LINE__, "not an I2C instance");
+    }
+
+    return &sim_i2c[i];
+}
+
+/* ---- I2C ---------------------------------------------------------------------------------- */
+
+/**
+ * @brief       The controller sends STOP and releases the bus.
+ */
+static void sim_i2c_stop(int i)
+{
+    SIM_I2C(i, ISR) = (SIM_I2C(i, ISR) | I2C_ISR_STOPF) & ~(I2C_ISR_BUSY | I2C_ISR_TXIS | I2C_ISR_RXNE |
+                                                             I2C_ISR_TC | I2C_ISR_TCR);
+    sim_i2c[i].active = 0;
+    sim_i2c[i].stops++;
+}
+
+/**
+ * @brief       The controller has moved the NBYTES of the current chunk.
+ */
+static void sim_i2c_chunk_done(int i)
+{
+    uint32_t cr2 = SIM_I2C(i, CR2);
+
+    if (cr2 & I2C_CR2_RELOAD)
+    {
+        SIM_I2C(i, ISR) |= I2C_ISR_TCR;
+    }
+    else if (cr2 & I2C_CR2_AUTOEND)
+    {
+        sim_i2c_stop(i);
+    }
+    else
+    {
+        SIM_I2C(i, ISR) |= I2C_ISR_TC;
+    }
+}
+
+/**
+ * @brief       The controller is ready for the next byte of the chunk, or done with it.
+ */
+static void sim_i2c_next(int i)
+{
+    sim_i2c_t *m = &sim_i2c[i];
+
+    if (!m->left)
+    {
+        sim_i2c_chunk_done(i);
+    }
+    else if (m->reading)
+    {
+        SIM_I2C(i, RXDR) = m->rx_next++;
+        SIM_I2C(i, ISR) |= I2C_ISR_RXNE;
+    }
+    else
+    {
+        SIM_I2C(i, ISR) |= I2C_ISR_TXIS;
+    }
+}
+
+/**
+ * @brief       CR2 written: START, STOP, or a new NBYTES after TCR.
+ */
+static void sim_i2c_cr2(int i, uint32_t val)
+{
+    sim_i2c_t *m = &sim_i2c[i];
+
+    SIM_I2C(i, CR2) = val & ~(I2C_CR2_START | I2C_CR2_STOP); // both clear themselves
+
+    if (val & I2C_CR2_START)
+    {
+        m->starts++;
+        SIM_I2C(i, ISR) = (SIM_I2C(i, ISR) | I2C_ISR_BUSY) & ~(I2C_ISR_TC | I2C_ISR_TCR);
+        if (m->stuck)
+        {
+            return;
+        }
+
+        m->active = 1;
+        m->reading = (val & I2C_CR2_RD_WRN) ? 1 : 0;
+        m->left = (val & I2C_CR2_NBYTES) >> I2C_CR2_NBYTES_Pos;
+
+        if (m->absent)
+        {
+            SIM_I2C(i, ISR) |= I2C_ISR_NACKF;
+            sim_i2c_stop(i);
+        }
+        else
+        {
+            sim_i2c_next(i);
+        }
+    }
+    else if ((val & I2C_CR2_STOP) && m->active)
+    {
+        sim_i2c_stop(i);
+    }
+    else if ((SIM_I2C(i, ISR) & I2C_ISR_TCR) && (val & I2C_CR2_NBYTES) && m->active)
+    {
+        SIM_I2C(i, ISR) &= ~I2C_ISR_TCR;
+        m->left = (val & I2C_CR2_NBYTES) >> I2C_CR2_NBYTES_Pos;
+        sim_i2c_next(i);
+    }
+}
+
+/**
+ * @brief       A byte was written to TXDR, by the CPU or a DMA channel.
+ */
+static void sim_i2c_txdr(int i)
+{
+    sim_i2c_t *m = &sim_i2c[i];
+
+    if (!m->active)
+    {
+        SIM_I2C(i, ISR) &= ~(I2C_ISR_TXIS | I2C_ISR_TXE); // target mode: the byte waits for the host
+        return;
+    }
+    if (m->reading || !m->left)
+    {
+        return;
+    }
+
+    if (m->tx_len < SIM_I2C_LOG)
+    {
+        m->tx[m->tx_len++] = (uint8_t)SIM_I2C(i, TXDR);
+    }
+
+    m->left--;
+    SIM_I2C(i, ISR) &= ~I2C_ISR_TXIS;
+    sim_i2c_next(i);
+}
+
+/**
+ * @brief       RXDR was read, by the CPU or a DMA channel.
+ */
+static void sim_i2c_rxdr(int i)
+{
+    sim_i2c_t *m = &sim_i2c[i];
+
+    if (!m->active)
+    {
+        SIM_I2C(i, ISR) &= ~I2C_ISR_RXNE;
+        return;
+    }
+    if (!m->reading || !m->left)
+    {
+        return;
+    }
+
+    m->left--;
+    SIM_I2C(i, ISR) &= ~I2C_ISR_RXNE;
+    sim_i2c_next(i);
+}
+
+/**
+ * @brief       Puts an I2C instance's registers and model in their reset state.
+ */
+static void sim_i2c_reset(int i)
+{
+    uint8_t absent = sim_i2c[i].absent, stuck = sim_i2c[i].stuck, rx_next = sim_i2c[i].rx_next;
+
+    for (size_t off = 0; off < sizeof(I2C_TypeDef); off += 4)
+    {
+        SIM_REG(sim_i2c_bases[i] + off) = 0;
+    }
+    SIM_I2C(i, ISR) = I2C_ISR_TXE | (stuck ? I2C_ISR_BUSY : 0);
+
+    memset(&sim_i2c[i], 0, sizeof(sim_i2c[i]));
+    sim_i2c[i].absent = absent;
+    sim_i2c[i].stuck = stuck;
+    sim_i2c[i].rx_next = rx_next;
+}
+
+/**
+ * @brief       Applies a CPU write to an I2C register.
+ */
+static void sim_i2c_write(int i, size_t off, uint32_t old, uint32_t val)
+{
+    switch (off)
+    {
+    case offsetof(I2C_TypeDef, CR1):
+        if (!(val & I2C_CR1_PE)) // software reset: the state machines and flags are cleared
+        {
+            SIM_I2C(i, ISR) = I2C_ISR_TXE | (sim_i2c[i].stuck ? I2C_ISR_BUSY : 0);
+            sim_i2c[i].active = 0;
+        }
+        break;
+    case offsetof(I2C_TypeDef, CR2):
+        sim_i2c_cr2(i, val);
+        break;
+    case offsetof(I2C_TypeDef, ISR):
+        SIM_I2C(i, ISR) = old | (val & I2C_ISR_TXE); // only TXE can be set, to flush TXDR
+        break;
+    case offsetof(I2C_TypeDef, ICR):
+        SIM_I2C(i, ISR) &= ~(val & SIM_I2C_ICR_FLAGS);
+        SIM_I2C(i, ICR) = 0;
+        break;
+    case offsetof(I2C_TypeDef, RXDR):
+    case offsetof(I2C_TypeDef, PECR):
+        SIM_REG(sim_i2c_bases[i] + off) = old; // read-only
+        break;
+    case offsetof(I2C_TypeDef, TXDR):
+        sim_i2c_txdr(i);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief       Plays a host addressing the instance in target mode.
+ * @param[in]   I2Cx: instance
+ * @param[in]   addr: 7-bit address the host sends
+ * @param[in]   read: 1 for a host read
+ * @return      1 if the target acknowledged and released SCL, 0 otherwise
+ */
+uint8_t sim_i2c_host_start(I2C_TypeDef *I2Cx, uint8_t addr, uint8_t read)
+{
+    int i = sim_i2c_index((uintptr_t)I2Cx);
+    uint32_t oar1 = SIM_I2C(i, OAR1), oar2 = SIM_I2C(i, OAR2);
+    uint32_t msk = (oar2 & I2C_OAR2_OA2MSK) >> I2C_OAR2_OA2MSK_Pos;
+    uint8_t match = (oar1 & I2C_OAR1_OA1EN) && !(oar1 & I2C_OAR1_OA1MODE) && (((oar1 >> 1) & 0x7FU) == addr);
+
+    if (!match && (oar2 & I2C_OAR2_OA2EN))
+    {
+        match = ((((oar2 >> 1) & 0x7FU) >> msk) == ((uint32_t)addr >> msk));
+    }
+    if (!match || !(SIM_I2C(i, CR1) & I2C_CR1_PE))
+    {
+        return 0;
+    }
+
+    SIM_I2C(i, ISR) = (SIM_I2C(i, ISR) & ~(I2C_ISR_ADDCODE | I2C_ISR_DIR)) | ((uint32_t)addr << I2C_ISR_ADDCODE_Pos) |
+                      (read ? I2C_ISR_DIR : 0) | I2C_ISR_ADDR | I2C_ISR_BUSY;
+    sim_run();
+
+    return !(SIM_I2C(i, ISR) & I2C_ISR_ADDR);
+}
+
+/**
+ * @brief       Plays a host sending a byte to the target.
+ * @return      1 if the target took the byte, 0 if it is still stretching SCL
+ */
+uint8_t sim_i2c_host_write(I2C_TypeDef *I2Cx, uint8_t byte)
+{
+    int i = sim_i2c_index((uintptr_t)I2Cx);
+
+    if (SIM_I2C(i, ISR) & I2C_ISR_RXNE)
+    {
+        return 0;
+    }
+
+    SIM_I2C(i, RXDR) = byte;
+    SIM_I2C(i, ISR) |= I2C_ISR_RXNE;
+    sim_run();
+
+    return !(SIM_I2C(i, ISR) & I2C_ISR_RXNE);
+}
+
+/**
+ * @brief       Plays a host reading a byte from the target.
+ * @return      the byte, or -1 if the target never loaded one
+ */
+int sim_i2c_host_read(I2C_TypeDef *I2Cx)
+{
+    int i = sim_i2c_index((uintptr_t)I2Cx);
+
+    if (SIM_I2C(i, ISR) & I2C_ISR_TXE)
+    {
+        SIM_I2C(i, ISR) |= I2C_ISR_TXIS;
+        sim_run();
+    }
+    if (SIM_I2C(i, ISR) & I2C_ISR_TXE)
+    {
+        return -1;
+    }
+
+    SIM_I2C(i, ISR) |= I2C_ISR_TXE;
+
+    return (int)(SIM_I2C(i, TXDR) & 0xFFU);
+}
+
+/**
+ * @brief       Plays a host ending the transfer with STOP, NACKing the last byte of a read (by
+ *              which time the target has loaded TXDR again).
+ */
+void sim_i2c_host_stop(I2C_TypeDef *I2Cx)
+{
+    int i = sim_i2c_index((uintptr_t)I2Cx);
+
+    if (SIM_I2C(i, ISR) & I2C_ISR_DIR)
+    {
+        if (SIM_I2C(i, ISR) & I2C_ISR_TXE)
+        {
+            SIM_I2C(i, ISR) |= I2C_ISR_TXIS;
+            sim_run();
+        }
+        SIM_I2C(i, ISR) |= I2C_ISR_NACKF;
+    }
+
+    SIM_I2C(i, ISR) = (SIM_I2C(i, ISR) | I2C_ISR_STOPF) & ~(I2C_ISR_BUSY | I2C_ISR_TXIS);
+    sim_run();
+}
+
+/**
+ * @brief       Raises a bus error flag (I2C_ISR_BERR, I2C_ISR_ARLO, I2C_ISR_TIMEOUT, ...) in target
+ *              mode; the hardware releases the bus.
+ */
+void sim_i2c_host_error(I2C_TypeDef *I2Cx, uint32_t isr_flag)
+{
+    int i = sim_i2c_index((uintptr_t)I2Cx);
+
+    SIM_I2C(i, ISR) = (SIM_I2C(i, ISR) | isr_flag) & ~(I2C_ISR_BUSY | I2C_ISR_TXIS);
+    sim_run();
+}
+
+/* ---- GPIO --------------------------------------------------------------------------------- */
+
+/**
+ * @brief       Bits of a configuration register that belong to a set of pins.
+ * @param[in]   pins: pin mask
+ * @param[in]   width: bits per pin in the register
+ * @param[in]   first: pin the register's bit 0 belongs to
+ */
+static uint32_t sim_gpio_field(uint32_t pins, uint32_t width, uint32_t first)
+{
+    uint32_t field = 0;
+
+    for (uint32_t n = 0; (n < 32U / width) && (first + n < 16U); n++)
+    {
+        if (pins & (1U << (first + n)))
+        {
+            field |= ((1U << width) - 1U) << (n * width);
+        }
+    }
+
+    return field;
+}
+
+/**
+ * @brief       Computes IDR: outputs read back what they drive, other pins are pulled high, and
+ *              pins another device pulls low read low.
+ */
+static void sim_gpio_idr(uintptr_t port, int p)
+{
+    uint32_t moder = SIM_REG(port + offsetof(GPIO_TypeDef, MODER));
+    uint32_t odr = SIM_REG(port + offsetof(GPIO_TypeDef, ODR));
+    uint32_t idr = 0;
+
+    for (uint32_t pin = 0; pin < 16U; pin++)
+    {
+        uint32_t output = ((moder >> (2U * pin)) & 3U) == 1U;
+
+        if (!output || (odr & (1U << pin)))
+        {
+            idr |= 1U << pin;
+        }
+    }
+
+    SIM_REG(port + offsetof(GPIO_TypeDef, IDR)) = idr & ~(uint32_t)sim_gpio_held_low[p];
+}
+
+/**
+ * @brief       Applies a CPU write to a GPIO register.
+ * @note        The lock state is the one before the write: a write to LCKR is already in place.
+ */
+static void sim_gpio_write(uintptr_t port, int p, size_t off, uint32_t old, uint32_t val)
+{
+    volatile uint32_t *reg = &SIM_REG(port + off);
+    volatile uint32_t *odr = &SIM_REG(port + offsetof(GPIO_TypeDef, ODR));
+    uint32_t lckr = (off == offsetof(GPIO_TypeDef, LCKR)) ? old : SIM_REG(port + offsetof(GPIO_TypeDef, LCKR));
+    uint32_t locked = (lckr & GPIO_LCKR_LCKK) ? (lckr & 0xFFFFU) : 0;
+    uint32_t keep = 0;
+
+    switch (off)
+    {
+    case offsetof(GPIO_TypeDef, MODER):
+    case offsetof(GPIO_TypeDef, OSPEEDR):
+    case offsetof(GPIO_TypeDef, PUPDR):
+        keep = sim_gpio_field(locked, 2, 0);
+        break;
+    case offsetof(GPIO_TypeDef, OTYPER):
+        keep = sim_gpio_field(locked, 1, 0);
+        break;
+    case offsetof(GPIO_TypeDef, AFR[0]):
+        keep = sim_gpio_field(locked, 4, 0);
+        break;
+    case offsetof(GPIO_TypeDef, AFR[1]):
+        keep = sim_gpio_field(locked, 4, 8);
+        break;
+    case offsetof(GPIO_TypeDef, IDR):
+        keep = 0xFFFFFFFFU; // read-only
+        break;
+    case offsetof(GPIO_TypeDef, BSRR):
+        *odr = (*odr & ~(val >> 16)) | (val & 0xFFFFU);
+        *reg = 0;
+        return;
+    case offsetof(GPIO_TypeDef, BRR):
+        *odr &= ~(val & 0xFFFFU);
+        *reg = 0;
+        return;
+    case offsetof(GPIO_TypeDef, LCKR):
+        /* key sequence: LCKK=1, LCKK=0, LCKK=1, with the same pins each time */
+        if (locked)
+        {
+            *reg = old;
+        }
+        else if (((val & GPIO_LCKR_LCKK) != 0) == (sim_lock_step[p] != 1) &&
+                 (!sim_lock_step[p] || ((val & 0xFFFFU) == (old & 0xFFFFU))))
+        {
+            sim_lock_step[p]++;
+            *reg = (sim_lock_step[p] == 3) ? (val | GPIO_LCKR_LCKK) : (val & 0xFFFFU);
+        }
+        else
+        {
+            sim_lock_step[p] = (val & GPIO_LCKR_LCKK) ? 1 : 0; // a first write starts the sequence over
+            *reg = val & 0xFFFFU;
+        }
+        return;
+    default:
+        return;
+    }
+
+    *reg = (val & ~keep) | (old & keep);
+}
+
+/* ---- DMA ---------------------------------------------------------------------------------- */
+
+/**
+ * @brief       Returns a DMA channel's registers.
+ * @param[in]   ch: 0-6 for DMA1 channels 1-7, 7-11 for DMA2 channels 1-5
+ */
+static uintptr_t sim_dma_channel(uint32_t ch)
+{
+    return (ch < 7U) ? (DMA1_Channel1_BASE + 20U * ch) : (DMA2_Channel1_BASE + 20U * (ch - 7U));
+}
+
+/**
+ * @brief       Returns a channel's number (see sim_dma_channel), or that of the last channel if
+ *              channel isn't one.
+ */
+static uint32_t sim_dma_index(const DMA_Channel_TypeDef *channel)
+{
+    uint32_t ch = 0;
+
+    while ((ch < SIM_DMA_CHANNELS - 1U) && (sim_dma_channel(ch) != (uintptr_t)channel))
+    {
+        ch++;
+    }
+
+    return ch;
+}
+
+/**
+ * @brief       Returns the ISR of a channel's controller and the shift of the channel's flags in it.
+ */
+static volatile uint32_t *sim_dma_isr(uint32_t ch, uint32_t *shift)
+{
+    *shift = 4U * ((ch < 7U) ? ch : ch - 7U);
+
+    return &SIM_REG((ch < 7U) ? DMA1_BASE : DMA2_BASE);
+}
+
+/**
+ * @brief       Applies a CPU write to a DMA register.
+ */
+static void sim_dma_write(uintptr_t addr, uint32_t old, uint32_t val)
+{
+    uintptr_t ctrl = addr & ~(uintptr_t)0x3FFU;
+    size_t off = addr - ctrl;
+
+    if (off == offsetof(DMA_TypeDef, ISR))
+    {
+        SIM_REG(addr) = old; // read-only
+    }
+    else if (off == offsetof(DMA_TypeDef, IFCR))
+    {
+        SIM_REG(ctrl) &= ~val;
+        SIM_REG(addr) = 0;
+    }
+    else if ((off - 8U) % 20U == offsetof(DMA_Channel_TypeDef, CCR))
+    {
+        uint32_t ch = (uint32_t)(off - 8U) / 20U + ((ctrl == DMA2_BASE) ? 7U : 0U);
+
+        if ((val & DMA_CCR_EN) && !(old & DMA_CCR_EN))
+        {
+            sim_dma_len[ch] = (uint16_t)SIM_REG(sim_dma_channel(ch) + offsetof(DMA_Channel_TypeDef, CNDTR));
+        }
+    }
+}
+
+/**
+ * @brief       Counts a transfer on a channel: CNDTR, the half and full flags, circular reload.
+ */
+static void sim_dma_count(uint32_t ch)
+{
+    uintptr_t regs = sim_dma_channel(ch);
+    volatile uint32_t *cndtr = &SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CNDTR));
+    uint32_t shift;
+    volatile uint32_t *isr = sim_dma_isr(ch, &shift);
+
+    (*cndtr)--;
+
+    if (sim_dma_len[ch] - *cndtr == sim_dma_len[ch] / 2U)
+    {
+        *isr |= (DMA_ISR_GIF1 | DMA_ISR_HTIF1) << shift;
+    }
+    if (!*cndtr)
+    {
+        *isr |= (DMA_ISR_GIF1 | DMA_ISR_TCIF1) << shift;
+        if (SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CCR)) & DMA_CCR_CIRC)
+        {
+            *cndtr = sim_dma_len[ch];
+        }
+    }
+}
+
+/**
+ * @brief       Serves one pending peripheral request per enabled channel.
+ * @return      1 if a byte moved
+ */
+static uint8_t sim_dma_step(void)
+{
+    uint8_t moved = 0;
+
+    for (uint32_t ch = 0; ch < SIM_DMA_CHANNELS; ch++)
+    {
+        uintptr_t regs = sim_dma_channel(ch);
+        volatile uint32_t *ccr = &SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CCR));
+        volatile uint32_t *cndtr = &SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CNDTR));
+        uint32_t cpar = SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CPAR));
+        uint32_t done = sim_dma_len[ch] - *cndtr;
+        uint8_t *mem = (uint8_t *)(uintptr_t)(SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CMAR)) +
+                                              ((*ccr & DMA_CCR_MINC) ? done : 0));
+        int i;
+
+        if (!(*ccr & DMA_CCR_EN) || !*cndtr)
+        {
+            continue;
+        }
+
+        for (i = 0; i < 3; i++)
+        {
+            uint32_t cr1 = SIM_I2C(i, CR1), flags = SIM_I2C(i, ISR);
+
+            if ((cpar == sim_i2c_bases[i] + offsetof(I2C_TypeDef, TXDR)) && (*ccr & DMA_CCR_DIR) &&
+                (cr1 & I2C_CR1_TXDMAEN) && (flags & I2C_ISR_TXIS))
+            {
+                SIM_I2C(i, TXDR) = *mem;
+                sim_i2c_txdr(i);
+                break;
+            }
+            if ((cpar == sim_i2c_bases[i] + offsetof(I2C_TypeDef, RXDR)) && !(*ccr & DMA_CCR_DIR) &&
+                (cr1 & I2C_CR1_RXDMAEN) && (flags & I2C_ISR_RXNE))
+            {
+                *mem = (uint8_t)SIM_I2C(i, RXDR);
+                sim_i2c_rxdr(i);
+                break;
+            }
+        }
+        if (i == 3)
+        {
+            continue;
+        }
+
+        moved = 1;
+        sim_dma_count(ch);
+    }
+
+    return moved;
+}
+
+/**
+ * @brief       Serves one request on a channel paced by a peripheral the simulator doesn't model
+ *              (a timer update, say), then lets the hardware run.
+ * @note        Moves one item of the channel's memory size between CPAR and CMAR. A GPIO IDR at
+ *              CPAR is brought up to date first.
+ * @param[in]   channel: DMA channel
+ * @return      1 if an item moved, 0 if channel isn't a channel, is disabled or has nothing left
+ */
+uint8_t sim_dma_request(const DMA_Channel_TypeDef *channel)
+{
+    uint32_t ch = sim_dma_index(channel);
+    uintptr_t regs = sim_dma_channel(ch);
+    uint32_t ccr = SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CCR));
+    uint32_t cndtr = SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CNDTR));
+    uintptr_t cpar = SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CPAR));
+    uint32_t size = 1U << ((ccr & DMA_CCR_MSIZE) >> DMA_CCR_MSIZE_Pos);
+    uintptr_t mem = SIM_REG(regs + offsetof(DMA_Channel_TypeDef, CMAR)) +
+                    ((ccr & DMA_CCR_MINC) ? (sim_dma_len[ch] - cndtr) * size : 0);
+    uint8_t *from, *to;
+
+    if ((regs != (uintptr_t)channel) || !(ccr & DMA_CCR_EN) || !cndtr)
+    {
+        return 0;
+    }
+
+    if (cpar - GPIOA_BASE < 0x2000U)
+    {
+        sim_gpio_idr(cpar & ~(uintptr_t)0x3FFU, (int)((cpar - GPIOA_BASE) >> 10));
+    }
+
+    from = (ccr & DMA_CCR_DIR) ? (uint8_t *)mem : (uint8_t *)sim_raw((const volatile void *)cpar);
+    to = (ccr & DMA_CCR_DIR) ? (uint8_t *)sim_raw((const volatile void *)cpar) : (uint8_t *)mem;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        to[i] = from[i];
+    }
+
+    sim_dma_count(ch);
+    sim_run();
+
+    return 1;
+}
+
+/* ---- interrupts --------------------------------------------------------------------------- */
+
+/**
+ * @brief       Sets the pending bit of every interrupt request line that is asserted.
+ */
+static void sim_irq_lines(uint32_t *pending)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        uint32_t cr1 = SIM_I2C(i, CR1), isr = SIM_I2C(i, ISR);
+        uint8_t ev = ((cr1 & I2C_CR1_TXIE) && (isr & I2C_ISR_TXIS)) || ((cr1 & I2C_CR1_RXIE) && (isr & I2C_ISR_RXNE)) ||
+                     ((cr1 & I2C_CR1_ADDRIE) && (isr & I2C_ISR_ADDR)) ||
+                     ((cr1 & I2C_CR1_NACKIE) && (isr & I2C_ISR_NACKF)) ||
+                     ((cr1 & I2C_CR1_STOPIE) && (isr & I2C_ISR_STOPF)) ||
+                     ((cr1 & I2C_CR1_TCIE) && (isr & (I2C_ISR_TC | I2C_ISR_TCR)));
+        uint8_t er = (cr1 & I2C_CR1_ERRIE) && (isr & SIM_I2C_ERR_FLAGS);
+
+        if (!(cr1 & I2C_CR1_PE))
+        {
+            continue;
+        }
+        if (ev)
+        {
+            pending[sim_i2c_ev_irqs[i] >> 5] |= 1U << (sim_i2c_ev_irqs[i] & 31);
+        }
+        if (er)
+        {
+            pending[sim_i2c_er_irqs[i] >> 5] |= 1U << (sim_i2c_er_irqs[i] & 31);
+        }
+    }
+
+    for (uint32_t ch = 0; ch < SIM_DMA_CHANNELS; ch++)
+    {
+        uint32_t ccr = SIM_REG(sim_dma_channel(ch) + offsetof(DMA_Channel_TypeDef, CCR));
+        uint32_t shift, flags = *sim_dma_isr(ch, &shift) >> shift;
+        uint32_t irq = (ch < 7U) ? (DMA1_Channel1_IRQn + ch) : (DMA2_Channel1_IRQn + ch - 7U);
+
+        if (((ccr & DMA_CCR_TCIE) && (flags & DMA_ISR_TCIF1)) || ((ccr & DMA_CCR_HTIE) && (flags & DMA_ISR_HTIF1)) ||
+            ((ccr & DMA_CCR_TEIE) && (flags & DMA_ISR_TEIF1)))
+        {
+            pending[irq >> 5] |= 1U << (irq & 31);
+        }
+    }
+}
+
+/**
+ * @brief       Runs the handler of the lowest-numbered enabled pending interrupt, unless PRIMASK
+ *              is set or a handler is already running.
+ * @return      1 if a handler ran
+ */
+static uint8_t sim_take_irq(void)
+{
+    uint32_t pending[3] = {0};
+
+    if (sim_primask || sim_in_handler)
+    {
+        return 0;
+    }
+
+    sim_irq_lines(pending);
+
+    for (uint32_t w = 0; w < 3; w++)
+    {
+        uint32_t ready = (pending[w] | SIM_REG(&NVIC->ISPR[w])) & SIM_REG(&NVIC->ISER[w]);
+
+        if (ready)
+        {
+            uint32_t irq = 32U * w + (uint32_t)__builtin_ctz(ready);
+
+            if ((irq >= sizeof(sim_vectors) / sizeof(sim_vectors[0])) || !sim_vectors[irq])
+            {
+                sim_fail(__FILE__, __LINE__, "interrupt with no handler");
+            }
+
+            SIM_REG(&NVIC->ISPR[w]) &= ~(1U << (irq & 31));
+            sim_in_handler = 1;
+            sim_irqs++;
+            sim_vectors[irq]();
+            sim_in_handler = 0;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Lets the hardware run: DMA channels move bytes and interrupts are taken until
+ *              nothing more happens.
+ */
+void sim_run(void)
+{
+    for (uint32_t n = 0; n < 1000000U; n++)
+    {
+        uint8_t moved = sim_dma_step();
+
+        if (!sim_take_irq() && !moved)
+        {
+            return;
+        }
+    }
+
+    sim_fail(__FILE__, __LINE__, "the hardware never settles (an interrupt that is never cleared?)");
+}
+
+/**
+ * @brief       __set_PRIMASK and friends: unmasking takes pending interrupts at once.
+ */
+void sim_set_primask(uint32_t primask)
+{
+    sim_primask = primask & 1U;
+
+    while (!sim_primask && sim_take_irq())
+    {
+    }
+}
+
+/**
+ * @brief       __WFI: the hardware runs until it has nothing left to do.
+ */
+void sim_wfi(void)
+{
+    sim_run();
+}
+
+/* ---- NVIC, RCC, DWT ----------------------------------------------------------------------- */
+
+/**
+ * @brief       Applies a CPU write to an NVIC register: set-enable and set-pending registers OR
+ *              in the written bits, clear registers clear them.
+ */
+static void sim_nvic_write(uintptr_t addr, uint32_t old, uint32_t val)
+{
+    for (uint32_t w = 0; w < 8U; w++)
+    {
+        if (addr == (uintptr_t)&NVIC->ISER[w])
+        {
+            SIM_REG(addr) = old | val;
+            SIM_REG(&NVIC->ICER[w]) = old | val;
+        }
+        else if (addr == (uintptr_t)&NVIC->ICER[w])
+        {
+            SIM_REG(&NVIC->ISER[w]) &= ~val;
+            SIM_REG(addr) = SIM_REG(&NVIC->ISER[w]);
+        }
+        else if (addr == (uintptr_t)&NVIC->ISPR[w])
+        {
+            SIM_REG(addr) = old | val;
+            SIM_REG(&NVIC->ICPR[w]) = old | val;
+        }
+        else if (addr == (uintptr_t)&NVIC->ICPR[w])
+        {
+            SIM_REG(&NVIC->ISPR[w]) &= ~val;
+            SIM_REG(addr) = SIM_REG(&NVIC->ISPR[w]);
+        }
+    }
+}
+
+/**
+ * @brief       Model hook run before the CPU reads a register.
+ */
+static void sim_before_read(uintptr_t addr)
+{
+    if (addr == (uintptr_t)&DWT->CYCCNT)
+    {
+        /* the counter only runs once the trace block and the counter are both enabled */
+        if ((SIM_REG(&CoreDebug->DEMCR) & CoreDebug_DEMCR_TRCENA_Msk) && (SIM_REG(&DWT->CTRL) & DWT_CTRL_CYCCNTENA_Msk))
+        {
+            SIM_REG(addr) += SIM_CYCLES_PER_READ;
+        }
+    }
+    else if ((addr - GPIOA_BASE < 0x2000U) && ((addr & 0x3FFU) == offsetof(GPIO_TypeDef, IDR)))
+    {
+        sim_gpio_idr(addr & ~(uintptr_t)0x3FFU, (int)((addr - GPIOA_BASE) >> 10));
+    }
+}
+
+/**
+ * @brief       Model hook run after the CPU reads a register.
+ */
+static void sim_after_read(uintptr_t addr)
+{
+    int i = sim_i2c_index(addr & ~(uintptr_t)0x3FFU);
+
+    if ((i >= 0) && ((addr & 0x3FFU) == offsetof(I2C_TypeDef, RXDR)))
+    {
+        sim_i2c_rxdr(i);
+    }
+}
+
+/**
+ * @brief       Model hook run after the CPU writes a register.
+ */
+static void sim_after_write(uintptr_t addr, uint32_t old, uint32_t val)
+{
+    uintptr_t block = addr & ~(uintptr_t)0x3FFU;
+    int i = sim_i2c_index(block);
+
+    if (i >= 0)
+    {
+        sim_i2c_write(i, addr - block, old, val);
+    }
+    else if (addr - GPIOA_BASE < 0x2000U)
+    {
+        sim_gpio_write(block, (int)((addr - GPIOA_BASE) >> 10), addr - block, old, val);
+    }
+    else if ((block == DMA1_BASE) || (block == DMA2_BASE))
+    {
+        sim_dma_write(addr, old, val);
+    }
+    else if (addr == (uintptr_t)&RCC->APB1RSTR)
+    {
+        static const uint32_t rst[3] = {RCC_APB1RSTR_I2C1RST, RCC_APB1RSTR_I2C2RST, RCC_APB1RSTR_I2C3RST};
+
+        for (int n = 0; n < 3; n++)
+        {
+            if (val & rst[n])
+            {
+                sim_i2c_reset(n);
+            }
+        }
+    }
+    else if (addr - NVIC_BASE < sizeof(NVIC_Type))
+    {
+        sim_nvic_write(addr, old, val);
+    }
+}
+
+/* ---- access trapping ---------------------------------------------------------------------- */
+
+/**
+ * @brief       SIGSEGV: the CPU touched a watched page. Runs the read hook, opens the page and
+ *              single-steps the access.
+ */
+static void sim_segv(int sig, siginfo_t *info, void *context)
+{
+    ucontext_t *uc = context;
+    uintptr_t addr = (uintptr_t)info->si_addr & ~(uintptr_t)3;
+    uint8_t alias = (addr - PERIPH_BB_BASE < SIM_ALIAS_SIZE);
+    int r;
+
+    (void)sig;
+
+    if (sim_access.page || (!alias && (sim_region(addr) < 0)))
+    {
+        static const char msg[] = "sim: access outside the simulated peripherals\n";
+
+        (void)!write(2, msg, sizeof(msg) - 1);
+        _exit(2);
+    }
+
+    sim_access.write = (uc->uc_mcontext.gregs[REG_ERR] & SIM_ERR_WRITE) ? 1 : 0;
+    sim_access.page = addr & ~(uintptr_t)(SIM_PAGE - 1U);
+    sim_access.alias = alias ? addr : 0;
+    sim_access.reg = addr;
+
+    if (alias)
+    {
+        uintptr_t offset = addr - PERIPH_BB_BASE;
+        uintptr_t byte = PERIPH_BASE + (offset >> 5);
+
+        sim_access.reg = byte & ~(uintptr_t)3;
+        sim_access.bit = (uint32_t)(8U * (byte & 3U) + ((offset >> 2) & 7U));
+    }
+
+    if (!sim_access.write)
+    {
+        sim_before_read(sim_access.reg);
+    }
+    sim_access.old = SIM_REG(sim_access.reg);
+
+    mprotect((void *)sim_access.page, SIM_PAGE, PROT_READ | PROT_WRITE);
+    if (alias)
+    {
+        *(volatile uint32_t *)addr = (sim_access.old >> sim_access.bit) & 1U;
+    }
+
+    r = sim_region(sim_access.reg);
+    sim_hits[r][(sim_access.reg - sim_regions[r].base) >> 10]++;
+    sim_total++;
+
+    uc->uc_mcontext.gregs[REG_EFL] |= SIM_TRAP_FLAG;
+}
+
+/**
+ * @brief       SIGTRAP: the access has executed. Closes the page and runs the write or read hook.
+ */
+static void sim_trap(int sig, siginfo_t *info, void *context)
+{
+    ucontext_t *uc = context;
+    uintptr_t reg = sim_access.reg;
+    uint32_t old = sim_access.old;
+
+    (void)sig;
+    (void)info;
+
+    uc->uc_mcontext.gregs[REG_EFL] &= ~(greg_t)SIM_TRAP_FLAG;
+    if (!sim_access.page)
+    {
+        return;
+    }
+
+    if (sim_access.alias)
+    {
+        uint32_t level = *(volatile uint32_t *)sim_access.alias & 1U;
+
+        if (sim_access.write)
+        {
+            SIM_REG(reg) = (old & ~(1U << sim_access.bit)) | (level << sim_access.bit);
+        }
+    }
+
+    mprotect((void *)sim_access.page, SIM_PAGE, PROT_NONE);
+    sim_access.page = 0;
+
+    if (sim_log_len < SIM_LOG_LEN)
+    {
+        sim_log[sim_log_len] = (sim_log_t){reg, sim_access.write ? SIM_REG(reg) : old, sim_access.write};
+    }
+    sim_log_len++;
+
+    if (sim_access.write)
+    {
+        sim_after_write(reg, old, SIM_REG(reg));
+    }
+    else
+    {
+        sim_after_read(reg);
+    }
+}
+
+/**
+ * @brief       SIGALRM: a test that hangs fails instead.
+ */
+static void sim_watchdog(int sig)
+{
+    static const char msg[] = "sim: test timed out\n";
+
+    (void)sig;
+    (void)!write(2, msg, sizeof(msg) - 1);
+    _exit(3);
+}
+
+/**
+ * @brief       Maps the simulated address ranges, installs the access traps and resets the
+ *              hardware. Call once, first thing in main.
+ */
+void sim_init(void)
+{
+    struct sigaction sa;
+
+    for (int r = 0; r < 3; r++)
+    {
+        int fd = memfd_create("sim", 0);
+        void *dev;
+
+        if ((fd < 0) || (ftruncate(fd, (off_t)sim_regions[r].size) != 0))
+        {
+            sim_fail(__FILE__, __LINE__, "memfd_create");
+        }
+
+        dev = mmap((void *)sim_regions[r].base, sim_regions[r].size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+        sim_regions[r].raw = mmap(NULL, sim_regions[r].size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if ((dev != (void *)sim_regions[r].base) || (sim_regions[r].raw == MAP_FAILED))
+        {
+            sim_fail(__FILE__, __LINE__, "can't map the peripheral address space");
+        }
+    }
+
+    if (mmap((void *)PERIPH_BB_BASE, SIM_ALIAS_SIZE, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0) != (void *)PERIPH_BB_BASE)
+    {
+        sim_fail(__FILE__, __LINE__, "can't map the bit-band alias region");
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags = SA_SIGINFO;
+    sa.sa_sigaction = sim_segv;
+    sigaction(SIGSEGV, &sa, NULL);
+    sa.sa_sigaction = sim_trap;
+    sigaction(SIGTRAP, &sa, NULL);
+    signal(SIGALRM, sim_watchdog);
+    alarm(SIM_WATCHDOG_S);
+
+    for (size_t n = 0; n < sizeof(sim_watched) / sizeof(sim_watched[0]); n++)
+    {
+        mprotect((void *)sim_watched[n], SIM_PAGE, PROT_NONE);
+    }
+
+    sim_reset();
+}
+
+/**
+ * @brief       Power-on reset: every register to its reset value (0 in this model, bar I2C TXE),
+ *              devices answering, DWT stopped, counters zeroed.
+ * @note        Driver state in RAM (shadows, callbacks, bus records) is not reset.
+ */
+void sim_reset(void)
+{
+    for (int r = 0; r < 3; r++)
+    {
+        memset((void *)sim_regions[r].raw, 0, sim_regions[r].size);
+        memset(sim_hits[r], 0, sizeof(sim_hits[r]));
+    }
+
+    memset(sim_i2c, 0, sizeof(sim_i2c));
+    for (int i = 0; i < 3; i++)
+    {
+        sim_i2c_reset(i);
+    }
+
+    memset(sim_gpio_held_low, 0, sizeof(sim_gpio_held_low));
+    memset(sim_lock_step, 0, sizeof(sim_lock_step));
+    memset(sim_dma_len, 0, sizeof(sim_dma_len));
+    sim_total = 0;
+    sim_irqs = 0;
+    sim_log_len = 0;
+    sim_primask = 0;
+}
@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * @file    sim.h
+ * @author  Loren Snow
+ * @brief   Simulated peripheral bus for host tests header file.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "stm32f3xx.h"
+#include <stdint.h>
+
+/*
+ * The drivers run unmodified on the host. sim_init maps memory at the peripheral, bit-band alias,
+ * GPIO and core addresses, and keeps the pages of the modelled peripherals (GPIO, I2C, DMA, RCC,
+ * DWT, NVIC) inaccessible: every CPU access to them faults, is single-stepped and passes through a
+ * model of the register, and is counted. Other peripherals are plain memory.
+ *
+ * Interrupts are taken in sim_run, sim_wfi and when PRIMASK is cleared, never in the middle of a
+ * register access, and one at a time (a handler is never preempted). DMA channels move a byte per
+ * request, also in sim_run. Requests from unmodelled peripherals (timers) are made by the test,
+ * one transfer per sim_dma_request call.
+ *
+ * DMA and I2C address registers are 32 bits wide, so buffers handed to them must lie below 4 GB:
+ * use statics, which a -no-pie build places there.
+ */
+
+#define SIM_RAW(reg) (*sim_raw(&(reg))) ///< a register's contents, bypassing its model and the access counts
+
+#define SIM_I2C_LOG 2048U ///< bytes of controller writes each I2C model keeps
+#define SIM_LOG_LEN 64U   ///< CPU accesses sim_log keeps
+
+/**
+ * @brief   One CPU access to a modelled peripheral, as logged in sim_log.
+ */
+typedef struct
+{
+    uintptr_t reg; ///< register accessed (the peripheral-region word for bit-band accesses)
+    uint32_t val;  ///< the register after a write, or the value a read returned
+    uint8_t write;
+} sim_log_t;
+
+/**
+ * @brief   Model of the bus and devices behind one I2C instance.
+ * @note    In controller mode the addressed device answers at once: written bytes go to tx,
+ *          read bytes count up from rx_next. In target mode the test plays the host with the
+ *          sim_i2c_host_* functions.
+ */
+typedef struct
+{
+    uint8_t absent;             ///< NACK every address
+    uint8_t stuck;              ///< ignore START and hold BUSY, like a target keeping SDA low
+    uint8_t rx_next;            ///< next byte a controller read returns
+    uint8_t tx[SIM_I2C_LOG];    ///< bytes written by the controller
+    uint32_t tx_len;
+    uint32_t starts;            ///< START conditions sent by the controller
+    uint32_t stops;             ///< STOP conditions sent by the controller
+
+    /* owned by the model */
+    uint8_t active;
+    uint8_t reading;
+    uint32_t left;
+} sim_i2c_t;
+
+extern sim_i2c_t sim_i2c[3];          ///< I2C1, I2C2, I2C3
+extern uint16_t sim_gpio_held_low[8]; ///< per port, pins another device pulls low
+extern uint32_t sim_irqs;             ///< interrupt handlers run
+extern sim_log_t sim_log[SIM_LOG_LEN]; ///< the first accesses since the test last zeroed sim_log_len
+extern uint32_t sim_log_len;           ///< accesses since the test last zeroed it
+
+void sim_init(void);
+void sim_reset(void);
+volatile uint32_t *sim_raw(const volatile void *reg);
+uint32_t sim_accesses(const volatile void *periph);
+uint32_t sim_accesses_total(void);
+void sim_run(void);
+uint8_t sim_dma_request(const DMA_Channel_TypeDef *channel);
+sim_i2c_t *sim_i2c_model(const I2C_TypeDef *I2Cx);
+uint8_t sim_i2c_host_start(I2C_TypeDef *I2Cx, uint8_t addr, uint8_t read);
+uint8_t sim_i2c_host_write(I2C_TypeDef *I2Cx, uint8_t byte);
+int sim_i2c_host_read(I2C_TypeDef *I2Cx);
+void sim_i2c_host_stop(I2C_TypeDef *I2Cx);
+void sim_i2c_host_error(I2C_TypeDef *I2Cx, uint32_t isr_flag);
+
+/**
+ * @brief   Fails the test with a message if cond is false.
+ */
+#define SIM_CHECK(cond)                                                                                      \
+    do                                                                                                      \
+    {                                                                                                       \
+        if (!(cond))                                                                                        \
+        {                                                                                                   \
+            sim_fail(__FILE__, __LINE__, #cond);                                                            \
+        }                                                                                                   \
+    } while (0)
+
+void sim_fail(const char *file, int line, const char *what);
+
+#endif /* SIM_H */
@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file    test_bitband.c
+ * @author  Loren Snow
+ * @brief   Bit-band accessor tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "bitband.h"
+#include "sim.h"
+#include <stdio.h>
+
+/**
+ * @brief       Alias addresses taken from register pointers match the reference manual's formula:
+ *              0x42000000 + byte offset * 32 + bit * 4.
+ */
+static void test_alias_addresses(void)
+{
+    SIM_CHECK((uint32_t)&BITBAND_PERIPH(I2C2->ISR, I2C_ISR_BUSY_Pos) == 0x42000000UL + 0x5818UL * 32 + 15 * 4);
+    SIM_CHECK((uint32_t)&BITBAND_PERIPH(EXTI->IMR, 23) == 0x42000000UL + 0x10400UL * 32 + 23 * 4);
+    SIM_CHECK((uint32_t)&BITBAND_PERIPH(DMA1_Channel7->CCR, 0) == 0x42000000UL + 0x20080UL * 32);
+}
+
+/**
+ * @brief       An alias store changes one bit and an alias load returns one bit, in a single
+ *              access, where a read-modify-write takes two.
+ */
+static void test_alias_access(void)
+{
+    uint32_t before;
+
+    sim_reset();
+    SIM_RAW(I2C1->CR1) = I2C_CR1_TXIE | I2C_CR1_ERRIE;
+
+    before = sim_accesses(I2C1);
+    BITBAND_PERIPH(I2C1->CR1, I2C_CR1_NACKIE_Pos) = 1;
+    SIM_CHECK(sim_accesses(I2C1) - before == 1);
+    SIM_CHECK(SIM_RAW(I2C1->CR1) == (I2C_CR1_TXIE | I2C_CR1_ERRIE | I2C_CR1_NACKIE));
+
+    BITBAND_PERIPH(I2C1->CR1, I2C_CR1_TXIE_Pos) = 0;
+    SIM_CHECK(SIM_RAW(I2C1->CR1) == (I2C_CR1_ERRIE | I2C_CR1_NACKIE));
+
+    before = sim_accesses(I2C1);
+    SIM_CHECK(BITBAND_PERIPH(I2C1->CR1, I2C_CR1_ERRIE_Pos) == 1);
+    SIM_CHECK(BITBAND_PERIPH(I2C1->CR1, I2C_CR1_RXIE_Pos) == 0);
+    SIM_CHECK(sim_accesses(I2C1) - before == 2);
+
+    before = sim_accesses(I2C1);
+    I2C1->CR1 |= I2C_CR1_STOPIE;
+    SIM_CHECK(sim_accesses(I2C1) - before == 2);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_bitband\n");
+    test_alias_addresses();
+    test_alias_access();
+    printf("test_bitband: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * @file    test_bitbang.c
+ * @author  Loren Snow
+ * @brief   Software I2C tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "bitbang.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define SCL (1U << 8)
+#define SDA (1U << 9)
+
+static const bitbang_i2c_t bus = {{GPIOB, SCL}, {GPIOB, SDA}, BITBANG_HALF_PERIOD(100000U)};
+
+/**
+ * @brief       With nobody on the bus SDA stays high, so the address is NACKed.
+ */
+static void test_nack(void)
+{
+    uint8_t byte = 0x5A;
+
+    SIM_CHECK(bitbang_i2c_write(&bus, 0x50, &byte, 1) == BITBANG_I2C_NACK);
+    SIM_CHECK(bitbang_i2c_read(&bus, 0x50, &byte, 1) == BITBANG_I2C_NACK);
+    SIM_CHECK((SIM_RAW(GPIOB->ODR) & (SCL | SDA)) == (SCL | SDA));
+}
+
+/**
+ * @brief       A target that never lets go of SCL ends the transfer with a timeout, and both
+ *              lines are left released.
+ */
+static void test_stretch_timeout(void)
+{
+    uint8_t byte = 0x5A;
+
+    sim_gpio_held_low[1] = SCL;
+
+    SIM_CHECK(bitbang_i2c_write(&bus, 0x50, &byte, 1) == BITBANG_I2C_TIMEOUT);
+    SIM_CHECK((SIM_RAW(GPIOB->ODR) & (SCL | SDA)) == (SCL | SDA));
+    SIM_CHECK(bitbang_i2c_read(&bus, 0x50, &byte, 1) == BITBANG_I2C_TIMEOUT);
+    SIM_CHECK((SIM_RAW(GPIOB->ODR) & (SCL | SDA)) == (SCL | SDA));
+
+    sim_gpio_held_low[1] = 0;
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_bitbang\n");
+    bitbang_init();
+    bitbang_i2c_init(&bus);
+    test_nack();
+    test_stretch_timeout();
+    printf("test_bitbang: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file    test_dma.c
+ * @author  Loren Snow
+ * @brief   DMA channel lookup tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "dma.h"
+#include "sim.h"
+#include <stdio.h>
+
+static uint8_t buf[4];
+static uint32_t good_events, stray_events;
+
+static void good_cb(uint32_t events, void *ctx)
+{
+    (void)ctx;
+    good_events |= events;
+}
+
+static void stray_cb(uint32_t events, void *ctx)
+{
+    (void)ctx;
+    stray_events |= events;
+}
+
+/**
+ * @brief       A pointer that isn't a channel is rejected without touching any register, and
+ *              doesn't land on the last channel (DMA2 channel 5), whose callback still runs.
+ */
+static void test_unknown_channel(void)
+{
+    DMA_Channel_TypeDef *bogus = (DMA_Channel_TypeDef *)DMA1; // the controller, not a channel
+    uint32_t before;
+
+    SIM_CHECK(dma_channel_set_callback(DMA2_Channel5, good_cb, NULL) == DMA_OK);
+    SIM_CHECK(dma_channel_configure(DMA2_Channel5, &GPIOA->ODR, buf, sizeof(buf), DMA_CCR_TCIE) == DMA_OK);
+
+    before = sim_accesses_total();
+    SIM_CHECK(dma_channel_set_callback(bogus, stray_cb, NULL) == DMA_INVALID);
+    SIM_CHECK(dma_channel_configure(bogus, &GPIOB->ODR, buf, 1, 0) == DMA_INVALID);
+    SIM_CHECK(sim_accesses_total() == before);
+    SIM_CHECK(SIM_RAW(DMA2_Channel5->CNDTR) == sizeof(buf));
+    SIM_CHECK(SIM_RAW(DMA2_Channel5->CPAR) == (uint32_t)(uintptr_t)&GPIOA->ODR);
+
+    SIM_RAW(DMA2->ISR) |= DMA_ISR_GIF5 | DMA_ISR_TCIF5;
+    sim_run();
+
+    SIM_CHECK(good_events == DMA_EVT_FULL);
+    SIM_CHECK(stray_events == 0);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_dma\n");
+    test_unknown_channel();
+    printf("test_dma: ok\n");
+
+    return 0;
+}
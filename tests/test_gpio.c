@@ -0,0 +1,253 @@
+/**
+ ******************************************************************************
+ * @file    test_gpio.c
+ * @author  Loren Snow
+ * @brief   Register access counts of the GPIO pin writes.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "gpio.h"
+#include "sim.h"
+#include <stdio.h>
+
+void EXTI0_IRQHandler(void);
+
+/**
+ * @brief       Runs fn and returns the number of CPU accesses it made to a port.
+ */
+static uint32_t accesses(GPIO_TypeDef *GPIOx, void (*fn)(void))
+{
+    uint32_t before = sim_accesses(GPIOx);
+
+    fn();
+
+    return sim_accesses(GPIOx) - before;
+}
+
+/**
+ * @brief       What the LED helpers used to do: a read-modify-write of ODR.
+ */
+static void led_on_rmw(void)
+{
+    GPIOA->ODR |= LED_PIN;
+}
+
+static void led_off_rmw(void)
+{
+    GPIOA->ODR &= ~LED_PIN;
+}
+
+static void write_pins(void)
+{
+    gpio_write_pins(GPIOB, 0x00F0U, 0x000FU);
+}
+
+/**
+ * @brief       Each LED helper is a single store (toggle a load and a store), against two accesses
+ *              for the ODR read-modify-write, and drives the pin.
+ */
+static void test_led(void)
+{
+    uint32_t on, off, toggle, on_rmw, off_rmw;
+
+    gpioa_enable_led();
+
+    on = accesses(GPIOA, gpioa_led_on);
+    SIM_CHECK(SIM_RAW(GPIOA->ODR) & LED_PIN);
+    off = accesses(GPIOA, gpioa_led_off);
+    SIM_CHECK(!(SIM_RAW(GPIOA->ODR) & LED_PIN));
+    toggle = accesses(GPIOA, gpioa_led_toggle);
+    SIM_CHECK(SIM_RAW(GPIOA->ODR) & LED_PIN);
+    on_rmw = accesses(GPIOA, led_on_rmw);
+    off_rmw = accesses(GPIOA, led_off_rmw);
+
+    printf("  led_on %u, led_off %u, led_toggle %u accesses; ODR read-modify-write %u and %u\n", on, off, toggle,
+           on_rmw, off_rmw);
+
+    SIM_CHECK(on == 1);
+    SIM_CHECK(off == 1);
+    SIM_CHECK(toggle == 2);
+    SIM_CHECK((on_rmw == 2) && (off_rmw == 2));
+}
+
+/**
+ * @brief       gpio_write_pins sets and resets any mix of pins in one store and leaves the other pins
+ *              alone; a pin in both masks ends up set.
+ */
+static void test_write_pins(void)
+{
+    SIM_RAW(GPIOB->ODR) = 0x800FU;
+
+    SIM_CHECK(accesses(GPIOB, write_pins) == 1);
+    SIM_CHECK(SIM_RAW(GPIOB->ODR) == 0x80F0U);
+
+    gpio_write_pins(GPIOB, 0x0001U, 0x0001U);
+    SIM_CHECK(SIM_RAW(GPIOB->ODR) == 0x80F1U);
+
+    gpio_set_pins(GPIOC, 0x0300U);
+    gpio_reset_pins(GPIOC, 0x0100U);
+    SIM_CHECK(SIM_RAW(GPIOC->ODR) == 0x0200U);
+}
+
+/**
+ * @brief       Checks that sim_log holds exactly the expected accesses, in order.
+ */
+static void check_log(const volatile uint32_t *const *regs, const uint8_t *writes, uint32_t n)
+{
+    SIM_CHECK(sim_log_len == n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        SIM_CHECK(sim_log[i].reg == (uintptr_t)regs[i]);
+        SIM_CHECK(sim_log[i].write == writes[i]);
+    }
+}
+
+/**
+ * @brief       gpio_configure stores each register once from the shadow, MODER last, and the
+ *              queries never touch the port; gpio_lock_pins is the bare LCKR key sequence.
+ */
+static void test_configure_and_lock_accesses(void)
+{
+    static const gpio_config_t i2c_pins = {ALTERNATE, OPEN_DRAIN, HIGH_SPEED, PULL_UP, AF4};
+    const volatile uint32_t *configure[] = {&GPIOB->OTYPER, &GPIOB->OSPEEDR, &GPIOB->PUPDR, &GPIOB->AFR[1],
+                                            &GPIOB->MODER};
+    static const uint8_t configure_writes[] = {1, 1, 1, 1, 1};
+    const volatile uint32_t *lock[] = {&GPIOB->LCKR, &GPIOB->LCKR, &GPIOB->LCKR, &GPIOB->LCKR, &GPIOB->LCKR};
+    static const uint8_t lock_writes[] = {1, 1, 1, 0, 0};
+    const uint32_t pins = (1U << 8) | (1U << 9);
+    const uint32_t key = GPIO_LCKR_LCKK | pins;
+
+    sim_log_len = 0;
+    SIM_CHECK(gpio_configure(GPIOB, (uint16_t)pins, &i2c_pins) == GPIO_OK);
+    check_log(configure, configure_writes, 5);
+    SIM_CHECK(((SIM_RAW(GPIOB->MODER) >> 16) & 0xFU) == 0xAU); // both pins alternate
+
+    sim_log_len = 0;
+    SIM_CHECK(gpio_get_mode(GPIOB, 9) == ALTERNATE);
+    SIM_CHECK(gpio_get_alternate_fn(GPIOB, 8) == AF4);
+    SIM_CHECK(gpio_get_pullup_pulldown(GPIOB, 8) == PULL_UP);
+    SIM_CHECK(sim_log_len == 0);
+
+    sim_log_len = 0;
+    SIM_CHECK(gpio_lock_pins(GPIOB, (uint16_t)pins) == GPIO_OK);
+    check_log(lock, lock_writes, 5);
+    SIM_CHECK((sim_log[0].val == key) && (sim_log[1].val == pins) && (sim_log[2].val == key));
+    SIM_CHECK(sim_log[4].val & GPIO_LCKR_LCKK);
+
+    sim_log_len = 0;
+    SIM_CHECK(gpio_locked_pins(GPIOB) == pins);
+    SIM_CHECK(gpio_lock_pins(GPIOB, 1U << 0) == GPIO_LOCKED);
+    SIM_CHECK(sim_log_len == 0);
+}
+
+/**
+ * @brief       An edge inside the debounce window is caught up by gpio_event_dispatch and by
+ *              gpio_event_wait, which both leave interrupts masked if the caller had masked them.
+ */
+static void test_event_settle_keeps_primask(void)
+{
+    gpio_event_t evt;
+
+    gpio_event_enable(GPIOC, 0, EXTI_BOTH, 1000, NULL, NULL);
+
+    sim_gpio_held_low[2] = 0x0001U; // falls: reported
+    EXTI->PR = 1U << 0;
+    EXTI0_IRQHandler();
+    sim_gpio_held_low[2] = 0; // bounces back up inside the window: left unsettled
+    EXTI->PR = 1U << 0;
+    EXTI0_IRQHandler();
+
+    SIM_RAW(DWT->CYCCNT) += 2U * 8000U; // past the 1 ms window at 8 MHz
+
+    __disable_irq();
+    SIM_CHECK(gpio_event_dispatch() == 2);
+    SIM_CHECK(__get_PRIMASK() == 1U);
+    __enable_irq();
+
+    SIM_CHECK(!gpio_event_pop(&evt));
+
+    /* the same glitch, but sleeping in gpio_event_wait: it must report the settled level rather
+       than sleep on with only the fall queued and then consumed */
+    SIM_RAW(DWT->CYCCNT) += 2U * 8000U;
+    sim_gpio_held_low[2] = 0x0001U;
+    EXTI->PR = 1U << 0;
+    EXTI0_IRQHandler();
+    sim_gpio_held_low[2] = 0;
+    EXTI->PR = 1U << 0;
+    EXTI0_IRQHandler();
+    SIM_CHECK(gpio_event_pop(&evt) && (evt.level == 0));
+
+    SIM_RAW(DWT->CYCCNT) += 2U * 8000U;
+
+    __disable_irq();
+    gpio_event_wait();
+    SIM_CHECK(__get_PRIMASK() == 1U);
+    __enable_irq();
+
+    SIM_CHECK(gpio_event_pop(&evt) && (evt.level == 1));
+    SIM_CHECK(!gpio_event_pop(&evt));
+}
+
+/**
+ * @brief       A debounce window that has passed stays closed even when CYCCNT wraps round to
+ *              just after the last reported edge.
+ */
+static void test_event_debounce_survives_wrap(void)
+{
+    gpio_event_t evt;
+
+    gpio_event_enable(GPIOC, 0, EXTI_BOTH, 1000, NULL, NULL);
+
+    sim_gpio_held_low[2] = 0x0001U;
+    EXTI->PR = 1U << 0;
+    EXTI0_IRQHandler();
+    SIM_CHECK(gpio_event_pop(&evt) && (evt.level == 0));
+
+    SIM_RAW(DWT->CYCCNT) += 2U * 8000U;
+    SIM_CHECK(gpio_event_dispatch() == 0); // the window is over
+
+    SIM_RAW(DWT->CYCCNT) = evt.timestamp + 100U; // 2^32 cycles later, as far as CYCCNT can tell
+    sim_gpio_held_low[2] = 0;
+    EXTI->PR = 1U << 0;
+    EXTI0_IRQHandler();
+    SIM_CHECK(gpio_event_pop(&evt) && (evt.level == 1));
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_gpio\n");
+    test_led();
+    test_write_pins();
+    test_configure_and_lock_accesses();
+    test_event_settle_keeps_primask();
+    test_event_debounce_survives_wrap();
+    printf("test_gpio: ok\n");
+
+    return 0;
+}
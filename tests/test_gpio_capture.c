@@ -0,0 +1,194 @@
+/**
+ ******************************************************************************
+ * @file    test_gpio_capture.c
+ * @author  Loren Snow
+ * @brief   Trigger position and run-length dump of the GPIO capture.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "gpio_capture.h"
+#include "sim.h"
+#include <stdio.h>
+
+void EXTI0_IRQHandler(void);
+
+#define RING_LEN 16U
+#define MAX_RUNS 8U
+
+static uint16_t ring[RING_LEN];
+
+/**
+ * @brief       The (value, run) pairs a dump emitted.
+ */
+typedef struct
+{
+    uint16_t value[MAX_RUNS];
+    uint32_t run[MAX_RUNS];
+    uint32_t n;
+} runs_t;
+
+static void record(uint16_t value, uint32_t run, void *ctx)
+{
+    runs_t *runs = ctx;
+
+    if (runs->n < MAX_RUNS)
+    {
+        runs->value[runs->n] = value;
+        runs->run[runs->n] = run;
+    }
+    runs->n++;
+}
+
+/**
+ * @brief       Starts a capture of GPIOC paced by TIM2, optionally triggered on PC0 rising.
+ */
+static void start(gpio_capture_t *cap, uint8_t triggered)
+{
+    sim_reset();
+    sim_gpio_held_low[2] = 0;
+
+    *cap = (gpio_capture_t){
+        .GPIOx = GPIOC,
+        .TIMx = TIM2,
+        .buf = ring,
+        .len = RING_LEN,
+        .rate_hz = 1000,
+        .trig_port = triggered ? GPIOC : NULL,
+        .trig_pin = 0,
+        .trig_edge = EXTI_RISING,
+    };
+    SIM_CHECK(gpio_capture_start(cap) == GPIO_OK);
+}
+
+/**
+ * @brief       Lets the timer take n samples, the pins pulled low by held_low[k] for sample k.
+ */
+static void sample(const gpio_capture_t *cap, const uint16_t *held_low, uint32_t n)
+{
+    for (uint32_t k = 0; k < n; k++)
+    {
+        sim_gpio_held_low[2] = held_low ? held_low[k] : 0;
+        SIM_CHECK(sim_dma_request(cap->ch));
+    }
+}
+
+/**
+ * @brief       Trigger in the second half of the third lap: the capture runs on past the wrap
+ *              to the next half boundary, and the dump starts mid-ring and crosses index 0.
+ */
+static void test_trigger_mid_ring(void)
+{
+    static uint16_t held_low[40];
+    gpio_capture_t cap;
+    runs_t runs = {0};
+
+    for (uint32_t k = 0; k < 40; k++)
+    {
+        held_low[k] = (k < 24) ? 0x00F0U : (k < 26) ? 0 : (k < 30) ? 0x0001U : (k < 36) ? 0x0003U : 0;
+    }
+
+    start(&cap, 1);
+    sample(&cap, held_low, 26);
+
+    EXTI->PR = 1U << 0; // rising edge at ring index 10
+    EXTI0_IRQHandler();
+    SIM_CHECK(cap.state == CAPTURE_TRIGGERED);
+
+    sample(&cap, held_low + 26, 13);
+    SIM_CHECK(!gpio_capture_done(&cap)); // still short of the half boundary after the wrap
+    sample(&cap, held_low + 39, 1);
+    SIM_CHECK(gpio_capture_done(&cap));
+    SIM_CHECK(!sim_dma_request(cap.ch)); // the timer's requests no longer land
+
+    SIM_CHECK(gpio_capture_count(&cap) == RING_LEN);
+    SIM_CHECK(cap.end_index == 8);
+    SIM_CHECK(gpio_capture_trigger_offset(&cap) == 2); // samples 24 and 25 precede the edge
+
+    gpio_capture_dump(&cap, record, &runs);
+    SIM_CHECK(runs.n == 4);
+    SIM_CHECK((runs.value[0] == 0xFFFFU) && (runs.run[0] == 2));
+    SIM_CHECK((runs.value[1] == 0xFFFEU) && (runs.run[1] == 4));
+    SIM_CHECK((runs.value[2] == 0xFFFCU) && (runs.run[2] == 6)); // indexes 14, 15, 0 .. 3
+    SIM_CHECK((runs.value[3] == 0xFFFFU) && (runs.run[3] == 4));
+}
+
+/**
+ * @brief       A port that sits still through several laps is one run of the whole ring, even
+ *              though the run wraps around the end of the buffer.
+ */
+static void test_idle_wrapped(void)
+{
+    gpio_capture_t cap;
+    runs_t runs = {0};
+
+    start(&cap, 0);
+    sample(&cap, NULL, 3U * RING_LEN + 5U);
+    gpio_capture_stop(&cap);
+
+    SIM_CHECK(gpio_capture_done(&cap));
+    SIM_CHECK(gpio_capture_count(&cap) == RING_LEN);
+    SIM_CHECK(cap.end_index == 5);
+    SIM_CHECK(gpio_capture_trigger_offset(&cap) == -1);
+
+    gpio_capture_dump(&cap, record, &runs);
+    SIM_CHECK(runs.n == 1);
+    SIM_CHECK((runs.value[0] == 0xFFFFU) && (runs.run[0] == RING_LEN));
+}
+
+/**
+ * @brief       Stopped before the first lap: only the samples taken are dumped, from index 0.
+ */
+static void test_stopped_early(void)
+{
+    static const uint16_t held_low[5] = {0, 0, 0x8000U, 0x8000U, 0x8000U};
+    gpio_capture_t cap;
+    runs_t runs = {0};
+
+    start(&cap, 0);
+    sample(&cap, held_low, 5);
+    gpio_capture_stop(&cap);
+
+    SIM_CHECK(gpio_capture_count(&cap) == 5);
+
+    gpio_capture_dump(&cap, record, &runs);
+    SIM_CHECK(runs.n == 2);
+    SIM_CHECK((runs.value[0] == 0xFFFFU) && (runs.run[0] == 2));
+    SIM_CHECK((runs.value[1] == 0x7FFFU) && (runs.run[1] == 3));
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_gpio_capture\n");
+    test_trigger_mid_ring();
+    test_idle_wrapped();
+    test_stopped_early();
+    printf("test_gpio_capture: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+/**
+ ******************************************************************************
+ * @file    test_i2c_dma.c
+ * @author  Loren Snow
+ * @brief   I2C polled, interrupt and DMA transfer benchmark.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define FRAME_LEN 1024U ///< an SSD1306 framebuffer
+
+static uint8_t frame[FRAME_LEN]; // read by DMA, so below 4 GB
+static uint8_t rx[FRAME_LEN];
+static volatile uint32_t done_calls;
+static volatile I2C_Status done_status;
+
+static void done(I2C_Status status, void *ctx)
+{
+    (void)ctx;
+    done_calls++;
+    done_status = status;
+}
+
+/**
+ * @brief       CPU cost of one transfer: register accesses the CPU made and interrupts taken.
+ */
+typedef struct
+{
+    uint32_t accesses;
+    uint32_t irqs;
+} cost_t;
+
+/**
+ * @brief       Resets the simulator and brings up I2C1 in fast mode plus.
+ */
+static void setup(void)
+{
+    sim_reset();
+    SIM_CHECK(I2C_init(I2C1, Fast_Plus) == I2C_OK);
+    done_calls = 0;
+}
+
+/**
+ * @brief       Runs the simulator until the transfer in flight on I2C1 completes.
+ */
+static void wait_done(void)
+{
+    while (I2C_busy(I2C1))
+    {
+        sim_run();
+    }
+
+    SIM_CHECK(done_calls == 1);
+    SIM_CHECK(done_status == I2C_OK);
+}
+
+/**
+ * @brief       Cost of what ran since the counters read accesses and irqs.
+ */
+static cost_t cost_since(uint32_t accesses, uint32_t irqs)
+{
+    cost_t c = {sim_accesses_total() - accesses, sim_irqs - irqs};
+
+    return c;
+}
+
+/**
+ * @brief       Checks that the device got the whole frame, in order.
+ */
+static void check_frame_sent(void)
+{
+    SIM_CHECK(sim_i2c[0].tx_len == FRAME_LEN);
+    for (uint32_t i = 0; i < FRAME_LEN; i++)
+    {
+        SIM_CHECK(sim_i2c[0].tx[i] == frame[i]);
+    }
+}
+
+/**
+ * @brief       Sends the frame with I2C_write_bytes, polling TXIS.
+ */
+static cost_t write_polled(void)
+{
+    uint32_t a, n;
+
+    setup();
+    a = sim_accesses_total();
+    n = sim_irqs;
+    SIM_CHECK(I2C_write_bytes(I2C1, 0x3C, frame, FRAME_LEN) == I2C_OK);
+    check_frame_sent();
+
+    return cost_since(a, n);
+}
+
+/**
+ * @brief       Sends the frame with I2C_write_async, a byte per TXIS interrupt.
+ */
+static cost_t write_async(void)
+{
+    uint32_t a, n;
+
+    setup();
+    a = sim_accesses_total();
+    n = sim_irqs;
+    SIM_CHECK(I2C_write_async(I2C1, 0x3C, frame, FRAME_LEN, done, NULL) == I2C_OK);
+    wait_done();
+    check_frame_sent();
+
+    return cost_since(a, n);
+}
+
+/**
+ * @brief       Sends the frame with I2C_write_dma.
+ */
+static cost_t write_dma(void)
+{
+    uint32_t a, n;
+
+    setup();
+    a = sim_accesses_total();
+    n = sim_irqs;
+    SIM_CHECK(I2C_write_dma(I2C1, 0x3C, frame, FRAME_LEN, done, NULL) == I2C_OK);
+    wait_done();
+    check_frame_sent();
+
+    return cost_since(a, n);
+}
+
+/**
+ * @brief       Reads a frame with I2C_read_bytes, polling RXNE.
+ */
+static cost_t read_polled(void)
+{
+    uint32_t a, n;
+
+    setup();
+    a = sim_accesses_total();
+    n = sim_irqs;
+    SIM_CHECK(I2C_read_bytes(I2C1, 0x3C, rx, FRAME_LEN) == I2C_OK);
+    SIM_CHECK((rx[0] == 0) && (rx[FRAME_LEN - 1] == (uint8_t)(FRAME_LEN - 1)));
+
+    return cost_since(a, n);
+}
+
+/**
+ * @brief       Reads a frame with I2C_read_dma.
+ */
+static cost_t read_dma(void)
+{
+    uint32_t a, n;
+
+    setup();
+    a = sim_accesses_total();
+    n = sim_irqs;
+    SIM_CHECK(I2C_read_dma(I2C1, 0x3C, rx, FRAME_LEN, done, NULL) == I2C_OK);
+    wait_done();
+    SIM_CHECK((rx[0] == 0) && (rx[FRAME_LEN - 1] == (uint8_t)(FRAME_LEN - 1)));
+
+    return cost_since(a, n);
+}
+
+/**
+ * @brief       Prints a transfer's cost.
+ */
+static void report(const char *name, cost_t c)
+{
+    printf("  %-12s %5u register accesses, %4u interrupts, %6.2f bytes per access\n", name, c.accesses, c.irqs,
+           (double)FRAME_LEN / c.accesses);
+}
+
+/**
+ * @brief       A 1 KB frame over DMA costs the CPU a small, fixed number of register accesses and
+ *              interrupts (setup, one per 255-byte reload, the STOP), against several per byte for
+ *              the polled and interrupt-driven paths.
+ */
+static void test_frame_throughput(void)
+{
+    cost_t polled, async, dma, rpolled, rdma;
+
+    for (uint32_t i = 0; i < FRAME_LEN; i++)
+    {
+        frame[i] = (uint8_t)(i * 7U);
+    }
+
+    polled = write_polled();
+    async = write_async();
+    dma = write_dma();
+    rpolled = read_polled();
+    rdma = read_dma();
+
+    report("write polled", polled);
+    report("write irq", async);
+    report("write dma", dma);
+    report("read polled", rpolled);
+    report("read dma", rdma);
+
+    SIM_CHECK(polled.accesses >= 2 * FRAME_LEN); // at least a TXIS poll and a TXDR store per byte
+    SIM_CHECK(async.irqs >= FRAME_LEN);
+    SIM_CHECK(dma.accesses * 20 < polled.accesses);
+    SIM_CHECK(dma.irqs <= FRAME_LEN / 255 + 2);
+    SIM_CHECK(rdma.accesses * 20 < rpolled.accesses);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_i2c_dma\n");
+    test_frame_throughput();
+    printf("test_i2c_dma: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ ******************************************************************************
+ * @file    test_i2c_queue.c
+ * @author  Loren Snow
+ * @brief   I2C transaction queue tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_queue.h"
+#include "sim.h"
+#include <stdio.h>
+
+static const uint8_t payload[3] = {0x10, 0x20, 0x30};
+static i2c_queue_t queue;
+static uint32_t calls;
+static I2C_Status last_status;
+static uint32_t last_primask;
+
+static void done(I2C_Status status, void *ctx)
+{
+    (void)ctx;
+    calls++;
+    last_status = status;
+    last_primask = __get_PRIMASK();
+}
+
+/**
+ * @brief       A transaction that finds the bus held by another controller stays queued, and goes
+ *              out once the bus is free.
+ */
+static void test_busy_bus_retries(void)
+{
+    i2c_txn_t txn = {.addr = 0x50, .tx = payload, .tx_len = sizeof(payload), .priority = I2C_PRIORITY_NORMAL,
+                     .cb = done};
+
+    calls = 0;
+    SIM_RAW(I2C1->ISR) |= I2C_ISR_BUSY;
+
+    SIM_CHECK(i2c_queue_submit(&queue, &txn) == I2C_OK);
+    sim_run();
+    SIM_CHECK(calls == 0);
+    SIM_CHECK(!i2c_queue_idle(&queue));
+    SIM_CHECK(sim_i2c[0].starts == 0);
+
+    i2c_queue_poll(&queue);
+    SIM_CHECK(calls == 0); // still busy
+
+    SIM_RAW(I2C1->ISR) &= ~I2C_ISR_BUSY;
+    i2c_queue_poll(&queue);
+    sim_run();
+
+    SIM_CHECK(calls == 1);
+    SIM_CHECK(last_status == I2C_OK);
+    SIM_CHECK(i2c_queue_idle(&queue));
+    SIM_CHECK(sim_i2c[0].tx_len == sizeof(payload));
+    SIM_CHECK((sim_i2c[0].tx[0] == 0x10) && (sim_i2c[0].tx[2] == 0x30));
+}
+
+/**
+ * @brief       A transaction that can't start at all is failed, with its callback run after the
+ *              queue has restored PRIMASK, and the next one still goes out.
+ */
+static void test_failed_start_callback_unmasked(void)
+{
+    i2c_txn_t bad = {.addr = 0x800, .tx = payload, .tx_len = 1, .priority = I2C_PRIORITY_HIGH, .cb = done};
+    i2c_txn_t good = {.addr = 0x50, .tx = payload, .tx_len = 1, .priority = I2C_PRIORITY_NORMAL, .cb = done};
+
+    calls = 0;
+    SIM_RAW(I2C1->ISR) |= I2C_ISR_BUSY;
+    i2c_queue_submit(&queue, &good); // held back by the busy bus
+    i2c_queue_submit(&queue, &bad);  // fails at once
+
+    SIM_CHECK(calls == 1);
+    SIM_CHECK(bad.status == I2C_INVALID);
+    SIM_CHECK(last_status == I2C_INVALID);
+    SIM_CHECK(last_primask == 0);
+
+    SIM_RAW(I2C1->ISR) &= ~I2C_ISR_BUSY;
+    i2c_queue_poll(&queue);
+    sim_run();
+
+    SIM_CHECK(calls == 2);
+    SIM_CHECK(last_status == I2C_OK);
+    SIM_CHECK(i2c_queue_idle(&queue));
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_i2c_queue\n");
+    SIM_CHECK(I2C_init(I2C1, Standard) == I2C_OK);
+    i2c_queue_init(&queue, I2C1);
+    test_busy_bus_retries();
+    test_failed_start_callback_unmasked();
+    printf("test_i2c_queue: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ ******************************************************************************
+ * @file    test_i2c_recover.c
+ * @author  Loren Snow
+ * @brief   I2C controller setup and bus recovery tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "gpio.h"
+#include "i2c.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define OWN_OAR1 (I2C_OAR1_OA1EN | (0x42U << 1))
+#define OWN_OAR2 (I2C_OAR2_OA2EN | (0x30U << I2C_OAR2_OA2_Pos))
+#define OWN_CR1 ((3U << I2C_CR1_DNF_Pos) | I2C_CR1_ADDRIE | I2C_CR1_ERRIE)
+
+/**
+ * @brief       I2C_init starts the cycle counter its timeouts run on.
+ */
+static void test_init_starts_dwt(void)
+{
+    uint32_t before;
+
+    sim_reset();
+    SIM_CHECK(I2C_init(I2C1, Standard) == I2C_OK);
+    SIM_CHECK(SIM_RAW(CoreDebug->DEMCR) & CoreDebug_DEMCR_TRCENA_Msk);
+    SIM_CHECK(SIM_RAW(DWT->CTRL) & DWT_CTRL_CYCCNTENA_Msk);
+
+    before = DWT->CYCCNT;
+    SIM_CHECK(DWT->CYCCNT != before);
+}
+
+/**
+ * @brief       Sets up I2C1 with own addresses and CR1 settings, as a target would, and its
+ *              recovery pins on PB8 (SCL) and PB9 (SDA).
+ */
+static void setup_bus(void)
+{
+    sim_reset();
+    SIM_CHECK(I2C_init(I2C1, Fast) == I2C_OK);
+
+    I2C1->CR1 &= ~I2C_CR1_PE;
+    I2C1->OAR1 = OWN_OAR1;
+    I2C1->OAR2 = OWN_OAR2;
+    I2C1->CR1 |= OWN_CR1;
+    I2C1->CR1 |= I2C_CR1_PE;
+
+    I2C_set_bus_pins(I2C1, GPIOB, 8, GPIOB, 9);
+}
+
+/**
+ * @brief       Checks that the RCC reset of a recovery kept everything set up before it.
+ */
+static void check_config_kept(uint32_t timingr)
+{
+    SIM_CHECK(SIM_RAW(I2C1->TIMINGR) == timingr);
+    SIM_CHECK(SIM_RAW(I2C1->OAR1) == OWN_OAR1);
+    SIM_CHECK(SIM_RAW(I2C1->OAR2) == OWN_OAR2);
+    SIM_CHECK((SIM_RAW(I2C1->CR1) & (OWN_CR1 | I2C_CR1_PE)) == (OWN_CR1 | I2C_CR1_PE));
+}
+
+/**
+ * @brief       A recovery of a free bus keeps the timing, own addresses and CR1 settings.
+ */
+static void test_recover_keeps_config(void)
+{
+    uint32_t timingr;
+
+    setup_bus();
+    timingr = SIM_RAW(I2C1->TIMINGR);
+
+    SIM_CHECK(I2C_recover(I2C1) == I2C_OK);
+    check_config_kept(timingr);
+    SIM_CHECK(gpio_get_mode(GPIOB, 8) == ALTERNATE);
+    SIM_CHECK(gpio_get_mode(GPIOB, 9) == ALTERNATE);
+}
+
+/**
+ * @brief       SDA held low through all nine clocks leaves the bus busy.
+ */
+static void test_recover_stuck_sda(void)
+{
+    uint32_t timingr;
+
+    setup_bus();
+    timingr = SIM_RAW(I2C1->TIMINGR);
+    sim_gpio_held_low[1] = 1U << 9;
+
+    SIM_CHECK(I2C_recover(I2C1) == I2C_BUSY);
+    check_config_kept(timingr);
+}
+
+/**
+ * @brief       A locked recovery pin can't be driven as a GPIO, which is reported rather than
+ *              passed off as a recovery. Runs last: the lock lasts until the next reset.
+ */
+static void test_recover_locked_pin(void)
+{
+    uint32_t timingr;
+
+    setup_bus();
+    timingr = SIM_RAW(I2C1->TIMINGR);
+    gpio_set_mode(GPIOB, 8, ALTERNATE);
+    gpio_set_mode(GPIOB, 9, ALTERNATE);
+    SIM_CHECK(gpio_lock_pins(GPIOB, 1U << 8) == GPIO_OK);
+
+    SIM_CHECK(I2C_recover(I2C1) == I2C_INVALID);
+    check_config_kept(timingr);
+    SIM_CHECK(gpio_get_mode(GPIOB, 9) == ALTERNATE);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_i2c_recover\n");
+    test_init_starts_dwt();
+    test_recover_keeps_config();
+    test_recover_stuck_sda();
+    test_recover_locked_pin();
+    printf("test_i2c_recover: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ ******************************************************************************
+ * @file    test_i2c_regmap.c
+ * @author  Loren Snow
+ * @brief   I2C register map cache tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_regmap.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define DEV_ADDR 0x68U
+#define DEV_REGS 16U
+
+static uint8_t cache[DEV_REGS];
+static uint32_t valid[I2C_REGMAP_WORDS(DEV_REGS)];
+static uint32_t dirty[I2C_REGMAP_WORDS(DEV_REGS)];
+static const uint32_t volatile_regs[I2C_REGMAP_WORDS(DEV_REGS)] = {1U << 15}; // a status register
+static const i2c_regmap_config_t cfg = {.I2Cx = I2C1, .addr = DEV_ADDR, .size = DEV_REGS, .cache = cache,
+                                        .valid = valid, .dirty = dirty, .volatile_regs = volatile_regs};
+static i2c_regmap_t map;
+
+/**
+ * @brief       Resets the simulator and the map; the device's reads return 0x40, 0x41, ...
+ */
+static void setup(void)
+{
+    sim_reset();
+    SIM_CHECK(I2C_init(I2C1, Fast) == I2C_OK);
+    i2c_regmap_init(&map, &cfg);
+    sim_i2c[0].rx_next = 0x40;
+}
+
+/**
+ * @brief       The first read of a run goes to the device; reading it again is served from the
+ *              cache without touching the bus.
+ */
+static void test_read_caches(void)
+{
+    uint8_t data[4];
+    uint32_t starts;
+
+    setup();
+    SIM_CHECK(i2c_regmap_read(&map, 4, data, 4) == I2C_OK);
+    SIM_CHECK((data[0] == 0x40) && (data[3] == 0x43));
+    SIM_CHECK((sim_i2c[0].tx_len == 1) && (sim_i2c[0].tx[0] == 4)); // the register pointer
+
+    starts = sim_i2c[0].starts;
+    SIM_CHECK(i2c_regmap_read(&map, 5, data, 2) == I2C_OK);
+    SIM_CHECK((data[0] == 0x41) && (data[1] == 0x42));
+    SIM_CHECK(sim_i2c[0].starts == starts);
+}
+
+/**
+ * @brief       A volatile register is read from the device every time.
+ */
+static void test_volatile_not_cached(void)
+{
+    uint8_t data;
+    uint32_t starts;
+
+    setup();
+    SIM_CHECK(i2c_regmap_read(&map, 15, &data, 1) == I2C_OK);
+    starts = sim_i2c[0].starts;
+    SIM_CHECK(i2c_regmap_read(&map, 15, &data, 1) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts > starts);
+    SIM_CHECK(data == 0x41);
+}
+
+/**
+ * @brief       A read-modify-write of a cached register reads nothing from the bus, and writes
+ *              nothing when the value doesn't change.
+ */
+static void test_update_bits(void)
+{
+    uint8_t data;
+    uint32_t starts;
+
+    setup();
+    SIM_CHECK(i2c_regmap_read(&map, 2, &data, 1) == I2C_OK); // caches 0x40
+
+    starts = sim_i2c[0].starts;
+    sim_i2c[0].tx_len = 0;
+    SIM_CHECK(i2c_regmap_update_bits(&map, 2, 0x0F, 0x05) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == starts + 1); // the write only
+    SIM_CHECK((sim_i2c[0].tx_len == 2) && (sim_i2c[0].tx[0] == 2) && (sim_i2c[0].tx[1] == 0x45));
+
+    starts = sim_i2c[0].starts;
+    SIM_CHECK(i2c_regmap_update_bits(&map, 2, 0x0F, 0x05) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == starts);
+}
+
+/**
+ * @brief       Writes held in cache-only mode go out on sync as one burst per contiguous run.
+ */
+static void test_sync_bursts(void)
+{
+    static const uint8_t run[2] = {0x11, 0x22};
+    static const uint8_t one = 0x55;
+
+    setup();
+    i2c_regmap_cache_only(&map, 1);
+    SIM_CHECK(i2c_regmap_write(&map, 2, run, 2) == I2C_OK);
+    SIM_CHECK(i2c_regmap_write(&map, 7, &one, 1) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == 0);
+
+    SIM_CHECK(i2c_regmap_sync(&map) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == 2);
+    SIM_CHECK(sim_i2c[0].tx_len == 5);
+    SIM_CHECK((sim_i2c[0].tx[0] == 2) && (sim_i2c[0].tx[1] == 0x11) && (sim_i2c[0].tx[2] == 0x22));
+    SIM_CHECK((sim_i2c[0].tx[3] == 7) && (sim_i2c[0].tx[4] == 0x55));
+
+    SIM_CHECK(i2c_regmap_sync(&map) == I2C_OK); // nothing left dirty
+    SIM_CHECK(sim_i2c[0].starts == 2);
+}
+
+/**
+ * @brief       A write the device NACKs leaves the run uncached, so the next read goes to the
+ *              device.
+ */
+static void test_failed_write_uncached(void)
+{
+    static const uint8_t val = 0x99;
+    uint8_t data;
+
+    setup();
+    sim_i2c[0].absent = 1;
+    SIM_CHECK(i2c_regmap_write(&map, 3, &val, 1) == I2C_NACK);
+
+    sim_i2c[0].absent = 0;
+    SIM_CHECK(i2c_regmap_read(&map, 3, &data, 1) == I2C_OK);
+    SIM_CHECK(data == 0x40);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_i2c_regmap\n");
+    test_read_caches();
+    test_volatile_not_cached();
+    test_update_bits();
+    test_sync_bursts();
+    test_failed_write_uncached();
+    printf("test_i2c_regmap: ok\n");
+
+    return 0;
+}
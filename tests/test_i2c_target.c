@@ -0,0 +1,175 @@
+/**
+ ******************************************************************************
+ * @file    test_i2c_target.c
+ * @author  Loren Snow
+ * @brief   I2C target mode tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_target.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define OWN_ADDR 0x3CU
+
+static uint8_t regs[16]; // fed to TXDR by DMA, so below 4 GB
+static const i2c_target_region_t writable[] = {{0, 7}};
+static i2c_target_t target;
+static uint32_t writes;
+static uint8_t write_first;
+static uint16_t write_len;
+
+static void on_write(uint8_t first, uint16_t len, uint16_t addr, void *ctx)
+{
+    (void)addr;
+    (void)ctx;
+    writes++;
+    write_first = first;
+    write_len = len;
+}
+
+static const i2c_target_config_t cfg = {.mode = Standard, .own_addr = OWN_ADDR, .regs = regs, .size = sizeof(regs),
+                                        .regions = writable, .region_count = 1, .on_write = on_write};
+
+/**
+ * @brief       Resets the simulator and the register file and puts an instance in target mode.
+ */
+static void setup(I2C_TypeDef *I2Cx)
+{
+    sim_reset();
+    for (uint32_t i = 0; i < sizeof(regs); i++)
+    {
+        regs[i] = (uint8_t)(0xA0 + i);
+    }
+
+    writes = 0;
+    SIM_CHECK(i2c_target_init(&target, I2Cx, &cfg) == I2C_OK);
+}
+
+/**
+ * @brief       A host write lands in the writable registers and is reported once it ends.
+ */
+static void test_write(I2C_TypeDef *I2Cx)
+{
+    setup(I2Cx);
+
+    SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 0));
+    SIM_CHECK(sim_i2c_host_write(I2Cx, 6)); // pointer
+    SIM_CHECK(sim_i2c_host_write(I2Cx, 0x11));
+    SIM_CHECK(sim_i2c_host_write(I2Cx, 0x22));
+    SIM_CHECK(sim_i2c_host_write(I2Cx, 0x33)); // register 8 is read-only
+    sim_i2c_host_stop(I2Cx);
+
+    SIM_CHECK((regs[6] == 0x11) && (regs[7] == 0x22) && (regs[8] == 0xA8));
+    SIM_CHECK((writes == 1) && (write_first == 6) && (write_len == 3));
+    SIM_CHECK(target.ptr == 9);
+    SIM_CHECK(target.errors == 0);
+}
+
+/**
+ * @brief       A host read after a pointer write gets the registers from the pointer on.
+ */
+static void test_read(I2C_TypeDef *I2Cx)
+{
+    setup(I2Cx);
+
+    SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 0));
+    SIM_CHECK(sim_i2c_host_write(I2Cx, 14));
+    SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 1)); // repeated START
+    SIM_CHECK(sim_i2c_host_read(I2Cx) == 0xAE);
+    SIM_CHECK(sim_i2c_host_read(I2Cx) == 0xAF);
+    SIM_CHECK(sim_i2c_host_read(I2Cx) == 0xA0); // wraps
+    sim_i2c_host_stop(I2Cx);
+
+    SIM_CHECK(target.ptr == 1);
+    SIM_CHECK(!target.transmitting);
+    SIM_CHECK(writes == 0);
+}
+
+/**
+ * @brief       Each error flag is cleared, ends the phase in progress and is recorded, and the
+ *              target answers the next transfer normally.
+ */
+static void test_errors(I2C_TypeDef *I2Cx)
+{
+    static const struct
+    {
+        uint32_t flag;
+        I2C_Status status;
+    } cases[] = {
+        {I2C_ISR_BERR, I2C_BERR}, {I2C_ISR_ARLO, I2C_ARLO}, {I2C_ISR_TIMEOUT, I2C_TIMEOUT}, {I2C_ISR_OVR, I2C_BERR}};
+
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        /* cut a host write short */
+        setup(I2Cx);
+        SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 0));
+        SIM_CHECK(sim_i2c_host_write(I2Cx, 2));
+        SIM_CHECK(sim_i2c_host_write(I2Cx, 0x55));
+        sim_i2c_host_error(I2Cx, cases[i].flag);
+
+        SIM_CHECK(!(SIM_RAW(I2Cx->ISR) & cases[i].flag));
+        SIM_CHECK((target.errors == 1) && (target.error == cases[i].status));
+        SIM_CHECK(!target.ptr_pending && !target.rx_count);
+        SIM_CHECK((regs[2] == 0x55) && (writes == 1) && (write_len == 1));
+        SIM_CHECK(target.ptr == 3);
+
+        /* cut a host read short */
+        SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 1));
+        SIM_CHECK(sim_i2c_host_read(I2Cx) == 0xA3);
+        sim_i2c_host_error(I2Cx, cases[i].flag);
+
+        SIM_CHECK(!(SIM_RAW(I2Cx->ISR) & cases[i].flag));
+        SIM_CHECK((target.errors == 2) && (target.error == cases[i].status));
+        SIM_CHECK(!target.transmitting);
+        SIM_CHECK(!(SIM_RAW(I2Cx->CR1) & (I2C_CR1_TXIE | I2C_CR1_TXDMAEN)));
+
+        /* and it still works */
+        SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 0));
+        SIM_CHECK(sim_i2c_host_write(I2Cx, 5));
+        SIM_CHECK(sim_i2c_host_start(I2Cx, OWN_ADDR, 1));
+        SIM_CHECK(sim_i2c_host_read(I2Cx) == 0xA5);
+        sim_i2c_host_stop(I2Cx);
+        SIM_CHECK(target.errors == 2);
+    }
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_i2c_target\n");
+    test_write(I2C1); // DMA feeds TXDR
+    test_read(I2C1);
+    test_errors(I2C1);
+    test_write(I2C3); // the interrupt feeds TXDR
+    test_read(I2C3);
+    test_errors(I2C3);
+    printf("test_i2c_target: ok\n");
+
+    return 0;
+}
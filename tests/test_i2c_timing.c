@@ -0,0 +1,231 @@
+/**
+ ******************************************************************************
+ * @file    test_i2c_timing.c
+ * @author  Loren Snow
+ * @brief   I2C TIMINGR table and solver tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "i2c_timing.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define RISE_NS 100U
+#define FALL_NS 10U
+#define AF_MIN_PS 50000
+#define AF_MAX_PS 260000
+
+/**
+ * @brief   Reference manual tables 148-150, transcribed as raw register values.
+ */
+static const struct
+{
+    uint32_t clk_hz;
+    uint32_t bus_hz;
+    uint32_t timingr;
+} rm_table[] = {
+    {8000000, 100000, 0x10420F13}, {8000000, 400000, 0x00310309},  {8000000, 500000, 0x00100306},
+    {16000000, 100000, 0x30420F13}, {16000000, 400000, 0x10320309}, {16000000, 1000000, 0x00200204},
+    {48000000, 100000, 0xB0420F13}, {48000000, 400000, 0x50330309}, {48000000, 1000000, 0x50100103},
+};
+
+/**
+ * @brief   I2C specification limits per mode, in picoseconds.
+ */
+static const struct
+{
+    uint32_t max_hz;
+    int64_t low_min;
+    int64_t high_min;
+    int64_t su_dat_min;
+    int64_t vd_dat_max;
+} spec[] = {
+    {100000, 4700000, 4000000, 250000, 3450000},
+    {400000, 1300000, 600000, 100000, 900000},
+    {1000000, 500000, 260000, 50000, 450000},
+};
+
+/**
+ * @brief   A TIMINGR value taken apart, with its times in picoseconds.
+ */
+typedef struct
+{
+    int64_t tclk;
+    int64_t tpresc;
+    int64_t scll;   ///< programmed low time, (SCLL + 1) * tPRESC
+    int64_t sclh;   ///< programmed high time, (SCLH + 1) * tPRESC
+    int64_t t_low;  ///< SCL low time on the bus, with synchronization
+    int64_t t_high; ///< SCL high time on the bus, with synchronization
+    int64_t scldel;
+    int64_t sdadel;
+} timing_t;
+
+static timing_t decode(uint32_t clk_hz, uint32_t timingr)
+{
+    timing_t t;
+
+    t.tclk = 1000000000000LL / clk_hz;
+    t.tpresc = (((timingr & I2C_TIMINGR_PRESC) >> I2C_TIMINGR_PRESC_Pos) + 1) * t.tclk;
+    t.scll = (((timingr & I2C_TIMINGR_SCLL) >> I2C_TIMINGR_SCLL_Pos) + 1) * t.tpresc;
+    t.sclh = (((timingr & I2C_TIMINGR_SCLH) >> I2C_TIMINGR_SCLH_Pos) + 1) * t.tpresc;
+    t.t_low = t.scll + FALL_NS * 1000 + AF_MIN_PS + 2 * t.tclk;
+    t.t_high = t.sclh + RISE_NS * 1000 + AF_MIN_PS + 2 * t.tclk;
+    t.scldel = (((timingr & I2C_TIMINGR_SCLDEL) >> I2C_TIMINGR_SCLDEL_Pos) + 1) * t.tpresc;
+    t.sdadel = ((timingr & I2C_TIMINGR_SDADEL) >> I2C_TIMINGR_SDADEL_Pos) * t.tpresc;
+
+    return t;
+}
+
+/**
+ * @brief   tI2CCLK < (tLOW - tfilters) / 4 and tI2CCLK < tHIGH.
+ */
+static uint8_t meets_clock_limits(uint32_t clk_hz, uint32_t timingr)
+{
+    timing_t t = decode(clk_hz, timingr);
+
+    return (4 * t.tclk < t.scll - AF_MIN_PS) && (t.tclk < t.sclh);
+}
+
+/**
+ * @brief   The bus-mode limits of the I2C specification, and a frequency at or below bus_hz.
+ */
+static uint8_t meets_spec(uint32_t clk_hz, uint32_t bus_hz, uint32_t timingr)
+{
+    timing_t t = decode(clk_hz, timingr);
+    uint32_t m = (bus_hz > 400000) ? 2 : ((bus_hz > 100000) ? 1 : 0);
+    int64_t vd_dat = t.sdadel + AF_MAX_PS + 4 * t.tclk + RISE_NS * 1000;
+
+    return (t.t_low >= spec[m].low_min) && (t.t_high >= spec[m].high_min) &&
+           (t.t_low + t.t_high >= 1000000000000LL / bus_hz) &&
+           (t.scldel >= RISE_NS * 1000 + spec[m].su_dat_min) &&
+           ((vd_dat <= spec[m].vd_dat_max) || (t.sdadel == 0));
+}
+
+/**
+ * @brief   SCL frequency a TIMINGR value gives on a bus with the assumed edges.
+ */
+static uint32_t scl_hz(uint32_t clk_hz, uint32_t timingr)
+{
+    timing_t t = decode(clk_hz, timingr);
+
+    return (uint32_t)(1000000000000LL / (t.t_low + t.t_high));
+}
+
+/**
+ * @brief   The lookup returns the reference manual's values for the clocks its tables cover, and
+ *          those values meet the kernel clock limits the solver enforces.
+ */
+static void test_lookup_matches_reference_manual(void)
+{
+    for (uint32_t i = 0; i < sizeof(rm_table) / sizeof(rm_table[0]); i++)
+    {
+        SIM_CHECK(i2c_timing_lookup(rm_table[i].clk_hz, rm_table[i].bus_hz) == rm_table[i].timingr);
+        SIM_CHECK(meets_clock_limits(rm_table[i].clk_hz, rm_table[i].timingr));
+    }
+}
+
+/**
+ * @brief   For the reference manual's clocks and speeds the solver's answer is legal and within
+ *          ten percent of the manual's speed (or of the asked speed, which some manual values
+ *          exceed with these edge times).
+ */
+static void test_solver_against_reference_manual(void)
+{
+    for (uint32_t i = 0; i < sizeof(rm_table) / sizeof(rm_table[0]); i++)
+    {
+        uint32_t clk = rm_table[i].clk_hz, bus = rm_table[i].bus_hz;
+        uint32_t solved = i2c_timing_solve(clk, bus, RISE_NS, FALL_NS);
+        uint32_t manual = scl_hz(clk, rm_table[i].timingr);
+
+        printf("  %2u MHz %4u kHz: manual 0x%08X %4u kHz, solver 0x%08X %4u kHz\n", clk / 1000000, bus / 1000,
+               rm_table[i].timingr, manual / 1000, solved, scl_hz(clk, solved) / 1000);
+
+        SIM_CHECK(solved != 0);
+        SIM_CHECK(meets_clock_limits(clk, solved));
+        SIM_CHECK(meets_spec(clk, bus, solved));
+        SIM_CHECK(scl_hz(clk, solved) >= ((manual < bus) ? manual : bus) * 9 / 10); // manual may overshoot
+    }
+}
+
+/**
+ * @brief   Whatever the solver returns over a spread of clocks and speeds is legal.
+ */
+static void test_solver_grid(void)
+{
+    static const uint32_t clks[] = {4000000, 8000000, 12000000, 16000000, 24000000, 32000000, 36000000,
+                                    48000000, 64000000, 72000000};
+    static const uint32_t buses[] = {10000, 100000, 250000, 400000, 800000, 1000000};
+
+    for (uint32_t c = 0; c < sizeof(clks) / sizeof(clks[0]); c++)
+    {
+        for (uint32_t b = 0; b < sizeof(buses) / sizeof(buses[0]); b++)
+        {
+            uint32_t solved = i2c_timing_solve(clks[c], buses[b], RISE_NS, FALL_NS);
+
+            if (solved)
+            {
+                SIM_CHECK(meets_clock_limits(clks[c], solved));
+                SIM_CHECK(meets_spec(clks[c], buses[b], solved));
+            }
+            else
+            {
+                SIM_CHECK((clks[c] < 16000000) || (buses[b] == 10000)); // only slow clocks (or prescaler range) run out
+            }
+        }
+    }
+}
+
+/**
+ * @brief   8 MHz can't do 1 MHz: the solver used to return PRESC 0, SCLDEL 1, SDADEL 0,
+ *          SCLH 0, SCLL 1, which breaks the kernel clock limits. Now the solver gives up and
+ *          the lookup falls back to the fastest legal fast-mode-plus rate.
+ */
+static void test_8mhz_1mhz(void)
+{
+    uint32_t fallback = i2c_timing_lookup(8000000, 1000000);
+
+    SIM_CHECK(i2c_timing_solve(8000000, 1000000, RISE_NS, FALL_NS) == 0);
+    SIM_CHECK(fallback != I2C_TIMINGR(0, 1, 0, 0, 1));
+    SIM_CHECK(fallback != 0);
+    SIM_CHECK(meets_clock_limits(8000000, fallback));
+    SIM_CHECK(meets_spec(8000000, 1000000, fallback));
+    SIM_CHECK(scl_hz(8000000, fallback) > 400000);
+
+    printf("  8 MHz, 1 MHz asked: 0x%08X, %u kHz\n", fallback, scl_hz(8000000, fallback) / 1000);
+}
+
+int main(void)
+{
+    printf("test_i2c_timing\n");
+    test_lookup_matches_reference_manual();
+    test_solver_against_reference_manual();
+    test_solver_grid();
+    test_8mhz_1mhz();
+    printf("test_i2c_timing: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * @file    test_ssd1306.c
+ * @author  Loren Snow
+ * @brief   SSD1306 and SH1106 partial-update tests.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "ssd1306.h"
+#include "sim.h"
+#include <stdio.h>
+
+#define OLED_ADDR 0x3CU
+#define HDR_LEN 7U ///< page and column commands, each behind a control byte, then the data control byte
+
+static ssd1306_t oled;
+
+/**
+ * @brief       Resets the simulator, brings up the display and forgets the bytes of its setup.
+ */
+static void setup(SSD1306_Controller controller)
+{
+    sim_reset();
+    SIM_CHECK(I2C_init(I2C1, Fast) == I2C_OK);
+    SIM_CHECK(ssd1306_init(&oled, I2C1, OLED_ADDR, controller) == I2C_OK);
+    sim_i2c[0].tx_len = 0;
+    sim_i2c[0].starts = 0;
+}
+
+/**
+ * @brief       Checks a flush transaction's header, starting at tx[at].
+ */
+static void check_header(uint32_t at, uint8_t page, uint8_t col)
+{
+    const uint8_t *tx = &sim_i2c[0].tx[at];
+
+    SIM_CHECK((tx[0] == 0x80) && (tx[1] == (0xB0U | page)));
+    SIM_CHECK((tx[2] == 0x80) && (tx[3] == (col & 0x0FU)));
+    SIM_CHECK((tx[4] == 0x80) && (tx[5] == (0x10U | (col >> 4))));
+    SIM_CHECK(tx[6] == 0x40);
+}
+
+/**
+ * @brief       Pixels on one page go out as one transaction of the header and the columns from
+ *              the first changed one to the last, and a second flush sends nothing.
+ */
+static void test_pixels_send_dirty_range(void)
+{
+    setup(SSD1306_CONTROLLER_SSD1306);
+
+    ssd1306_set_pixel(&oled, 20, 19, 1); // page 2, bit 3
+    ssd1306_set_pixel(&oled, 10, 16, 1); // page 2, bit 0
+    SIM_CHECK((oled.dirty_first[2] == 10) && (oled.dirty_last[2] == 20));
+
+    SIM_CHECK(ssd1306_flush(&oled) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == 1);
+    SIM_CHECK(sim_i2c[0].tx_len == HDR_LEN + 11U);
+    check_header(0, 2, 10);
+    SIM_CHECK(sim_i2c[0].tx[HDR_LEN] == 0x01);
+    SIM_CHECK(sim_i2c[0].tx[HDR_LEN + 5] == 0x00);
+    SIM_CHECK(sim_i2c[0].tx[HDR_LEN + 10] == 0x08);
+
+    SIM_CHECK(ssd1306_flush(&oled) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == 1);
+    SIM_CHECK(sim_i2c[0].tx_len == HDR_LEN + 11U);
+
+    ssd1306_set_pixel(&oled, 20, 19, 1); // already lit: nothing to send
+    SIM_CHECK(ssd1306_flush(&oled) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == 1);
+}
+
+/**
+ * @brief       The SH1106 shows RAM columns 2-129, so the column address is shifted by two.
+ */
+static void test_sh1106_column_offset(void)
+{
+    setup(SSD1306_CONTROLLER_SH1106);
+
+    ssd1306_set_pixel(&oled, 14, 0, 1); // RAM column 16: low nibble 0, high nibble 1
+    SIM_CHECK(ssd1306_flush(&oled) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].tx_len == HDR_LEN + 1U);
+    check_header(0, 0, 16);
+    SIM_CHECK(sim_i2c[0].tx[HDR_LEN] == 0x01);
+}
+
+/**
+ * @brief       A rectangle across a page boundary gets the right bits on each page, is clipped
+ *              at the panel's edges, and is flushed as one transaction per page it touches.
+ */
+static void test_fill_rect_clips(void)
+{
+    setup(SSD1306_CONTROLLER_SSD1306);
+
+    ssd1306_fill_rect(&oled, 3, 5, 2, 6, 1); // rows 5-10
+    SIM_CHECK(oled.fb[0 * SSD1306_WIDTH + 3] == 0xE0);
+    SIM_CHECK(oled.fb[1 * SSD1306_WIDTH + 4] == 0x07);
+    SIM_CHECK((oled.fb[2] == 0) && (oled.fb[5] == 0) && (oled.fb[2 * SSD1306_WIDTH + 3] == 0));
+
+    ssd1306_fill_rect(&oled, 126, 60, 10, 10, 1); // runs off the right and the bottom
+    SIM_CHECK(oled.fb[7 * SSD1306_WIDTH + 126] == 0xF0);
+    SIM_CHECK(oled.fb[7 * SSD1306_WIDTH + 127] == 0xF0);
+    SIM_CHECK(oled.fb[7 * SSD1306_WIDTH + 125] == 0);
+
+    ssd1306_fill_rect(&oled, 0, 16, 1, 8, 1); // exactly page 2
+    SIM_CHECK(oled.fb[2 * SSD1306_WIDTH] == 0xFF);
+    SIM_CHECK(oled.fb[3 * SSD1306_WIDTH] == 0x00);
+
+    SIM_CHECK(ssd1306_flush(&oled) == I2C_OK);
+    SIM_CHECK(sim_i2c[0].starts == 4); // pages 0, 1, 2 and 7
+    SIM_CHECK(sim_i2c[0].tx_len == 3U * (HDR_LEN + 2U) + (HDR_LEN + 1U));
+    check_header(0, 0, 3);
+    check_header(HDR_LEN + 2U, 1, 3);
+    check_header(2U * (HDR_LEN + 2U), 2, 0);
+    check_header(2U * (HDR_LEN + 2U) + HDR_LEN + 1U, 7, 126);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_ssd1306\n");
+    test_pixels_send_dirty_range();
+    test_sh1106_column_offset();
+    test_fill_rect_clips();
+    printf("test_ssd1306: ok\n");
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * @file    test_systick.c
+ * @author  Loren Snow
+ * @brief   Microsecond time base across a pending SysTick wrap.
+ *
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 Loren Snow
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************
+ */
+
+#include "systick.h"
+#include "sim.h"
+#include <stdio.h>
+
+void SysTick_Handler(void);
+
+/**
+ * @brief       The counter reloads while interrupts are masked: the tick is pending, the
+ *              millisecond count is one behind, and micros must still move forwards.
+ */
+static void test_micros_pending_wrap(void)
+{
+    uint64_t before, after;
+
+    sim_reset();
+    systick_init();
+    SIM_CHECK(SysTick->LOAD == 7999U);
+
+    __disable_irq();
+    SysTick->VAL = 10; // 10 cycles before the reload
+    before = systick_micros();
+
+    SysTick->VAL = 7990; // reloaded, 9 cycles into the next millisecond
+    SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+    after = systick_micros();
+    SIM_CHECK(after >= before);
+    SIM_CHECK(after - before < 10U);
+
+    SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk; // the tick is taken
+    SysTick_Handler();
+    __enable_irq();
+    SIM_CHECK(systick_micros() == after);
+}
+
+/**
+ * @brief       Like systick_delay_ms, systick_delay_us starts a stopped time base.
+ */
+static void test_delay_us_starts(void)
+{
+    sim_reset();
+    SIM_CHECK(!(SysTick->CTRL & CTRL_ENABLE));
+
+    systick_delay_us(0);
+    SIM_CHECK(SysTick->CTRL & CTRL_ENABLE);
+    SIM_CHECK(SysTick->LOAD == 7999U);
+}
+
+int main(void)
+{
+    sim_init();
+
+    printf("test_systick\n");
+    test_micros_pending_wrap();
+    test_delay_us_starts();
+    printf("test_systick: ok\n");
+
+    return 0;
+}